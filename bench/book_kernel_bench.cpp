@@ -0,0 +1,147 @@
+/**
+ * @file book_kernel_bench.cpp
+ * @brief Microbenchmark: scalar vs SIMD level search/shift for one book side
+ *
+ * Replays the same random update stream (inserts, qty updates, deletes
+ * around the touch) against one side of a book at depths 5/10/20/50 with:
+ *   - reference: original applyLevelUpdate loops (scan + element shifts)
+ *   - kernels:   book_kernels::findLevel + memmove shifts
+ * for int64 ticks and double prices, and checks both end in the same state.
+ *
+ * Build: cmake -DFH_BUILD_BENCHMARKS=ON [-DFH_ENABLE_AVX2=ON] ...
+ * Run:   ./build/book_kernel_bench [updates]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "book_kernels.hpp"
+
+namespace {
+
+template<typename Value>
+struct Update {
+    Value price;
+    Value qty;
+};
+
+/// Original OrderBookManager::applyLevelUpdate body (pre-kernel)
+template<typename Value>
+void applyReference(Value* prices, Value* qtys, int depth, bool isBid, const Update<Value>& u) {
+    int existingIdx = -1;
+    int insertIdx = depth;
+    for (int i = 0; i < depth; ++i) {
+        if (prices[i] == u.price && qtys[i] > 0) {
+            existingIdx = i;
+            break;
+        }
+        if (prices[i] == 0 || (isBid ? u.price > prices[i] : u.price < prices[i])) {
+            if (insertIdx == depth) insertIdx = i;
+        }
+    }
+    if (u.qty == 0) {
+        if (existingIdx >= 0) {
+            for (int i = existingIdx; i < depth - 1; ++i) {
+                prices[i] = prices[i + 1];
+                qtys[i] = qtys[i + 1];
+            }
+            prices[depth - 1] = Value{};
+            qtys[depth - 1] = Value{};
+        }
+    } else if (existingIdx >= 0) {
+        qtys[existingIdx] = u.qty;
+    } else if (insertIdx < depth) {
+        for (int i = depth - 1; i > insertIdx; --i) {
+            prices[i] = prices[i - 1];
+            qtys[i] = qtys[i - 1];
+        }
+        prices[insertIdx] = u.price;
+        qtys[insertIdx] = u.qty;
+    }
+}
+
+/// Kernel-based version (as in OrderBookManager::applyLevelUpdate)
+template<typename Value>
+void applyKernels(Value* prices, Value* qtys, int depth, bool isBid, const Update<Value>& u) {
+    const auto found = book_kernels::findLevel(prices, depth, u.price, isBid);
+    if (u.qty == 0) {
+        if (found.existing >= 0) {
+            book_kernels::removeAt(prices, depth, found.existing);
+            book_kernels::removeAt(qtys, depth, found.existing);
+        }
+    } else if (found.existing >= 0) {
+        qtys[found.existing] = u.qty;
+    } else if (found.insert < depth) {
+        book_kernels::insertAt(prices, depth, found.insert, u.price);
+        book_kernels::insertAt(qtys, depth, found.insert, u.qty);
+    }
+}
+
+/// Bid-side updates within 2*depth ticks of a fixed touch, ~30% deletes
+template<typename Value>
+std::vector<Update<Value>> makeUpdates(size_t count, int depth, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> offset(0, 2 * depth);
+    std::uniform_int_distribution<int> qty(1, 1000);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    std::vector<Update<Value>> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Update<Value> u;
+        u.price = static_cast<Value>(4325000 - offset(rng));
+        u.qty = action(rng) < 3 ? Value{} : static_cast<Value>(qty(rng));
+        out.push_back(u);
+    }
+    return out;
+}
+
+template<typename Value, typename Apply>
+double run(const std::vector<Update<Value>>& updates, int depth, Apply apply,
+           std::vector<Value>& prices, std::vector<Value>& qtys) {
+    prices.assign(depth, Value{});
+    qtys.assign(depth, Value{});
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& u : updates) {
+        apply(prices.data(), qtys.data(), depth, true, u);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / updates.size();
+}
+
+template<typename Value>
+bool benchDepth(const char* typeName, int depth, size_t count) {
+    auto updates = makeUpdates<Value>(count, depth, 42 + depth);
+    std::vector<Value> refP, refQ, kerP, kerQ;
+
+    // Warm-up pass, then measured pass
+    run(updates, depth, applyReference<Value>, refP, refQ);
+    double refNs = run(updates, depth, applyReference<Value>, refP, refQ);
+    run(updates, depth, applyKernels<Value>, kerP, kerQ);
+    double kerNs = run(updates, depth, applyKernels<Value>, kerP, kerQ);
+
+    bool same = refP == kerP && refQ == kerQ;
+    std::printf("%-7s depth=%-3d reference=%7.2f ns/upd  %s=%7.2f ns/upd  speedup=%5.2fx  %s\n",
+        typeName, depth, refNs, book_kernels::KERNEL_NAME, kerNs, refNs / kerNs,
+        same ? "OK" : "MISMATCH");
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    std::printf("book_kernel_bench: %zu updates per run, kernel=%s\n", count, book_kernels::KERNEL_NAME);
+
+    bool ok = true;
+    for (int depth : {5, 10, 20, 50}) {
+        ok &= benchDepth<int64_t>("int64", depth, count);
+        ok &= benchDepth<double>("double", depth, count);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,388 @@
+/**
+ * @file book_layout_bench.cpp
+ * @brief Microbenchmark: per-field arrays vs per-symbol hot/cold book blocks
+ *
+ * Replays the same random delta stream (one bid and one ask level update
+ * per delta, symbols drawn uniformly) through:
+ *   - reference: the original OrderBookManager layout - one flat array per
+ *     field (state, update ids, event time, scale, four level arrays per
+ *     side pair, four published-copy arrays, publish flags and times)
+ *   - blocks:    OrderBookManager (HotBook + PublishedBook per symbol)
+ * Each delta is sequence-checked, applied, then run through the publish
+ * decision (compare with the published copy, copy on change), i.e. the
+ * book work of one depth message. Both use book_kernels for the level
+ * search, so only the memory layout differs; both must end in the same
+ * books.
+ *
+ * Reports ns/delta and, where perf_event_open is permitted, L1D and LLC
+ * read misses per delta ("n/a" otherwise, e.g. in containers).
+ *
+ * Build: cmake -DFH_BUILD_BENCHMARKS=ON [-DFH_ENABLE_AVX2=ON] ...
+ * Run:   ./build/book_layout_bench [deltas]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "order_book_manager.hpp"
+
+namespace {
+
+using Rep = TickPriceRep;
+using Value = Rep::value_type;
+using Clock = std::chrono::steady_clock;
+
+struct Step {
+    int sym;
+    BasicPriceLevel<Rep> bid;
+    BasicPriceLevel<Rep> ask;
+};
+
+constexpr Value BID_TOUCH = 4325000;
+constexpr Value ASK_TOUCH = 4325001;
+
+// ============================================================================
+// REFERENCE: ORIGINAL PER-FIELD LAYOUT
+// ============================================================================
+
+/// The pre-block OrderBookManager data layout and delta/publish path
+template<int Depth>
+struct FlatBooks {
+    std::vector<Value> bidPrices, bidQtys, askPrices, askQtys;          // [n * Depth]
+    std::vector<Value> pubBidPrices, pubBidQtys, pubAskPrices, pubAskQtys;
+    std::vector<InstrumentScale> scales;
+    std::vector<BookState> states;
+    std::vector<long long> lastUpdateIds, snapshotUpdateIds, exchEventTimeMs;
+    std::vector<bool> lastPublishedValid, hasPublished;
+    std::vector<Clock::time_point> lastPublishTimes;
+    PublishScheduler heartbeats;
+
+    explicit FlatBooks(int n)
+        : bidPrices(n * Depth), bidQtys(n * Depth), askPrices(n * Depth), askQtys(n * Depth)
+        , pubBidPrices(n * Depth), pubBidQtys(n * Depth), pubAskPrices(n * Depth), pubAskQtys(n * Depth)
+        , scales(n), states(n, BookState::INIT)
+        , lastUpdateIds(n, 0), snapshotUpdateIds(n, 0), exchEventTimeMs(n, 0)
+        , lastPublishedValid(n, false), hasPublished(n, false), lastPublishTimes(n)
+        , heartbeats(n, std::chrono::milliseconds(PUBLISH_TIMEOUT_MS))
+    {
+    }
+
+    void prime(int idx) {
+        const int off = idx * Depth;
+        for (int l = 0; l < Depth; ++l) {
+            bidPrices[off + l] = BID_TOUCH - 2 * l;
+            askPrices[off + l] = ASK_TOUCH + 2 * l;
+            bidQtys[off + l] = askQtys[off + l] = 100000;
+        }
+        states[idx] = BookState::VALID;
+        lastUpdateIds[idx] = snapshotUpdateIds[idx] = 1000;
+    }
+
+    static void applyLevel(Value* prices, Value* qtys, bool isBid, const BasicPriceLevel<Rep>& u) {
+        const auto found = book_kernels::findLevel(prices, Depth, u.price, isBid);
+        if (u.qty == 0) {
+            if (found.existing >= 0) {
+                book_kernels::removeAt(prices, Depth, found.existing);
+                book_kernels::removeAt(qtys, Depth, found.existing);
+            }
+        } else if (found.existing >= 0) {
+            qtys[found.existing] = u.qty;
+        } else if (found.insert < Depth) {
+            book_kernels::insertAt(prices, Depth, found.insert, u.price);
+            book_kernels::insertAt(qtys, Depth, found.insert, u.qty);
+        }
+    }
+
+    bool sameAsPublished(int off) const {
+        return std::equal(&bidPrices[off], &bidPrices[off] + Depth, &pubBidPrices[off]) &&
+               std::equal(&bidQtys[off], &bidQtys[off] + Depth, &pubBidQtys[off]) &&
+               std::equal(&askPrices[off], &askPrices[off] + Depth, &pubAskPrices[off]) &&
+               std::equal(&askQtys[off], &askQtys[off] + Depth, &pubAskQtys[off]);
+    }
+
+    /// @return true if the delta led to a publish
+    bool step(const Step& s, long long updateId, Clock::time_point now) {
+        const int idx = s.sym;
+        if (states[idx] != BookState::VALID || updateId != lastUpdateIds[idx] + 1) {
+            std::abort();
+        }
+        const int off = idx * Depth;
+        applyLevel(&bidPrices[off], &bidQtys[off], true, s.bid);
+        applyLevel(&askPrices[off], &askQtys[off], false, s.ask);
+        lastUpdateIds[idx] = updateId;
+        exchEventTimeMs[idx] = 1700000000000LL;
+
+        const bool publish = !hasPublished[idx] || !lastPublishedValid[idx] || !sameAsPublished(off) ||
+            now - lastPublishTimes[idx] >= std::chrono::milliseconds(PUBLISH_TIMEOUT_MS);
+        if (publish) {
+            std::copy_n(&bidPrices[off], Depth, &pubBidPrices[off]);
+            std::copy_n(&bidQtys[off], Depth, &pubBidQtys[off]);
+            std::copy_n(&askPrices[off], Depth, &pubAskPrices[off]);
+            std::copy_n(&askQtys[off], Depth, &pubAskQtys[off]);
+            lastPublishedValid[idx] = true;
+            lastPublishTimes[idx] = now;
+            hasPublished[idx] = true;
+            heartbeats.schedule(idx, now);
+        }
+        return publish;
+    }
+};
+
+// ============================================================================
+// BLOCKS: ORDERBOOKMANAGER
+// ============================================================================
+
+template<int Depth>
+struct BlockBooks {
+    using Book = OrderBookManager<Rep, Depth>;
+
+    Book book;
+    typename Book::Quote validQuote{};
+
+    static std::vector<std::string> names(int n) {
+        std::vector<std::string> s;
+        for (int i = 0; i < n; ++i) s.push_back("SYM" + std::to_string(i) + "USDT");
+        return s;
+    }
+
+    explicit BlockBooks(int n) : book(names(n)) { validQuote.isValid = true; }
+
+    void prime(int idx) {
+        std::vector<typename Book::Level> bids, asks;
+        for (int l = 0; l < Depth; ++l) {
+            bids.push_back({BID_TOUCH - 2 * l, 100000});
+            asks.push_back({ASK_TOUCH + 2 * l, 100000});
+        }
+        book.applySnapshot(idx, 999, bids, asks);
+        book.applyDelta(idx, 1000, 1000, nullptr, 0, nullptr, 0, 0);  // SYNCING -> VALID
+    }
+
+    bool step(const Step& s, long long updateId, Clock::time_point now) {
+        if (!book.applyDelta(s.sym, updateId, updateId, &s.bid, 1, &s.ask, 1, 1700000000000LL)) {
+            std::abort();
+        }
+        const bool publish = book.shouldPublish(s.sym, true, now);
+        if (publish) {
+            book.recordPublish(s.sym, validQuote, now);
+        }
+        return publish;
+    }
+};
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+/// Hardware cache counter; reads -1 when perf events are not permitted
+class CacheCounter {
+public:
+    CacheCounter(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    }
+    ~CacheCounter() { if (fd_ >= 0) close(fd_); }
+
+    // Counts accumulate across resume/pause pairs
+    void resume() { if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0); }
+    void pause() { if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0); }
+
+    long long value() const {
+        if (fd_ < 0) return -1;
+        long long v = 0;
+        return read(fd_, &v, sizeof(v)) == sizeof(v) ? v : -1;
+    }
+
+private:
+    int fd_{-1};
+};
+
+constexpr uint64_t cacheEvent(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/// Larger than L2: walking it between deltas leaves the books cold
+constexpr size_t EVICT_BYTES = 4u << 20;
+
+struct Result {
+    double nsPerDelta;
+    double l1PerDelta;      // < 0: not available
+    double llcPerDelta;
+    long long publishes;
+};
+
+std::vector<Step> makeSteps(size_t count, int numSymbols, int depth, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> sym(0, numSymbols - 1);
+    std::uniform_int_distribution<int> offset(0, 2 * depth);
+    std::uniform_int_distribution<int> lots(1, 100000);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    std::vector<Step> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Step s;
+        s.sym = sym(rng);
+        s.bid = {BID_TOUCH - offset(rng), action(rng) < 3 ? 0 : lots(rng)};
+        s.ask = {ASK_TOUCH + offset(rng), action(rng) < 3 ? 0 : lots(rng)};
+        out.push_back(s);
+    }
+    return out;
+}
+
+/// Cost of one Clock::now() pair (subtracted from per-delta timings)
+double clockOverheadNs() {
+    constexpr int N = 100000;
+    auto start = Clock::now();
+    for (int i = 0; i < N; ++i) {
+        auto t = Clock::now();
+        asm volatile("" : : "r"(&t) : "memory");
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / N;
+}
+
+/**
+ * @brief Apply steps in order
+ * @param evict Walked between deltas (cold mode, each delta timed alone);
+ *        nullptr: back-to-back deltas timed as one loop (warm mode)
+ */
+template<typename Books>
+Result run(Books& books, const std::vector<Step>& steps, std::vector<long long>& nextId,
+           std::vector<uint8_t>* evict) {
+    CacheCounter l1(PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D));
+    CacheCounter llc(PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_LL));
+    const Clock::time_point now = Clock::now();
+    long long publishes = 0;
+    double ns = 0;
+
+    if (!evict) {
+        l1.resume();
+        llc.resume();
+        auto start = Clock::now();
+        for (const Step& s : steps) {
+            publishes += books.step(s, nextId[s.sym]++, now);
+        }
+        ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        l1.pause();
+        llc.pause();
+    } else {
+        const double overhead = clockOverheadNs();
+        uint8_t salt = 0;
+        for (const Step& s : steps) {
+            ++salt;
+            for (size_t off = 0; off < evict->size(); off += 64) {
+                (*evict)[off] = salt;
+            }
+            l1.resume();
+            llc.resume();
+            auto start = Clock::now();
+            publishes += books.step(s, nextId[s.sym]++, now);
+            auto end = Clock::now();
+            l1.pause();
+            llc.pause();
+            ns += std::chrono::duration<double, std::nano>(end - start).count() - overhead;
+        }
+    }
+
+    const long long l1Misses = l1.value();
+    const long long llcMisses = llc.value();
+    const double n = static_cast<double>(steps.size());
+    return {ns / n,
+            l1Misses < 0 ? -1.0 : l1Misses / n,
+            llcMisses < 0 ? -1.0 : llcMisses / n,
+            publishes};
+}
+
+template<typename Books>
+Result measure(int numSymbols, const std::vector<Step>& warm, const std::vector<Step>& cold,
+               Books& books, std::vector<uint8_t>& evict, Result& coldResult) {
+    for (int i = 0; i < numSymbols; ++i) books.prime(i);
+    std::vector<long long> nextId(numSymbols, 1001);
+    run(books, warm, nextId, nullptr);          // Warm-up pass
+    const Result r = run(books, warm, nextId, nullptr);
+    coldResult = run(books, cold, nextId, &evict);
+    return r;
+}
+
+std::string misses(double v) {
+    if (v < 0) return "n/a";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.3f", v);
+    return buf;
+}
+
+void report(const char* mode, int numSymbols, int depth, const Result& ref, const Result& blk, bool same) {
+    std::printf("%-4s symbols=%-5d depth=%-3d reference=%7.2f ns/delta  blocks=%7.2f ns/delta  speedup=%5.2fx"
+                "  L1D miss/delta %s -> %s  LLC miss/delta %s -> %s  %s\n",
+        mode, numSymbols, depth, ref.nsPerDelta, blk.nsPerDelta, ref.nsPerDelta / blk.nsPerDelta,
+        misses(ref.l1PerDelta).c_str(), misses(blk.l1PerDelta).c_str(),
+        misses(ref.llcPerDelta).c_str(), misses(blk.llcPerDelta).c_str(),
+        same ? "OK" : "MISMATCH");
+}
+
+template<int Depth>
+bool benchLayout(int numSymbols, size_t count, size_t coldCount, std::vector<uint8_t>& evict) {
+    const auto warm = makeSteps(count, numSymbols, Depth, 42 + numSymbols + Depth);
+    const auto cold = makeSteps(coldCount, numSymbols, Depth, 7 + numSymbols + Depth);
+
+    FlatBooks<Depth> flat(numSymbols);
+    BlockBooks<Depth> blocks(numSymbols);
+    Result refCold, blkCold;
+    const Result ref = measure(numSymbols, warm, cold, flat, evict, refCold);
+    const Result blk = measure(numSymbols, warm, cold, blocks, evict, blkCold);
+
+    bool same = ref.publishes == blk.publishes && refCold.publishes == blkCold.publishes;
+    for (int i = 0; same && i < numSymbols; ++i) {
+        const auto q = blocks.book.getQuote(i, 0, 0);
+        const InstrumentScale& sc = flat.scales[i];
+        for (int l = 0; l < Depth; ++l) {
+            const int k = i * Depth + l;
+            same &= q.bidPrices[l] == Rep::toPrice(flat.bidPrices[k], sc) &&
+                    q.bidQtys[l] == Rep::toQty(flat.bidQtys[k], sc) &&
+                    q.askPrices[l] == Rep::toPrice(flat.askPrices[k], sc) &&
+                    q.askQtys[l] == Rep::toQty(flat.askQtys[k], sc);
+        }
+    }
+
+    report("warm", numSymbols, Depth, ref, blk, same);
+    report("cold", numSymbols, Depth, refCold, blkCold, same);
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    size_t coldCount = std::max<size_t>(count / 250, 1000);
+    std::vector<uint8_t> evict(EVICT_BYTES);
+
+    std::printf("book_layout_bench: %zu warm / %zu cold deltas per run, kernel=%s\n",
+        count, coldCount, book_kernels::KERNEL_NAME);
+
+    bool ok = true;
+    for (int numSymbols : {100, 1000}) {
+        ok &= benchLayout<1>(numSymbols, count, coldCount, evict);
+        ok &= benchLayout<5>(numSymbols, count, coldCount, evict);
+        ok &= benchLayout<20>(numSymbols, count, coldCount, evict);
+    }
+    return ok ? 0 : 1;
+}
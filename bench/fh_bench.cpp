@@ -0,0 +1,569 @@
+/**
+ * @file fh_bench.cpp
+ * @brief Google Benchmark suite for the feed handlers' hot paths
+ *
+ * Fixed, seeded datasets (same input every run) for:
+ *   - parse:   in-situ JSON parse + field extraction of trade and depth
+ *              messages (as TradeFeedHandler::parseTrade and the live path
+ *              of QuoteFeedHandler::processMessage)
+ *   - book:    OrderBookManager::applyDelta on multi-level deltas and on
+ *              single-level deltas (one applyLevelUpdate each), per price
+ *              representation, depth and symbol count
+ *   - publish: getQuote + shouldPublish (+ recordPublish when changed)
+ *   - symbols: message symbol -> index (std::string + unordered_map vs
+ *              SymbolTable on the raw bytes) and sym atom construction
+ *              (ks per message vs a cached atom shared with r1)
+ *   - row:     quote row construction as in publishQuote, one boxed knk
+ *              row of atoms vs appending to a ColumnBatch (take() included
+ *              whenever the batch fills)
+ *
+ * Every iteration is timed on its own (manual time, minus the calibrated
+ * cost of a clock read) into a LatencyHistogram, so besides the mean and
+ * items/s each benchmark reports p50_ns and p99_ns. Setup (copying the
+ * message the parser will modify, choosing the next delta) is untimed.
+ *
+ * Build: cmake -DFH_BUILD_BENCHMARKS=ON ... (needs Google Benchmark)
+ * Run:   cmake --build build --target bench
+ *        ./build/fh_bench --benchmark_filter=ApplyDelta --benchmark_counters_tabular=true
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "decimal_parser.hpp"
+#include "json_parser.hpp"
+#include "kdb_batch.hpp"
+#include "kdb_symbols.hpp"
+#include "latency_histogram.hpp"
+#include "order_book_manager.hpp"
+#include "symbol_table.hpp"
+
+extern "C" {
+#include "k.h"
+}
+
+namespace {
+
+// ============================================================================
+// TIMING
+// ============================================================================
+
+constexpr uint64_t SEED = 42;
+constexpr size_t DATASET_SIZE = 4096;           // Messages / deltas per dataset (cycled)
+constexpr long long KDB_EPOCH_OFFSET_NS = 946684800000000000LL;
+
+/// Median cost of one latency::nowNs() pair, subtracted from every sample
+long long clockOverheadNs() {
+    static const long long overhead = [] {
+        std::vector<long long> s(100000);
+        for (auto& v : s) {
+            const long long t0 = latency::nowNs();
+            v = latency::nowNs() - t0;
+        }
+        std::nth_element(s.begin(), s.begin() + s.size() / 2, s.end());
+        return s[s.size() / 2];
+    }();
+    return overhead;
+}
+
+/// Value at percentile p (bucket upper bound, as telemetry_fh_hist)
+long long percentile(const LatencyHistogram& h, double p) {
+    long long total = 0;
+    for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) total += static_cast<long long>(h.count(b));
+    if (total == 0) return 0;
+    const long long rank = static_cast<long long>(p * total + 0.999999);
+    long long seen = 0;
+    for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+        seen += static_cast<long long>(h.count(b));
+        if (seen >= rank) return LatencyHistogram::upperBound(b);
+    }
+    return LatencyHistogram::upperBound(LatencyHistogram::NUM_BUCKETS - 1);
+}
+
+/**
+ * @brief Benchmark loop: prepare(i) untimed, then op(i) timed per iteration
+ */
+template<typename Prepare, typename Op>
+void runTimed(benchmark::State& state, Prepare&& prepare, Op&& op) {
+    LatencyHistogram hist;
+    const long long overhead = clockOverheadNs();
+    size_t i = 0;
+    for (auto _ : state) {
+        prepare(i);
+        const long long t0 = latency::nowNs();
+        op(i);
+        const long long ns = std::max(0LL, latency::nowNs() - t0 - overhead);
+        hist.record(ns);
+        state.SetIterationTime(static_cast<double>(ns) * 1e-9);
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["p50_ns"] = static_cast<double>(percentile(hist, 0.50));
+    state.counters["p99_ns"] = static_cast<double>(percentile(hist, 0.99));
+}
+
+// ============================================================================
+// DATASETS
+// ============================================================================
+
+const InstrumentScale& btcScale() {
+    static const InstrumentScale sc = InstrumentScale::fromStrings("0.01000000", "0.00001000");
+    return sc;
+}
+
+/// "43250.12000000" style decimal for a tick / lot count
+std::string decimalString(long long units, int decimals) {
+    char buf[48];
+    long long div = 1;
+    for (int i = 0; i < decimals; ++i) div *= 10;
+    std::snprintf(buf, sizeof(buf), "%lld.%0*lld000000", units / div, decimals, units % div);
+    return buf;
+}
+
+std::string symbolName(int i) {
+    return i == 0 ? "BTCUSDT" : "SYM" + std::to_string(i) + "USDT";
+}
+
+/// Binance combined-stream trade messages
+const std::vector<std::string>& tradeMessages() {
+    static const std::vector<std::string> msgs = [] {
+        std::mt19937_64 rng(SEED);
+        std::uniform_int_distribution<int> tick(-500, 500);
+        std::uniform_int_distribution<int> lots(1, 100000);
+        std::vector<std::string> out;
+        char buf[512];
+        for (size_t i = 0; i < DATASET_SIZE; ++i) {
+            const long long t = 1700000000000LL + static_cast<long long>(i);
+            std::snprintf(buf, sizeof(buf),
+                "{\"stream\":\"btcusdt@trade\",\"data\":{\"e\":\"trade\",\"E\":%lld,\"s\":\"BTCUSDT\","
+                "\"t\":%lld,\"p\":\"%s\",\"q\":\"%s\",\"T\":%lld,\"m\":%s,\"M\":true}}",
+                t + 1, 3000000000LL + static_cast<long long>(i),
+                decimalString(4325000 + tick(rng), 2).c_str(), decimalString(lots(rng), 5).c_str(),
+                t, (i & 1) ? "true" : "false");
+            out.push_back(buf);
+        }
+        return out;
+    }();
+    return msgs;
+}
+
+/// Binance depth@100ms messages with the given levels per side
+std::vector<std::string> depthMessages(int levels) {
+    std::mt19937_64 rng(SEED + static_cast<uint64_t>(levels));
+    std::uniform_int_distribution<int> offset(0, 200);
+    std::uniform_int_distribution<int> lots(0, 100000);
+    std::vector<std::string> out;
+    for (size_t i = 0; i < DATASET_SIZE / 4; ++i) {
+        std::string m = "{\"stream\":\"btcusdt@depth@100ms\",\"data\":{\"e\":\"depthUpdate\",\"E\":"
+            + std::to_string(1700000000000LL + static_cast<long long>(i))
+            + ",\"s\":\"BTCUSDT\",\"U\":" + std::to_string(1000 + 2 * i)
+            + ",\"u\":" + std::to_string(1001 + 2 * i) + ",\"b\":[";
+        for (int side = 0; side < 2; ++side) {
+            for (int l = 0; l < levels; ++l) {
+                const long long price = side == 0 ? 4325000 - offset(rng) : 4325001 + offset(rng);
+                if (l > 0) m += ',';
+                m += "[\"" + decimalString(price, 2) + "\",\"" + decimalString(lots(rng), 5) + "\"]";
+            }
+            m += side == 0 ? "],\"a\":[" : "]}}";
+        }
+        out.push_back(std::move(m));
+    }
+    return out;
+}
+
+/**
+ * @brief Books for numSymbols symbols, each snapshotted and VALID, plus
+ *        seeded live deltas (levelsPerSide updates a side, ~30% deletes)
+ */
+template<typename Rep, int Depth>
+struct BookFixture {
+    using Book = OrderBookManager<Rep, Depth>;
+    using Level = typename Book::Level;
+    using Delta = typename Book::Delta;
+
+    std::vector<std::string> symbols;
+    Book book;
+    std::vector<Delta> deltas;
+    std::vector<int> deltaSym;
+    std::vector<long long> nextUpdateId;
+
+    static std::vector<std::string> makeSymbols(int n) {
+        std::vector<std::string> s;
+        for (int i = 0; i < n; ++i) s.push_back(symbolName(i));
+        return s;
+    }
+
+    BookFixture(int numSymbols, int levelsPerSide)
+        : symbols(makeSymbols(numSymbols))
+        , book(symbols)
+        , nextUpdateId(numSymbols, 1002)
+    {
+        auto level = [this](int idx, long long ticks, long long lots) {
+            const std::string p = decimalString(ticks, 2);
+            const std::string q = decimalString(lots, 5);
+            Level lvl;
+            book.parseLevel(idx, p.data(), p.size(), q.data(), q.size(), lvl);
+            return lvl;
+        };
+
+        for (int s = 0; s < numSymbols; ++s) {
+            book.setScale(s, btcScale());
+            std::vector<Level> bids, asks;
+            for (int l = 0; l < Depth; ++l) {
+                bids.push_back(level(s, 4325000 - 2 * l, 100000));
+                asks.push_back(level(s, 4325001 + 2 * l, 100000));
+            }
+            book.applySnapshot(s, 1000, bids, asks);
+            Delta first{1001, 1001, 0, {}, {}};
+            book.applyDelta(s, first);      // SYNCING -> VALID
+        }
+
+        std::mt19937_64 rng(SEED + static_cast<uint64_t>(numSymbols * 100 + Depth));
+        std::uniform_int_distribution<int> sym(0, numSymbols - 1);
+        std::uniform_int_distribution<int> offset(0, 2 * Depth);
+        std::uniform_int_distribution<int> lots(1, 100000);
+        std::uniform_int_distribution<int> action(0, 9);
+        for (size_t i = 0; i < DATASET_SIZE; ++i) {
+            const int s = sym(rng);
+            Delta d{0, 0, 1700000000000LL, {}, {}};
+            for (int l = 0; l < levelsPerSide; ++l) {
+                const long long q = action(rng) < 3 ? 0 : lots(rng);
+                d.bids.push_back(level(s, 4325000 - offset(rng), q));
+                d.asks.push_back(level(s, 4325001 + offset(rng), q));
+            }
+            deltas.push_back(std::move(d));
+            deltaSym.push_back(s);
+        }
+    }
+
+    /// Apply delta i with the symbol's next consecutive update id
+    void apply(size_t i) {
+        const size_t k = i % deltas.size();
+        Delta& d = deltas[k];
+        const int s = deltaSym[k];
+        d.firstUpdateId = d.finalUpdateId = nextUpdateId[s]++;
+        if (!book.applyDelta(s, d)) {
+            std::fprintf(stderr, "fh_bench: unexpected sequence gap\n");
+            std::abort();
+        }
+    }
+};
+
+/// Quote from a one-symbol book (kept alive: the quote's sym points into it)
+template<int Depth>
+DepthQuote<Depth> sampleQuote() {
+    static BookFixture<TickPriceRep, Depth> f(1, 1);
+    return f.book.getQuote(0, 1700000000000000000LL, 1);
+}
+
+// ============================================================================
+// PARSE
+// ============================================================================
+
+void BM_ParseTrade(benchmark::State& state) {
+    const auto& msgs = tradeMessages();
+    JsonParser parser;
+    std::vector<char> buf;
+    long long bytes = 0;
+
+    runTimed(state,
+        [&](size_t i) {
+            const std::string& m = msgs[i % msgs.size()];
+            buf.assign(m.begin(), m.end());
+            buf.push_back('\0');
+            bytes += static_cast<long long>(m.size());
+        },
+        [&](size_t) {
+            auto& doc = parser.parseInsitu(buf.data());
+            const auto& d = doc["data"];
+            const auto& p = d["p"];
+            const auto& q = d["q"];
+            double price = decimal::parseDouble(p.GetString(), p.GetStringLength());
+            double qty = decimal::parseDouble(q.GetString(), q.GetStringLength());
+            long long tradeId = d["t"].GetInt64();
+            bool maker = d["m"].GetBool();
+            long long e = d["E"].GetInt64() + d["T"].GetInt64();
+            const char* sym = d["s"].GetString();
+            benchmark::DoNotOptimize(price);
+            benchmark::DoNotOptimize(qty);
+            benchmark::DoNotOptimize(tradeId);
+            benchmark::DoNotOptimize(maker);
+            benchmark::DoNotOptimize(e);
+            benchmark::DoNotOptimize(sym);
+        });
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ParseTrade)->UseManualTime();
+
+/// Depth message parse and level decode into a reused Delta; arg = levels per side
+template<typename Rep>
+void BM_ParseDepth(benchmark::State& state) {
+    const auto msgs = depthMessages(static_cast<int>(state.range(0)));
+    BookFixture<Rep, 5> f(1, 1);
+    auto& book = f.book;
+    typename BookFixture<Rep, 5>::Delta delta{};
+    delta.bids.reserve(256);
+    delta.asks.reserve(256);
+    JsonParser parser;
+    std::vector<char> buf;
+    long long bytes = 0;
+
+    runTimed(state,
+        [&](size_t i) {
+            const std::string& m = msgs[i % msgs.size()];
+            buf.assign(m.begin(), m.end());
+            buf.push_back('\0');
+            bytes += static_cast<long long>(m.size());
+        },
+        [&](size_t) {
+            auto& doc = parser.parseInsitu(buf.data());
+            const auto& d = doc["data"];
+            const auto& s = d["s"];
+            const int symIdx = book.getSymbolIndex(s.GetString(), s.GetStringLength());
+            delta.firstUpdateId = d["U"].GetInt64();
+            delta.finalUpdateId = d["u"].GetInt64();
+            delta.eventTimeMs = d["E"].GetInt64();
+            auto decode = [&](const JsonParser::Value& arr, auto& out) {
+                out.clear();
+                for (const auto& lvl : arr.GetArray()) {
+                    out.emplace_back();
+                    book.parseLevel(symIdx,
+                        lvl[0].GetString(), lvl[0].GetStringLength(),
+                        lvl[1].GetString(), lvl[1].GetStringLength(), out.back());
+                }
+            };
+            decode(d["b"], delta.bids);
+            decode(d["a"], delta.asks);
+            benchmark::DoNotOptimize(delta.bids.data());
+            benchmark::DoNotOptimize(delta.asks.data());
+        });
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK_TEMPLATE(BM_ParseDepth, TickPriceRep)->Arg(5)->Arg(20)->Arg(100)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_ParseDepth, DoublePriceRep)->Arg(5)->Arg(20)->Arg(100)->UseManualTime();
+
+// ============================================================================
+// BOOK
+// ============================================================================
+
+/// applyDelta with 4 bid + 4 ask updates; arg = symbols
+template<typename Rep, int Depth>
+void BM_ApplyDelta(benchmark::State& state) {
+    BookFixture<Rep, Depth> f(static_cast<int>(state.range(0)), 4);
+    runTimed(state, [](size_t) {}, [&](size_t i) { f.apply(i); });
+}
+
+/// applyDelta with one bid + one ask update (two applyLevelUpdate calls); arg = symbols
+template<typename Rep, int Depth>
+void BM_ApplyLevelUpdate(benchmark::State& state) {
+    BookFixture<Rep, Depth> f(static_cast<int>(state.range(0)), 1);
+    runTimed(state, [](size_t) {}, [&](size_t i) { f.apply(i); });
+}
+
+#define FH_BOOK_BENCH(fn, rep, depth) \
+    BENCHMARK_TEMPLATE(fn, rep, depth)->Arg(1)->Arg(100)->Arg(1000)->UseManualTime()
+
+FH_BOOK_BENCH(BM_ApplyDelta, TickPriceRep, 1);
+FH_BOOK_BENCH(BM_ApplyDelta, TickPriceRep, 5);
+FH_BOOK_BENCH(BM_ApplyDelta, TickPriceRep, 10);
+FH_BOOK_BENCH(BM_ApplyDelta, TickPriceRep, 20);
+FH_BOOK_BENCH(BM_ApplyDelta, DoublePriceRep, 5);
+FH_BOOK_BENCH(BM_ApplyDelta, DoublePriceRep, 20);
+FH_BOOK_BENCH(BM_ApplyLevelUpdate, TickPriceRep, 5);
+FH_BOOK_BENCH(BM_ApplyLevelUpdate, TickPriceRep, 20);
+FH_BOOK_BENCH(BM_ApplyLevelUpdate, DoublePriceRep, 5);
+FH_BOOK_BENCH(BM_ApplyLevelUpdate, DoublePriceRep, 20);
+
+// ============================================================================
+// PUBLISH DECISION
+// ============================================================================
+
+/**
+ * @brief getQuote + shouldPublish (+ recordPublish) after each delta; arg = symbols
+ *
+ * The delta is applied untimed, so the timed path sees the realistic mix
+ * of changed and unchanged books (~1/3 of deltas leave the top Depth as is).
+ */
+template<typename Rep, int Depth>
+void BM_QuoteShouldPublish(benchmark::State& state) {
+    BookFixture<Rep, Depth> f(static_cast<int>(state.range(0)), 2);
+    auto& book = f.book;
+    const auto now = std::chrono::steady_clock::now();
+    long long seq = 0;
+    long long published = 0;
+
+    runTimed(state,
+        [&](size_t i) { f.apply(i); },
+        [&](size_t i) {
+            const int s = f.deltaSym[i % f.deltas.size()];
+            auto quote = book.getQuote(s, 1700000000000000000LL, ++seq);
+            if (book.shouldPublish(s, quote, now)) {
+                book.recordPublish(s, quote, now);
+                ++published;
+            }
+            benchmark::DoNotOptimize(quote);
+        });
+    state.counters["published_pct"] = state.iterations() ? 100.0 * published / state.iterations() : 0;
+}
+
+FH_BOOK_BENCH(BM_QuoteShouldPublish, TickPriceRep, 1);
+FH_BOOK_BENCH(BM_QuoteShouldPublish, TickPriceRep, 5);
+FH_BOOK_BENCH(BM_QuoteShouldPublish, TickPriceRep, 20);
+FH_BOOK_BENCH(BM_QuoteShouldPublish, DoublePriceRep, 5);
+
+// ============================================================================
+// SYMBOLS
+// ============================================================================
+
+/// Symbols as they appear in messages: a fixed random sequence over numSymbols names
+std::vector<std::string> symbolStream(int numSymbols) {
+    std::mt19937_64 rng(SEED + static_cast<uint64_t>(numSymbols));
+    std::uniform_int_distribution<int> sym(0, numSymbols - 1);
+    std::vector<std::string> out;
+    for (size_t i = 0; i < DATASET_SIZE; ++i) out.push_back(symbolName(sym(rng)));
+    return out;
+}
+
+std::vector<std::string> symbolNames(int numSymbols) {
+    std::vector<std::string> names;
+    for (int i = 0; i < numSymbols; ++i) names.push_back(symbolName(i));
+    return names;
+}
+
+/// Previous lookup: std::string from the JSON value, then unordered_map; arg = symbols
+void BM_SymbolLookupMap(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const auto stream = symbolStream(n);
+    std::unordered_map<std::string, int> index;
+    for (int i = 0; i < n; ++i) index[symbolName(i)] = i;
+
+    runTimed(state, [](size_t) {}, [&](size_t i) {
+        const char* raw = stream[i % stream.size()].c_str();
+        std::string sym = raw;
+        auto it = index.find(sym);
+        benchmark::DoNotOptimize(it != index.end() ? it->second : -1);
+    });
+}
+BENCHMARK(BM_SymbolLookupMap)->Arg(2)->Arg(100)->Arg(1000)->UseManualTime();
+
+/// SymbolTable::find on the raw bytes; arg = symbols
+void BM_SymbolLookupTable(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const auto stream = symbolStream(n);
+    const SymbolTable table(symbolNames(n));
+
+    runTimed(state, [](size_t) {}, [&](size_t i) {
+        const std::string& s = stream[i % stream.size()];
+        benchmark::DoNotOptimize(table.find(s.data(), s.size()));
+    });
+}
+BENCHMARK(BM_SymbolLookupTable)->Arg(2)->Arg(100)->Arg(1000)->UseManualTime();
+
+/// Sym atom per message: ks (interns with ss) vs the cached atom (r1); arg 0 = ks, 1 = cached
+void BM_SymAtom(benchmark::State& state) {
+    const bool cached = state.range(0) != 0;
+    const auto names = symbolNames(100);
+    const auto stream = symbolStream(100);
+    const SymbolTable table(names);
+    InternedSymbols syms(names);
+    std::vector<int> idx;
+    for (const auto& s : stream) idx.push_back(table.find(s));
+
+    runTimed(state, [](size_t) {}, [&](size_t i) {
+        const size_t k = i % stream.size();
+        K a = cached ? syms.atom(idx[k]) : ks((S)stream[k].c_str());
+        r0(a);
+    });
+}
+BENCHMARK(BM_SymAtom)->Arg(0)->Arg(1)->UseManualTime();
+
+// ============================================================================
+// ROW CONSTRUCTION
+// ============================================================================
+
+/// One boxed row of atoms per quote (publishQuote without batching)
+template<int Depth>
+void BM_QuoteRowKnk(benchmark::State& state) {
+    const DepthQuote<Depth> quote = sampleQuote<Depth>();
+    const std::array<const std::array<double, Depth>*, 4> sides{
+        &quote.bidPrices, &quote.bidQtys, &quote.askPrices, &quote.askQtys};
+    constexpr int META_COL = 2 + 4 * Depth;
+    InternedSymbols syms({quote.sym});
+
+    runTimed(state, [](size_t) {}, [&](size_t) {
+        K row = ktn(0, DepthQuote<Depth>::NUM_FIELDS);
+        kK(row)[0] = ktj(-KP, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+        kK(row)[1] = syms.atom(0);
+        for (int f = 0; f < 4; ++f) {
+            for (int i = 0; i < Depth; ++i) {
+                kK(row)[2 + f * Depth + i] = kf((*sides[f])[i]);
+            }
+        }
+        kK(row)[META_COL] = kb(quote.isValid);
+        kK(row)[META_COL + 1] = kj(quote.exchEventTimeMs);
+        kK(row)[META_COL + 2] = kj(quote.fhRecvTimeUtcNs);
+        kK(row)[META_COL + 3] = kj(quote.fhSeqNo);
+        r0(row);
+    });
+}
+BENCHMARK_TEMPLATE(BM_QuoteRowKnk, 1)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_QuoteRowKnk, 5)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_QuoteRowKnk, 20)->UseManualTime();
+
+/// Append to a columnar batch (appendToBatch); take() when full; arg = batch rows
+template<int Depth>
+void BM_QuoteRowColumnar(benchmark::State& state) {
+    const DepthQuote<Depth> quote = sampleQuote<Depth>();
+    const std::array<const std::array<double, Depth>*, 4> sides{
+        &quote.bidPrices, &quote.bidQtys, &quote.askPrices, &quote.askQtys};
+    constexpr int META_COL = 2 + 4 * Depth;
+    std::vector<int> types{KP, KS};
+    types.insert(types.end(), 4 * Depth, KF);
+    types.insert(types.end(), {KB, KJ, KJ, KJ});
+    ColumnBatch batch("quote_binance", types, static_cast<int>(state.range(0)), 1000000);
+    InternedSymbols syms({quote.sym});
+
+    runTimed(state, [](size_t) {}, [&](size_t) {
+        int r = batch.beginRow();
+        batch.setTimestamp(0, r, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+        batch.setInterned(1, r, syms.sym(0));
+        for (int f = 0; f < 4; ++f) {
+            for (int i = 0; i < Depth; ++i) {
+                batch.setFloat(2 + f * Depth + i, r, (*sides[f])[i]);
+            }
+        }
+        batch.setBool(META_COL, r, quote.isValid);
+        batch.setLong(META_COL + 1, r, quote.exchEventTimeMs);
+        batch.setLong(META_COL + 2, r, quote.fhRecvTimeUtcNs);
+        batch.setLong(META_COL + 3, r, quote.fhSeqNo);
+        if (batch.full()) {
+            r0(batch.take());
+        }
+    });
+}
+BENCHMARK_TEMPLATE(BM_QuoteRowColumnar, 1)->Arg(100)->Arg(500)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_QuoteRowColumnar, 5)->Arg(100)->Arg(500)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_QuoteRowColumnar, 20)->Arg(100)->Arg(500)->UseManualTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // k objects without a connection: initialise the k memory manager
+    khp((S)"", -1);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    std::printf("fh_bench: book representation ticks and double, clock overhead %lld ns (subtracted)\n",
+        clockOverheadNs());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,298 @@
+/**
+ * @file analytics_engine.hpp
+ * @brief In-process per-symbol analytics published to analytics_binance
+ *
+ * Computes on the feed handler's publishing thread, as each event is
+ * published, instead of two IPC hops later in rte.q:
+ *
+ *   trade handler:  rolling VWAP, quantity and trade count per window
+ *   quote handler:  depth imbalance, microprice and spread
+ *
+ * Each event produces one analytics_binance row for its symbol, appended
+ * to a columnar batch and sent by the handler next to its own table.
+ * A handler only fills its own half of the row; the other half is null
+ * (0n / 0N) and downstream joins the two by sym.
+ *
+ * Rolling VWAP (amortised O(windows) per trade):
+ *   Each symbol keeps a power-of-two ring of (tradeTimeNs, px*qty, qty)
+ *   spanning the longest window, plus per window a head position and the
+ *   running sums of the trades inside it. A trade is added to every sum,
+ *   then each window's head advances past trades older than the window,
+ *   subtracting them. Windows are in exchange trade time, so they do not
+ *   depend on when the handler happened to see the trade. The sums are
+ *   recomputed exactly once per ring's worth of trades so floating-point
+ *   drift cannot accumulate.
+ *
+ * Quote metrics (Depth levels per side):
+ *   spread     = askPrice1 - bidPrice1
+ *   microprice = (bidPrice1 * askQty1 + askPrice1 * bidQty1) / (bidQty1 + askQty1)
+ *   imbalance  = (sum bidQty - sum askQty) / (sum bidQty + sum askQty)
+ *
+ * Memory layout: hot per-symbol state is one cache line per symbol and
+ * window state is flat, symbol-major, so an update touches one line of
+ * each plus the ring tail. Rings only grow (doubling) when a window
+ * holds more trades than ever before; no allocation otherwise.
+ *
+ * Not thread-safe: owned by the handler's publishing thread.
+ *
+ * @see docs/decisions/adr-004-Real-Time-Rolling-Analytics-Computation.md
+ */
+
+#ifndef ANALYTICS_ENGINE_HPP
+#define ANALYTICS_ENGINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "kdb_batch.hpp"
+#include "kdb_symbols.hpp"
+#include "latency_histogram.hpp"
+#include "symbol_table.hpp"
+
+extern "C" {
+#include "k.h"
+}
+
+class AnalyticsEngine {
+public:
+    /// Nanoseconds between Unix epoch (1970) and kdb+ epoch (2000)
+    static constexpr long long KDB_EPOCH_OFFSET_NS = 946684800000000000LL;
+
+    /// Initial trades per symbol ring (power of two)
+    static constexpr size_t INITIAL_RING = 1024;
+
+    /**
+     * @param symbols Symbol names, indexed as in onTrade()/onQuote() (uppercase)
+     * @param cfg Table and VWAP windows
+     * @param batching Batch thresholds (disabled = one row per send)
+     */
+    AnalyticsEngine(const std::vector<std::string>& symbols,
+                    const AnalyticsConfig& cfg,
+                    const BatchConfig& batching)
+        : symbols_(symbols)
+        , interned_(symbols)
+        , tableAtom_(cfg.table)
+        , windowsSec_(sortedWindows(cfg.vwapWindowsSec))
+        , syms_(symbols.size())
+        , windows_(symbols.size() * windowsSec_.size())
+        , rings_(symbols.size(), std::vector<Trade>(INITIAL_RING))
+        , batch_(cfg.table, columnTypes(windowsSec_.size()),
+                 batching.enabled ? batching.maxRows : 1, batching.maxDelayUs)
+    {
+        for (int w : windowsSec_) {
+            windowsNs_.push_back(static_cast<long long>(w) * 1000000000LL);
+        }
+    }
+
+    // Non-copyable (owns the batch)
+    AnalyticsEngine(const AnalyticsEngine&) = delete;
+    AnalyticsEngine& operator=(const AnalyticsEngine&) = delete;
+
+    /**
+     * @brief Column types as sent by the FH (TP appends tpRecvTimeUtcNs)
+     *
+     * time, sym, vwap<w>s..., qty<w>s..., tradeCount<w>s...,
+     * imbalance, microprice, spread, fhRecvTimeUtcNs, analyticsNs
+     */
+    static std::vector<int> columnTypes(size_t numWindows) {
+        std::vector<int> types{KP, KS};
+        types.insert(types.end(), 2 * numWindows, KF);
+        types.insert(types.end(), numWindows, KJ);
+        types.insert(types.end(), {KF, KF, KF, KJ, KJ});
+        return types;
+    }
+
+    /// Symbol index for a name (-1 if unknown)
+    int indexOf(const std::string& sym) const { return symbols_.find(sym); }
+    int indexOf(const char* sym, size_t len) const { return symbols_.find(sym, len); }
+
+    /**
+     * @brief Add a trade to its symbol's windows and append a row
+     * @param symIdx Symbol index (ignored if < 0)
+     * @param tradeTimeNs Exchange trade time (ns since Unix epoch)
+     * @param fhRecvTimeUtcNs FH receive time (row time)
+     */
+    void onTrade(int symIdx, long long tradeTimeNs, double price, double qty,
+                 long long fhRecvTimeUtcNs) {
+        if (symIdx < 0) return;
+        const long long startNs = latency::nowNs();
+        addTrade(symIdx, tradeTimeNs, price, qty);
+        appendRow(symIdx, fhRecvTimeUtcNs, startNs, true);
+    }
+
+    /**
+     * @brief Update a symbol's quote metrics from its top Depth levels and append a row
+     * @param valid Book valid (metrics are null otherwise)
+     */
+    template<size_t Depth>
+    void onQuote(int symIdx,
+                 const std::array<double, Depth>& bidPrices,
+                 const std::array<double, Depth>& bidQtys,
+                 const std::array<double, Depth>& askPrices,
+                 const std::array<double, Depth>& askQtys,
+                 bool valid, long long fhRecvTimeUtcNs) {
+        if (symIdx < 0) return;
+        const long long startNs = latency::nowNs();
+        SymState& s = syms_[symIdx];
+        s.imbalance = s.microprice = s.spread = nf;
+
+        if (valid && bidQtys[0] > 0.0 && askQtys[0] > 0.0) {
+            double bidSum = 0.0;
+            double askSum = 0.0;
+            for (size_t i = 0; i < Depth; ++i) {
+                bidSum += bidQtys[i];
+                askSum += askQtys[i];
+            }
+            s.spread = askPrices[0] - bidPrices[0];
+            s.microprice = (bidPrices[0] * askQtys[0] + askPrices[0] * bidQtys[0])
+                         / (bidQtys[0] + askQtys[0]);
+            s.imbalance = (bidSum - askSum) / (bidSum + askSum);
+        }
+        appendRow(symIdx, fhRecvTimeUtcNs, startNs, false);
+    }
+
+    /// Rows waiting to be sent (flush with take() when full() or due())
+    ColumnBatch& batch() { return batch_; }
+
+    const std::string& table() const { return batch_.table(); }
+
+    /// Table name atom for sending the batch
+    SymAtom& tableAtom() { return tableAtom_; }
+
+private:
+    struct Trade {
+        long long timeNs;
+        double pxQty;
+        double qty;
+    };
+
+    /// Hot per-symbol state (one cache line)
+    struct alignas(64) SymState {
+        uint64_t tail = 0;          // Sequence of the next trade
+        uint64_t mask = INITIAL_RING - 1;
+        uint64_t sinceResum = 0;    // Trades since the last exact resum
+        double imbalance = nf;
+        double microprice = nf;
+        double spread = nf;
+    };
+
+    /// Trades inside one window of one symbol
+    struct WindowState {
+        uint64_t head = 0;          // Sequence of the oldest trade in the window
+        double sumPxQty = 0.0;
+        double sumQty = 0.0;
+    };
+
+    static std::vector<int> sortedWindows(std::vector<int> w) {
+        w.erase(std::remove_if(w.begin(), w.end(), [](int s) { return s <= 0; }), w.end());
+        std::sort(w.begin(), w.end());
+        w.erase(std::unique(w.begin(), w.end()), w.end());
+        return w;
+    }
+
+    WindowState& window(int symIdx, size_t w) { return windows_[symIdx * windowsSec_.size() + w]; }
+
+    void addTrade(int symIdx, long long timeNs, double price, double qty) {
+        if (windowsSec_.empty()) return;
+        SymState& s = syms_[symIdx];
+        std::vector<Trade>* ring = &rings_[symIdx];
+
+        // The longest window's head is the oldest trade still needed
+        if (s.tail - window(symIdx, windowsSec_.size() - 1).head == ring->size()) {
+            grow(symIdx);
+            ring = &rings_[symIdx];
+        }
+
+        const double pxQty = price * qty;
+        (*ring)[s.tail & s.mask] = Trade{timeNs, pxQty, qty};
+        ++s.tail;
+
+        for (size_t w = 0; w < windowsSec_.size(); ++w) {
+            WindowState& ws = window(symIdx, w);
+            ws.sumPxQty += pxQty;
+            ws.sumQty += qty;
+
+            const long long cutoff = timeNs - windowsNs_[w];
+            while (ws.head < s.tail && (*ring)[ws.head & s.mask].timeNs <= cutoff) {
+                const Trade& old = (*ring)[ws.head & s.mask];
+                ws.sumPxQty -= old.pxQty;
+                ws.sumQty -= old.qty;
+                ++ws.head;
+            }
+        }
+
+        if (++s.sinceResum >= ring->size()) {
+            resum(symIdx);
+        }
+    }
+
+    /// Recompute every window's sums from the ring
+    void resum(int symIdx) {
+        SymState& s = syms_[symIdx];
+        const std::vector<Trade>& ring = rings_[symIdx];
+        for (size_t w = 0; w < windowsSec_.size(); ++w) {
+            WindowState& ws = window(symIdx, w);
+            ws.sumPxQty = 0.0;
+            ws.sumQty = 0.0;
+            for (uint64_t i = ws.head; i < s.tail; ++i) {
+                ws.sumPxQty += ring[i & s.mask].pxQty;
+                ws.sumQty += ring[i & s.mask].qty;
+            }
+        }
+        s.sinceResum = 0;
+    }
+
+    /// Double a symbol's ring, keeping trades at their sequence positions
+    void grow(int symIdx) {
+        SymState& s = syms_[symIdx];
+        std::vector<Trade>& ring = rings_[symIdx];
+        std::vector<Trade> bigger(ring.size() * 2);
+        const uint64_t mask = bigger.size() - 1;
+        for (uint64_t i = window(symIdx, windowsSec_.size() - 1).head; i < s.tail; ++i) {
+            bigger[i & mask] = ring[i & s.mask];
+        }
+        ring.swap(bigger);
+        s.mask = mask;
+    }
+
+    void appendRow(int symIdx, long long fhRecvTimeUtcNs, long long startNs, bool tradeSide) {
+        const SymState& s = syms_[symIdx];
+        const int numWindows = static_cast<int>(windowsSec_.size());
+        const int metaCol = 2 + 3 * numWindows;
+
+        int r = batch_.beginRow();
+        batch_.setTimestamp(0, r, fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+        batch_.setInterned(1, r, interned_.sym(symIdx));
+        for (int w = 0; w < numWindows; ++w) {
+            const WindowState& ws = window(symIdx, w);
+            const bool any = tradeSide && ws.head < s.tail && ws.sumQty > 0.0;
+            batch_.setFloat(2 + w, r, any ? ws.sumPxQty / ws.sumQty : nf);
+            batch_.setFloat(2 + numWindows + w, r, tradeSide ? (any ? ws.sumQty : 0.0) : nf);
+            batch_.setLong(2 + 2 * numWindows + w, r,
+                tradeSide ? static_cast<long long>(s.tail - ws.head) : nj);
+        }
+        batch_.setFloat(metaCol, r, tradeSide ? nf : s.imbalance);
+        batch_.setFloat(metaCol + 1, r, tradeSide ? nf : s.microprice);
+        batch_.setFloat(metaCol + 2, r, tradeSide ? nf : s.spread);
+        batch_.setLong(metaCol + 3, r, fhRecvTimeUtcNs);
+        batch_.setLong(metaCol + 4, r, latency::nowNs() - startNs);
+    }
+
+    SymbolTable symbols_;
+    InternedSymbols interned_;
+    SymAtom tableAtom_;
+    std::vector<int> windowsSec_;               // Ascending, unique
+    std::vector<long long> windowsNs_;
+
+    std::vector<SymState> syms_;                // [numSymbols]
+    std::vector<WindowState> windows_;          // [numSymbols * numWindows]
+    std::vector<std::vector<Trade>> rings_;     // [numSymbols], power-of-two sizes
+
+    ColumnBatch batch_;
+};
+
+#endif // ANALYTICS_ENGINE_HPP
@@ -0,0 +1,430 @@
+/**
+ * @file binance_stream.hpp
+ * @brief Binance combined-stream connection shared by the handlers
+ *
+ * Owns what every handler needs from Binance: the TLS context, the
+ * io_context, connect/handshake, the read loop, the stop check, the
+ * graceful close and reconnection with exponential backoff. Handlers
+ * register on it instead of running their own loop:
+ *
+ *   - addStream(): streams to subscribe to ("btcusdt@trade")
+ *   - addRoute(): stream-dispatch table; frames whose stream name ends
+ *     with the route's suffix ("@trade", "@depth@100ms") go to its
+ *     handler (a single route skips the lookup)
+ *   - addTimer(): periodic callback on the loop, for the whole run
+ *   - onConnecting() / onLoop(): hooks for a new connection cycle (book
+ *     reset) and the loop (REST completions posted to it)
+ *
+ * Every step of a connection (resolve, TCP connect, TLS and WebSocket
+ * handshakes) is asynchronous with a CONNECT_TIMEOUT_SEC deadline, and
+ * the reconnect backoff is a timer wait, so nothing blocks the loop and
+ * the timers keep their cadence while Binance is unreachable.
+ *
+ * The per-stream handlers each create one when run standalone; the
+ * unified feed_handler runs one per worker with the trade and quote
+ * handlers attached to it, so both streams share a connection, a loop
+ * and a thread.
+ *
+ * Not thread-safe: register before run(), run() on one thread.
+ */
+
+#ifndef BINANCE_STREAM_HPP
+#define BINANCE_STREAM_HPP
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "periodic_timer.hpp"
+
+class BinanceStream {
+public:
+    /// Binance WebSocket host
+    static constexpr const char* HOST = "stream.binance.com";
+
+    /// Binance WebSocket port (TLS)
+    static constexpr const char* PORT = "9443";
+
+    /// Binance limit on streams per WebSocket connection
+    static constexpr int MAX_STREAMS = 1024;
+
+    /// Initial reconnection backoff (milliseconds)
+    static constexpr int INITIAL_BACKOFF_MS = 1000;
+
+    /// Maximum reconnection backoff (milliseconds)
+    static constexpr int MAX_BACKOFF_MS = 8000;
+
+    /// Backoff multiplier for exponential backoff
+    static constexpr int BACKOFF_MULTIPLIER = 2;
+
+    /// Stop-check period of the event loop (milliseconds)
+    static constexpr int STOP_CHECK_MS = 10;
+
+    /// Deadline of each connection step: resolve, connect, TLS, WebSocket (seconds)
+    static constexpr int CONNECT_TIMEOUT_SEC = 10;
+
+    /// Wait for the close handshake on shutdown (seconds)
+    static constexpr int CLOSE_TIMEOUT_SEC = 2;
+
+    /// Frame of a routed stream (NUL-terminated in the receive buffer, may
+    /// be parsed in place) with its wall-clock receive time
+    using FrameHandler = std::function<void(char* msg, size_t len, long long fhRecvTimeUtcNs)>;
+
+    /**
+     * @param running Cleared to stop: closes the connection, ends run()
+     * @param connState Updated with the connection state (static string literal)
+     */
+    BinanceStream(const std::atomic<bool>& running, std::atomic<const char*>& connState)
+        : running_(running)
+        , connState_(connState)
+        , ctx_(boost::asio::ssl::context::tlsv12_client)
+    {
+        ctx_.set_default_verify_paths();
+    }
+
+    // Non-copyable (registered callbacks refer to their owners)
+    BinanceStream(const BinanceStream&) = delete;
+    BinanceStream& operator=(const BinanceStream&) = delete;
+
+    // ========================================================================
+    // REGISTRATION (before run)
+    // ========================================================================
+
+    /// Subscribe to a stream (e.g. "btcusdt@depth@100ms")
+    void addStream(std::string name) { streams_.push_back(std::move(name)); }
+
+    /// Deliver frames of streams ending in suffix (e.g. "@trade") to onFrame
+    void addRoute(std::string suffix, FrameHandler onFrame) {
+        routes_.push_back(Route{std::move(suffix), std::move(onFrame)});
+    }
+
+    /// Call onTick every period while running (return false to stop it)
+    void addTimer(PeriodicTimer::Clock::duration period, std::function<bool()> onTick) {
+        timers_.push_back(TimerSpec{period, std::move(onTick)});
+    }
+
+    /// Called before the first connection attempt and whenever a
+    /// connection is lost or an attempt fails (before the backoff wait)
+    void onConnecting(std::function<void()> fn) { onConnecting_.push_back(std::move(fn)); }
+
+    /// Called with the loop once it runs, and nullptr when it ends
+    void onLoop(std::function<void(boost::asio::io_context*)> fn) { onLoop_.push_back(std::move(fn)); }
+
+    int streamCount() const { return static_cast<int>(streams_.size()); }
+
+    /// Frames that matched no route (multi-route only)
+    long long unrouted() const { return unrouted_; }
+
+    // ========================================================================
+    // RUN
+    // ========================================================================
+
+    /**
+     * @brief Connect and dispatch frames until stopped (blocking)
+     *
+     * Reconnects with exponential backoff when the connection is lost or
+     * an attempt fails; the timers run throughout.
+     */
+    void run() {
+        boost::asio::io_context ioc;
+        boost::asio::steady_timer retry{ioc};
+        ioc_ = &ioc;
+        retry_ = &retry;
+        attempt_ = 0;
+
+        // Registered timers, on a fixed cadence whether or not frames
+        // arrive or a connection is up
+        std::vector<std::unique_ptr<PeriodicTimer>> timers;
+        for (const TimerSpec& t : timers_) {
+            timers.push_back(std::make_unique<PeriodicTimer>(ioc, t.period, t.onTick));
+        }
+
+        PeriodicTimer stopCheck{ioc, std::chrono::milliseconds(STOP_CHECK_MS), [&] {
+            if (running_) return true;
+            for (auto& t : timers) t->cancel();
+            retry.cancel();
+            if (conn_) shutdown(conn_);
+            return false;
+        }};
+
+        // Owners see the loop while it runs (e.g. to post REST completions)
+        struct LoopScope {
+            BinanceStream* self;
+            ~LoopScope() {
+                for (auto& fn : self->onLoop_) fn(nullptr);
+                self->conn_.reset();
+                self->retry_ = nullptr;
+                self->ioc_ = nullptr;
+            }
+        } loopScope{this};
+        for (auto& fn : onLoop_) fn(&ioc);
+
+        for (auto& fn : onConnecting_) fn();
+        connect();
+        stopCheck.start();
+        for (auto& t : timers) t->start();
+        ioc.run();
+
+        connState_ = "disconnected";
+    }
+
+private:
+    using tcp = boost::asio::ip::tcp;
+    using WebSocket = boost::beast::websocket::stream<boost::beast::ssl_stream<tcp::socket>>;
+
+    struct Route {
+        std::string suffix;
+        FrameHandler onFrame;
+    };
+
+    struct TimerSpec {
+        PeriodicTimer::Clock::duration period;
+        std::function<bool()> onTick;
+    };
+
+    /// One connection attempt and, once open, its read loop. Handlers hold
+    /// a shared_ptr, so it outlives its last completion.
+    struct Connection {
+        Connection(boost::asio::io_context& ioc, boost::asio::ssl::context& ctx)
+            : resolver(ioc), ws(ioc, ctx), deadline(ioc) {}
+
+        tcp::resolver resolver;
+        WebSocket ws;
+        boost::asio::steady_timer deadline;  // Current step's timeout (or close guard)
+        int step{0};                         // Arms of the deadline (stale expiry check)
+        bool timedOut{false};
+        bool open{false};                    // WebSocket handshake done
+        bool closing{false};                 // Shut down by us
+
+        // Receive buffer reused across reads (no per-message allocation once
+        // its capacity has grown to the largest frame)
+        boost::beast::flat_buffer buffer;
+
+        /// Abort whatever is pending (completes with operation_aborted)
+        void abort() {
+            resolver.cancel();
+            boost::beast::error_code ignored;
+            boost::beast::get_lowest_layer(ws).close(ignored);
+        }
+    };
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    /// Combined stream path (e.g. "/stream?streams=btcusdt@trade/ethusdt@trade")
+    std::string buildPath() const {
+        std::string path = "/stream?streams=";
+        for (size_t i = 0; i < streams_.size(); ++i) {
+            if (i > 0) path += "/";
+            path += streams_[i];
+        }
+        return path;
+    }
+
+    /// Route a frame by its stream name ({"stream":"<name>","data":...})
+    void dispatch(char* msg, size_t len, long long fhRecvTimeUtcNs) {
+        if (routes_.size() == 1) {
+            routes_[0].onFrame(msg, len, fhRecvTimeUtcNs);
+            return;
+        }
+
+        // The name is the first value of the frame: no need to parse it
+        static constexpr char KEY[] = "\"stream\":\"";
+        constexpr size_t KEY_LEN = sizeof(KEY) - 1;
+        const char* name = std::strstr(msg, KEY);
+        if (name) {
+            name += KEY_LEN;
+            const char* end = std::strchr(name, '"');
+            if (end) {
+                const size_t nameLen = static_cast<size_t>(end - name);
+                for (Route& r : routes_) {
+                    if (nameLen >= r.suffix.size() &&
+                        std::memcmp(end - r.suffix.size(), r.suffix.data(), r.suffix.size()) == 0) {
+                        r.onFrame(msg, len, fhRecvTimeUtcNs);
+                        return;
+                    }
+                }
+            }
+        }
+        ++unrouted_;
+    }
+
+    // ========================================================================
+    // CONNECTION (all on the loop, none blocking)
+    // ========================================================================
+
+    /// Start a connection attempt: resolve -> connect -> TLS -> WebSocket
+    void connect() {
+        if (!running_) return;
+        const std::string target = buildPath();
+        spdlog::info("Connecting to Binance: {}{}", HOST, target);
+        connState_ = "connecting";
+
+        ConnectionPtr c = std::make_shared<Connection>(*ioc_, ctx_);
+        conn_ = c;
+
+        arm(c, CONNECT_TIMEOUT_SEC);
+        c->resolver.async_resolve(HOST, PORT,
+            [this, c, target](const boost::beast::error_code& ec, tcp::resolver::results_type results) {
+                if (failed(c, ec, "resolve")) return;
+                arm(c, CONNECT_TIMEOUT_SEC);
+                boost::asio::async_connect(boost::beast::get_lowest_layer(c->ws), results,
+                    [this, c, target](const boost::beast::error_code& ec, const tcp::endpoint&) {
+                        if (failed(c, ec, "connect")) return;
+                        arm(c, CONNECT_TIMEOUT_SEC);
+                        c->ws.next_layer().async_handshake(boost::asio::ssl::stream_base::client,
+                            [this, c, target](const boost::beast::error_code& ec) {
+                                if (failed(c, ec, "TLS handshake")) return;
+                                arm(c, CONNECT_TIMEOUT_SEC);
+                                c->ws.async_handshake(HOST, target,
+                                    [this, c](const boost::beast::error_code& ec) {
+                                        if (failed(c, ec, "WebSocket handshake")) return;
+                                        onOpen(c);
+                                    });
+                            });
+                    });
+            });
+    }
+
+    /// (Re)start the connection's deadline: on expiry the pending step is aborted
+    void arm(const ConnectionPtr& c, int seconds) {
+        const int step = ++c->step;
+        c->deadline.expires_after(std::chrono::seconds(seconds));
+        c->deadline.async_wait([c, step](const boost::beast::error_code& ec) {
+            if (ec || c->step != step) return;  // Cancelled or re-armed
+            c->timedOut = true;
+            c->abort();
+        });
+    }
+
+    /// Connection step completion: on error, log and reconnect (true)
+    bool failed(const ConnectionPtr& c, const boost::beast::error_code& ec, const char* step) {
+        if (!ec && !c->closing) return false;
+        ++c->step;
+        c->deadline.cancel();
+        if (c->closing || !running_) return true;  // Shutdown
+        if (c->timedOut) {
+            spdlog::error("Binance error: {} timed out after {}s", step, CONNECT_TIMEOUT_SEC);
+        } else {
+            spdlog::error("Binance error: {} failed: {}", step, ec.message());
+        }
+        lost(c);
+        return true;
+    }
+
+    /// Handshakes done: start reading
+    void onOpen(const ConnectionPtr& c) {
+        ++c->step;
+        c->deadline.cancel();
+        c->open = true;
+        spdlog::info("Connected to Binance ({} streams)", streams_.size());
+        connState_ = "connected";
+
+        // Reset backoff on successful connection
+        attempt_ = 0;
+        readNext(c);
+    }
+
+    /// Message loop: one outstanding async_read, re-armed per frame
+    void readNext(const ConnectionPtr& c) {
+        c->ws.async_read(c->buffer, [this, c](const boost::beast::error_code& ec, std::size_t) {
+            if (c->closing) return;
+            if (ec) {
+                if (!running_) return;  // Stop check closes it
+                spdlog::error("Binance error: {}", ec.message());
+                lost(c);
+                return;
+            }
+
+            // Capture wall-clock receive time (for cross-process correlation)
+            const long long recvNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            // NUL-terminate in place for in-situ parsing (no copy)
+            const size_t len = c->buffer.size();
+            auto tail = c->buffer.prepare(1);
+            static_cast<char*>(tail.data())[0] = '\0';
+            dispatch(static_cast<char*>(c->buffer.data().data()), len, recvNs);
+            c->buffer.consume(c->buffer.size());
+
+            readNext(c);
+        });
+    }
+
+    /// Connection lost or attempt failed: drop it, reconnect after the backoff
+    void lost(const ConnectionPtr& c) {
+        c->closing = true;
+        c->abort();
+        if (conn_ == c) conn_.reset();
+        connState_ = "disconnected";
+        for (auto& fn : onConnecting_) fn();
+
+        int delay = INITIAL_BACKOFF_MS;
+        for (int i = 0; i < attempt_ && delay < MAX_BACKOFF_MS; ++i) {
+            delay *= BACKOFF_MULTIPLIER;
+        }
+        delay = std::min(delay, MAX_BACKOFF_MS);
+        ++attempt_;
+
+        spdlog::info("Will reconnect...");
+        spdlog::info("Waiting {}ms before reconnect...", delay);
+        retry_->expires_after(std::chrono::milliseconds(delay));
+        retry_->async_wait([this](const boost::beast::error_code& ec) {
+            if (!ec) connect();
+        });
+    }
+
+    /// Stop: close an open connection gracefully, abort one still connecting
+    void shutdown(const ConnectionPtr& c) {
+        c->closing = true;
+        if (!c->open) {
+            ++c->step;
+            c->deadline.cancel();
+            c->abort();
+            spdlog::info("Connection closed during shutdown");
+            return;
+        }
+        c->ws.async_close(boost::beast::websocket::close_code::normal,
+            [c](const boost::beast::error_code& ec) {
+                if (!ec) spdlog::info("WebSocket closed gracefully");
+                ++c->step;
+                c->deadline.cancel();
+                c->abort();
+            });
+        // Peer may never answer the close frame
+        arm(c, CLOSE_TIMEOUT_SEC);
+    }
+
+    const std::atomic<bool>& running_;
+    std::atomic<const char*>& connState_;
+    boost::asio::ssl::context ctx_;
+
+    std::vector<std::string> streams_;
+    std::vector<Route> routes_;
+    std::vector<TimerSpec> timers_;
+    std::vector<std::function<void()>> onConnecting_;
+    std::vector<std::function<void(boost::asio::io_context*)>> onLoop_;
+    long long unrouted_{0};
+
+    // Valid during run()
+    boost::asio::io_context* ioc_{nullptr};
+    boost::asio::steady_timer* retry_{nullptr};
+    ConnectionPtr conn_;
+    int attempt_{0};
+};
+
+#endif // BINANCE_STREAM_HPP
@@ -0,0 +1,336 @@
+/**
+ * @file book_checkpoint.hpp
+ * @brief Memory-mapped checkpoint of the quote handler's books for warm restarts
+ *
+ * The quote handler copies every VALID book (levels, lastUpdateId, event
+ * time, scale) into a checkpoint file on a timer and at shutdown. On the
+ * next start the books are restored from it in SYNCING state with the
+ * checkpoint's lastUpdateId as their snapshot id, so the first delta is
+ * checked exactly as after a REST snapshot (U <= lastUpdateId+1 <= u):
+ * if the stream lines up the book is VALID without a REST request,
+ * otherwise it falls back to the REST snapshot path.
+ *
+ * Layout:
+ *   [0, 64)      Header: magic, version, depth, image size, record count,
+ *                price representation, active slot, save time per slot
+ *   [64, ...)    Two slots of numRecords records each:
+ *                  [char symbol[20]][uint32 valid][uint64 checksum][book image]
+ *
+ * A save fills the slot that is not active and then publishes it by
+ * storing its index in the header, so a process killed mid-save leaves
+ * the previous checkpoint intact. Each record carries a checksum of its
+ * image, and a restored book still has to line up with the stream.
+ *
+ * The writer reopens a file of the same layout without truncating it, so
+ * the save a restart restored from survives until the first new save.
+ *
+ * Records are matched by symbol on restore, so a changed symbol list or
+ * shard assignment only loses the symbols that moved. A file written by
+ * another book depth or price representation is ignored.
+ *
+ * Not thread-safe: one writer (the handler's loop thread), read at startup.
+ */
+
+#ifndef BOOK_CHECKPOINT_HPP
+#define BOOK_CHECKPOINT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace checkpoint {
+
+constexpr uint64_t MAGIC = 0x31304b4f4f424846ULL;  // "FHBOOK01"
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t SYMBOL_BYTES = 20;     // NUL-terminated; longer symbols are not saved
+constexpr size_t REP_BYTES = 8;
+constexpr uint32_t NO_SLOT = 0xffffffffu;
+
+struct FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t depth;                 // Levels per side
+    uint32_t imageBytes;            // Book image size
+    uint32_t numRecords;            // Records per slot
+    char rep[REP_BYTES];            // Price representation ("double", "ticks")
+    std::atomic<uint32_t> active;   // Slot of the last complete save (NO_SLOT: none yet)
+    uint32_t reserved;
+    int64_t savedAtUtcNs[2];        // Save time per slot
+};
+static_assert(sizeof(FileHeader) <= HEADER_SIZE, "checkpoint header exceeds its slot");
+
+struct RecordHeader {
+    char symbol[SYMBOL_BYTES];
+    uint32_t valid;                 // 0: book was not VALID when saved
+    uint64_t checksum;              // FNV-1a of the image
+};
+static_assert(sizeof(RecordHeader) == 32, "unexpected record header size");
+
+inline size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+inline uint64_t checksum(const uint8_t* p, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Saves book images into a checkpoint file
+ */
+class Writer {
+public:
+    Writer() = default;
+    ~Writer() { close(); }
+
+    // Non-copyable (owns the mapping)
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /**
+     * @brief Open the file at path (creating it and its parent directory)
+     *
+     * A file with the same layout (depth, price representation, image
+     * size and symbols in the same order) is reused as is, so its last
+     * complete save stays restorable until the next save replaces it;
+     * anything else is reset to an empty checkpoint.
+     *
+     * @param symbols Record i holds the book of symbols[i]
+     * @return false with errno set on failure
+     */
+    bool open(const std::string& path, int depth, const char* rep, size_t imageBytes,
+              const std::vector<std::string>& symbols) {
+        close();
+        const size_t slash = path.rfind('/');
+        if (slash != std::string::npos && slash > 0) {
+            ::mkdir(path.substr(0, slash).c_str(), 0755);  // EEXIST is fine
+        }
+        imageBytes_ = imageBytes;
+        recordSize_ = align8(sizeof(RecordHeader) + imageBytes);
+        numRecords_ = symbols.size();
+        size_ = HEADER_SIZE + 2 * numRecords_ * recordSize_;
+        reused_ = false;
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            close();
+            return false;
+        }
+        const bool sameSize = static_cast<size_t>(st.st_size) == size_;
+        // Another layout: drop the old contents so every record reads as empty
+        if (!sameSize && (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, static_cast<off_t>(size_)) != 0)) {
+            close();
+            return false;
+        }
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base_ = static_cast<uint8_t*>(p);
+
+        if (sameSize && sameLayout(depth, rep, symbols)) {
+            reused_ = true;
+            return true;
+        }
+        if (sameSize) {
+            std::memset(base_, 0, size_);
+        }
+        FileHeader* h = header();
+        h->magic = MAGIC;
+        h->version = VERSION;
+        h->depth = static_cast<uint32_t>(depth);
+        h->imageBytes = static_cast<uint32_t>(imageBytes);
+        h->numRecords = static_cast<uint32_t>(numRecords_);
+        std::strncpy(h->rep, rep, REP_BYTES - 1);
+        h->active.store(NO_SLOT, std::memory_order_release);
+        for (int slot = 0; slot < 2; ++slot) {
+            for (size_t i = 0; i < numRecords_; ++i) {
+                if (symbols[i].size() < SYMBOL_BYTES) {
+                    std::memcpy(record(slot, i)->symbol, symbols[i].c_str(), symbols[i].size() + 1);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    /**
+     * @brief Save every record into the inactive slot, then make it active
+     * @param fill fill(i, image) copies book i into image (imageBytes);
+     *        false if the book is not worth restoring
+     * @return Records saved as valid
+     */
+    template<typename Fill>
+    int save(long long nowUtcNs, Fill&& fill) {
+        if (!base_) return 0;
+        FileHeader* h = header();
+        const uint32_t slot = h->active.load(std::memory_order_relaxed) == 0 ? 1 : 0;
+        int saved = 0;
+        for (size_t i = 0; i < numRecords_; ++i) {
+            RecordHeader* rh = record(slot, i);
+            if (rh->symbol[0] == '\0') continue;
+            uint8_t* image = reinterpret_cast<uint8_t*>(rh) + sizeof(RecordHeader);
+            rh->valid = fill(static_cast<int>(i), image) ? 1 : 0;
+            if (rh->valid) {
+                rh->checksum = checksum(image, imageBytes_);
+                ++saved;
+            }
+        }
+        h->savedAtUtcNs[slot] = nowUtcNs;
+        h->active.store(slot, std::memory_order_release);
+        ++saves_;
+        return saved;
+    }
+
+    void close() {
+        if (base_) {
+            ::munmap(base_, size_);
+            base_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    long long saves() const { return saves_; }
+
+    /// open() kept the previous contents (same layout)
+    bool reused() const { return reused_; }
+
+private:
+    FileHeader* header() { return reinterpret_cast<FileHeader*>(base_); }
+
+    /// Mapped file was written with this layout and these symbols, in order
+    bool sameLayout(int depth, const char* rep, const std::vector<std::string>& symbols) {
+        const FileHeader* h = header();
+        char repField[REP_BYTES] = {};
+        std::strncpy(repField, rep, REP_BYTES - 1);
+        if (h->magic != MAGIC || h->version != VERSION || h->depth != static_cast<uint32_t>(depth) ||
+            h->imageBytes != imageBytes_ || h->numRecords != numRecords_ ||
+            std::memcmp(h->rep, repField, REP_BYTES) != 0) {
+            return false;
+        }
+        for (uint32_t slot = 0; slot < 2; ++slot) {
+            for (size_t i = 0; i < numRecords_; ++i) {
+                const char* saved = record(slot, i)->symbol;
+                const bool expected = symbols[i].size() < SYMBOL_BYTES
+                    ? std::memcmp(saved, symbols[i].c_str(), symbols[i].size() + 1) == 0
+                    : saved[0] == '\0';
+                if (!expected) return false;
+            }
+        }
+        return true;
+    }
+
+    RecordHeader* record(uint32_t slot, size_t i) {
+        return reinterpret_cast<RecordHeader*>(
+            base_ + HEADER_SIZE + (slot * numRecords_ + i) * recordSize_);
+    }
+
+    int fd_{-1};
+    uint8_t* base_{nullptr};
+    size_t size_{0};
+    size_t imageBytes_{0};
+    size_t recordSize_{0};
+    size_t numRecords_{0};
+    long long saves_{0};
+    bool reused_{false};
+};
+
+/**
+ * @brief Reads the last complete save of a checkpoint file
+ */
+class Reader {
+public:
+    Reader() = default;
+    ~Reader() { close(); }
+
+    // Non-copyable (owns the mapping)
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /// Map the file read-only; false if missing, not a checkpoint or never saved
+    bool open(const std::string& path) {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<const uint8_t*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+
+        const FileHeader* h = header();
+        slot_ = h->active.load(std::memory_order_acquire);
+        recordSize_ = align8(sizeof(RecordHeader) + h->imageBytes);
+        if (h->magic != MAGIC || h->version != VERSION || slot_ > 1 ||
+            HEADER_SIZE + 2 * size_t{h->numRecords} * recordSize_ > size_) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base_) {
+            ::munmap(const_cast<uint8_t*>(base_), size_);
+            base_ = nullptr;
+        }
+        size_ = 0;
+    }
+
+    /// Written with the same book depth, price representation and image size
+    bool matches(int depth, const char* rep, size_t imageBytes) const {
+        const FileHeader* h = header();
+        return h->depth == static_cast<uint32_t>(depth) && h->imageBytes == imageBytes &&
+               std::strncmp(h->rep, rep, REP_BYTES) == 0;
+    }
+
+    long long savedAtUtcNs() const { return header()->savedAtUtcNs[slot_]; }
+    int numRecords() const { return static_cast<int>(header()->numRecords); }
+
+    /**
+     * @brief Record i of the active slot
+     * @return false if it was not valid when saved or fails its checksum
+     */
+    bool record(int i, std::string& symbol, const uint8_t*& image) const {
+        const auto* rh = reinterpret_cast<const RecordHeader*>(
+            base_ + HEADER_SIZE + (slot_ * size_t{header()->numRecords} + static_cast<size_t>(i)) * recordSize_);
+        if (!rh->valid || rh->symbol[SYMBOL_BYTES - 1] != '\0') return false;
+        image = reinterpret_cast<const uint8_t*>(rh) + sizeof(RecordHeader);
+        if (checksum(image, header()->imageBytes) != rh->checksum) return false;
+        symbol = rh->symbol;
+        return true;
+    }
+
+private:
+    const FileHeader* header() const { return reinterpret_cast<const FileHeader*>(base_); }
+
+    const uint8_t* base_{nullptr};
+    size_t size_{0};
+    size_t recordSize_{0};
+    uint32_t slot_{NO_SLOT};
+};
+
+} // namespace checkpoint
+
+#endif // BOOK_CHECKPOINT_HPP
@@ -0,0 +1,234 @@
+/**
+ * @file book_kernels.hpp
+ * @brief Level search and shift kernels for OrderBookManager
+ *
+ * applyLevelUpdate() needs, for one side of one symbol's book:
+ *   - the index of an existing level at the update price, or
+ *   - the insertion point that keeps the side sorted
+ *     (bids high→low, asks low→high, empty slots = price 0 at the tail)
+ * followed by a shift of the levels below it.
+ *
+ * Kernels:
+ *   scalar::findLevel  - reference loop (original implementation)
+ *   simd::findLevel    - AVX2 (4 lanes) or NEON (2 lanes) compare + mask,
+ *                        for int64 ticks and double prices
+ *   removeAt/insertAt  - memmove shifts
+ *
+ * findLevel() picks the SIMD kernel at compile time when the target has
+ * AVX2 (-mavx2, CMake FH_ENABLE_AVX2) or AArch64 NEON, and the scalar
+ * loop otherwise. Define FH_SCALAR_BOOK_KERNELS to force scalar.
+ *
+ * A level's price is non-zero exactly when its qty is non-zero (zero-qty
+ * updates delete), so matching on price alone is sufficient.
+ *
+ * @see bench/book_kernel_bench.cpp
+ */
+
+#ifndef BOOK_KERNELS_HPP
+#define BOOK_KERNELS_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#if !defined(FH_SCALAR_BOOK_KERNELS) && defined(__AVX2__)
+#include <immintrin.h>
+#define FH_BOOK_KERNELS_AVX2 1
+#elif !defined(FH_SCALAR_BOOK_KERNELS) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FH_BOOK_KERNELS_NEON 1
+#endif
+
+namespace book_kernels {
+
+/**
+ * @brief Result of a level search on one side of the book
+ */
+struct LevelSearch {
+    int existing;   // Index of level at the update price, -1 if none
+    int insert;     // First index the price sorts before, n if beyond depth
+};
+
+// ============================================================================
+// SCALAR
+// ============================================================================
+
+namespace scalar {
+
+/**
+ * @brief Continue a level search from index i (used for SIMD tails)
+ */
+template<typename Value>
+inline LevelSearch findFrom(const Value* prices, int i, int n, Value price,
+                            bool isBid, int insert) {
+    for (; i < n; ++i) {
+        if (prices[i] == price) {
+            return {i, insert};
+        }
+        if (insert == n &&
+            (prices[i] == 0 || (isBid ? price > prices[i] : price < prices[i]))) {
+            insert = i;
+        }
+    }
+    return {-1, insert};
+}
+
+template<typename Value>
+inline LevelSearch findLevel(const Value* prices, int n, Value price, bool isBid) {
+    return findFrom(prices, 0, n, price, isBid, n);
+}
+
+} // namespace scalar
+
+// ============================================================================
+// SIMD
+// ============================================================================
+
+namespace simd {
+
+#if defined(FH_BOOK_KERNELS_AVX2)
+
+inline LevelSearch findLevel(const int64_t* prices, int n, int64_t price, bool isBid) {
+    const __m256i key = _mm256_set1_epi64x(price);
+    const __m256i zero = _mm256_setzero_si256();
+    int insert = n;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + i));
+        const int eq = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(p, key)));
+        if (eq) {
+            return {i + __builtin_ctz(eq), insert};
+        }
+        if (insert == n) {
+            const __m256i better = isBid ? _mm256_cmpgt_epi64(key, p) : _mm256_cmpgt_epi64(p, key);
+            const int ins = _mm256_movemask_pd(_mm256_castsi256_pd(
+                _mm256_or_si256(better, _mm256_cmpeq_epi64(p, zero))));
+            if (ins) insert = i + __builtin_ctz(ins);
+        }
+    }
+    return scalar::findFrom(prices, i, n, price, isBid, insert);
+}
+
+inline LevelSearch findLevel(const double* prices, int n, double price, bool isBid) {
+    const __m256d key = _mm256_set1_pd(price);
+    const __m256d zero = _mm256_setzero_pd();
+    int insert = n;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d p = _mm256_loadu_pd(prices + i);
+        const int eq = _mm256_movemask_pd(_mm256_cmp_pd(p, key, _CMP_EQ_OQ));
+        if (eq) {
+            return {i + __builtin_ctz(eq), insert};
+        }
+        if (insert == n) {
+            const __m256d better = isBid ? _mm256_cmp_pd(key, p, _CMP_GT_OQ)
+                                         : _mm256_cmp_pd(p, key, _CMP_GT_OQ);
+            const int ins = _mm256_movemask_pd(
+                _mm256_or_pd(better, _mm256_cmp_pd(p, zero, _CMP_EQ_OQ)));
+            if (ins) insert = i + __builtin_ctz(ins);
+        }
+    }
+    return scalar::findFrom(prices, i, n, price, isBid, insert);
+}
+
+#elif defined(FH_BOOK_KERNELS_NEON)
+
+/// Lane index of the first set lane of a 2 x 64-bit mask, -1 if none
+inline int firstLane(uint64x2_t m) {
+    if (vgetq_lane_u64(m, 0)) return 0;
+    if (vgetq_lane_u64(m, 1)) return 1;
+    return -1;
+}
+
+inline LevelSearch findLevel(const int64_t* prices, int n, int64_t price, bool isBid) {
+    const int64x2_t key = vdupq_n_s64(price);
+    const int64x2_t zero = vdupq_n_s64(0);
+    int insert = n;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const int64x2_t p = vld1q_s64(prices + i);
+        const int eq = firstLane(vceqq_s64(p, key));
+        if (eq >= 0) {
+            return {i + eq, insert};
+        }
+        if (insert == n) {
+            const uint64x2_t better = isBid ? vcgtq_s64(key, p) : vcgtq_s64(p, key);
+            const int ins = firstLane(vorrq_u64(better, vceqq_s64(p, zero)));
+            if (ins >= 0) insert = i + ins;
+        }
+    }
+    return scalar::findFrom(prices, i, n, price, isBid, insert);
+}
+
+inline LevelSearch findLevel(const double* prices, int n, double price, bool isBid) {
+    const float64x2_t key = vdupq_n_f64(price);
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    int insert = n;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const float64x2_t p = vld1q_f64(prices + i);
+        const int eq = firstLane(vceqq_f64(p, key));
+        if (eq >= 0) {
+            return {i + eq, insert};
+        }
+        if (insert == n) {
+            const uint64x2_t better = isBid ? vcgtq_f64(key, p) : vcgtq_f64(p, key);
+            const int ins = firstLane(vorrq_u64(better, vceqq_f64(p, zero)));
+            if (ins >= 0) insert = i + ins;
+        }
+    }
+    return scalar::findFrom(prices, i, n, price, isBid, insert);
+}
+
+#else
+
+template<typename Value>
+inline LevelSearch findLevel(const Value* prices, int n, Value price, bool isBid) {
+    return scalar::findLevel(prices, n, price, isBid);
+}
+
+#endif
+
+} // namespace simd
+
+/// Name of the kernel selected at compile time (for logs/benchmarks)
+#if defined(FH_BOOK_KERNELS_AVX2)
+constexpr const char* KERNEL_NAME = "avx2";
+#elif defined(FH_BOOK_KERNELS_NEON)
+constexpr const char* KERNEL_NAME = "neon";
+#else
+constexpr const char* KERNEL_NAME = "scalar";
+#endif
+
+/**
+ * @brief Find existing level or insertion point (best kernel for target)
+ */
+template<typename Value>
+inline LevelSearch findLevel(const Value* prices, int n, Value price, bool isBid) {
+    return simd::findLevel(prices, n, price, isBid);
+}
+
+// ============================================================================
+// SHIFTS
+// ============================================================================
+
+/**
+ * @brief Remove element idx, shifting the rest up and clearing the last slot
+ */
+template<typename Value>
+inline void removeAt(Value* a, int n, int idx) {
+    std::memmove(a + idx, a + idx + 1, static_cast<size_t>(n - idx - 1) * sizeof(Value));
+    a[n - 1] = Value{};
+}
+
+/**
+ * @brief Insert v at idx, shifting the rest down (last element dropped)
+ */
+template<typename Value>
+inline void insertAt(Value* a, int n, int idx, Value v) {
+    std::memmove(a + idx + 1, a + idx, static_cast<size_t>(n - idx - 1) * sizeof(Value));
+    a[idx] = v;
+}
+
+} // namespace book_kernels
+
+#endif // BOOK_KERNELS_HPP
@@ -0,0 +1,313 @@
+/**
+ * @file capture_file.hpp
+ * @brief Append-only memory-mapped capture of raw feed input for replay
+ *
+ * A handler with capture enabled copies every WebSocket frame (before the
+ * in-situ parser touches it), with its fhRecvTimeUtcNs, into a capture
+ * file. The quote handler also records the REST inputs its books depend
+ * on (exchangeInfo scales, books restored from a checkpoint and each
+ * snapshot as it is applied) and each reconnect's book reset, so a replay
+ * reproduces the same book states without network access.
+ *
+ * Layout:
+ *   [0, 64)      Header: magic, version, committed end offset
+ *   [64, ...)    Records, 8-byte aligned:
+ *                  [uint32 length][uint16 type][uint16 pad][int64 fhRecvTimeUtcNs][payload]
+ *
+ * The writer maps the file in chunks (CaptureConfig::chunkMb, grown with
+ * ftruncate and mremap) so appending is a memcpy. reserveAhead(), called
+ * from the handler's timer every RESERVE_CHECK_MS, adds the next chunk
+ * once less than half of one is left, so append() normally never grows
+ * the file itself. The committed end
+ * is stored after each record, so a file cut short by a crash is read up
+ * to its last complete record. close() trims the file to that end.
+ *
+ * Not thread-safe: one writer (the handler's loop thread), any readers
+ * after it closed.
+ */
+
+#ifndef CAPTURE_FILE_HPP
+#define CAPTURE_FILE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace capture {
+
+/// Record types
+enum RecordType : uint16_t {
+    REC_FRAME = 1,      // WebSocket frame (payload = frame bytes)
+    REC_SCALE = 2,      // "SYMBOL tickSize stepSize" (quote handler, startup)
+    REC_SNAPSHOT = 3,   // Snapshot as applied: "SYMBOL lastUpdateId ok nBids nAsks" + "price qty" lines
+    REC_RESET = 4,      // All books reset (quote handler, each WebSocket connect; no payload)
+    REC_CHECKPOINT = 5, // Book restored at startup: "SYMBOL lastUpdateId exchEventTimeMs nBids nAsks" + "price qty" lines
+};
+
+constexpr uint64_t MAGIC = 0x3130545041434846ULL;  // "FHCAPT01"
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t RECORD_HEADER = 16;
+constexpr int RESERVE_CHECK_MS = 100;   // reserveAhead() cadence
+
+inline size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+struct FileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    std::atomic<uint64_t> end;      // Committed end offset (bytes)
+};
+static_assert(sizeof(FileHeader) <= HEADER_SIZE, "capture header exceeds its slot");
+
+struct RecordHeader {
+    uint32_t length;
+    uint16_t type;
+    uint16_t pad;
+    int64_t fhRecvTimeUtcNs;
+};
+static_assert(sizeof(RecordHeader) == RECORD_HEADER, "unexpected record header size");
+
+/**
+ * @brief Appends records to a capture file
+ */
+class Writer {
+public:
+    Writer() = default;
+    ~Writer() { close(); }
+
+    // Non-copyable (owns the mapping)
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /**
+     * @brief Create (truncate) the file at path (and its parent directory)
+     * @param chunkBytes Mapping growth step (rounded up to 1 MiB)
+     * @return false with errno set on failure
+     */
+    bool open(const std::string& path, size_t chunkBytes) {
+        close();
+        const size_t slash = path.rfind('/');
+        if (slash != std::string::npos && slash > 0) {
+            ::mkdir(path.substr(0, slash).c_str(), 0755);  // EEXIST is fine
+        }
+        chunk_ = ((chunkBytes + (1u << 20) - 1) >> 20) << 20;
+        if (chunk_ == 0) chunk_ = 1u << 20;
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return false;
+        if (!grow(chunk_)) {
+            close();
+            return false;
+        }
+        header()->magic = MAGIC;
+        header()->version = 1;
+        header()->end.store(HEADER_SIZE, std::memory_order_release);
+        end_ = HEADER_SIZE;
+        return true;
+    }
+
+    bool isOpen() const { return base_ != nullptr; }
+
+    /**
+     * @brief Append one record
+     * @return false if the file could not grow (capture stops)
+     */
+    bool append(RecordType type, long long fhRecvTimeUtcNs, const void* data, size_t len) {
+        if (!base_) return false;
+        const size_t need = RECORD_HEADER + align8(len);
+        if (end_ + need > size_ && !grow(((end_ + need - size_) / chunk_ + 1) * chunk_)) {
+            close();
+            return false;
+        }
+        RecordHeader rh{static_cast<uint32_t>(len), type, 0, fhRecvTimeUtcNs};
+        std::memcpy(base_ + end_, &rh, sizeof(rh));
+        std::memcpy(base_ + end_ + RECORD_HEADER, data, len);
+        end_ += need;
+        header()->end.store(end_, std::memory_order_release);
+        ++records_;
+        return true;
+    }
+
+    /**
+     * @brief Add the next chunk once less than half a chunk is left
+     *
+     * Call from a timer: keeps ftruncate/mremap off the frame path.
+     * @return false if the capture is closed (could not grow)
+     */
+    bool reserveAhead() {
+        if (!base_) return false;
+        if (size_ - end_ >= chunk_ / 2) return true;
+        if (!grow(chunk_)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// Unmap and trim the file to the committed end
+    void close() {
+        if (base_) {
+            ::munmap(base_, size_);
+            base_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            if (end_ > 0 && ::ftruncate(fd_, static_cast<off_t>(end_)) != 0) {}
+            ::close(fd_);
+            fd_ = -1;
+        }
+        size_ = 0;
+    }
+
+    long long records() const { return records_; }
+    size_t bytes() const { return end_; }
+
+private:
+    FileHeader* header() { return reinterpret_cast<FileHeader*>(base_); }
+
+    /// Extend the file by add bytes and remap it whole
+    bool grow(size_t add) {
+        const size_t newSize = size_ + add;
+        if (::ftruncate(fd_, static_cast<off_t>(newSize)) != 0) return false;
+        void* p = base_
+            ? ::mremap(base_, size_, newSize, MREMAP_MAYMOVE)
+            : ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<uint8_t*>(p);
+        // Hint only: each new page is faulted in by its first write (a
+        // minor fault), not by touching the whole chunk here, which would
+        // stall the caller for milliseconds
+        ::madvise(base_ + size_, add, MADV_WILLNEED);
+        size_ = newSize;
+        return true;
+    }
+
+    int fd_{-1};
+    uint8_t* base_{nullptr};
+    size_t size_{0};
+    size_t end_{0};
+    size_t chunk_{0};
+    long long records_{0};
+};
+
+/**
+ * @brief Reads the records of a capture file in order
+ */
+class Reader {
+public:
+    struct Record {
+        RecordType type;
+        long long fhRecvTimeUtcNs;
+        const uint8_t* data;
+        size_t length;
+    };
+
+    Reader() = default;
+    ~Reader() { close(); }
+
+    // Non-copyable (owns the mapping)
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /// Map the file read-only; false if missing or not a capture file
+    bool open(const std::string& path) {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<const uint8_t*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+        const auto* h = reinterpret_cast<const FileHeader*>(base_);
+        if (h->magic != MAGIC) {
+            close();
+            return false;
+        }
+        ::madvise(const_cast<uint8_t*>(base_), size_, MADV_SEQUENTIAL);
+        end_ = std::min<size_t>(h->end.load(std::memory_order_acquire), size_);
+        pos_ = HEADER_SIZE;
+        return true;
+    }
+
+    void close() {
+        if (base_) {
+            ::munmap(const_cast<uint8_t*>(base_), size_);
+            base_ = nullptr;
+        }
+        size_ = end_ = pos_ = 0;
+    }
+
+    /// Next record; false at the end (or at a truncated record)
+    bool next(Record& r) {
+        if (pos_ + RECORD_HEADER > end_) return false;
+        RecordHeader rh;
+        std::memcpy(&rh, base_ + pos_, sizeof(rh));
+        const size_t need = RECORD_HEADER + align8(rh.length);
+        if (pos_ + need > end_) return false;
+        r.type = static_cast<RecordType>(rh.type);
+        r.fhRecvTimeUtcNs = rh.fhRecvTimeUtcNs;
+        r.data = base_ + pos_ + RECORD_HEADER;
+        r.length = rh.length;
+        pos_ += need;
+        return true;
+    }
+
+    /// Back to the first record
+    void rewind() { pos_ = HEADER_SIZE; }
+
+    size_t bytes() const { return end_; }
+
+private:
+    const uint8_t* base_{nullptr};
+    size_t size_{0};
+    size_t end_{0};
+    size_t pos_{0};
+};
+
+/**
+ * @brief Paces replayed records to their recorded spacing / speed
+ */
+class Pacer {
+public:
+    /// @param speed Multiple of the recorded rate (0 = no pacing)
+    explicit Pacer(double speed) : speed_(speed) {}
+
+    /// Sleep until the record's replay time (first call starts the clock)
+    void wait(long long fhRecvTimeUtcNs) {
+        if (speed_ <= 0) return;
+        const auto now = std::chrono::steady_clock::now();
+        if (firstNs_ < 0) {
+            firstNs_ = fhRecvTimeUtcNs;
+            start_ = now;
+            return;
+        }
+        const auto target = start_ + std::chrono::nanoseconds(
+            static_cast<long long>((fhRecvTimeUtcNs - firstNs_) / speed_));
+        if (target > now) {
+            std::this_thread::sleep_until(target);
+        }
+    }
+
+private:
+    double speed_;
+    long long firstNs_{-1};
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace capture
+
+#endif // CAPTURE_FILE_HPP
@@ -11,8 +11,215 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 #include <rapidjson/document.h>
 
+/**
+ * @brief Reader/publisher pipeline settings (trade handler)
+ *
+ * When enabled, the WebSocket reader thread pushes preparsed records into
+ * a bounded SPSC ring and a dedicated publisher thread owns the TP handle.
+ */
+struct PipelineConfig {
+    bool enabled = false;
+    int queueCapacity = 65536;      // Rounded up to power of two
+    int readerCpu = -1;             // -1 = unpinned
+    int publisherCpu = -1;          // -1 = unpinned
+};
+
+/**
+ * @brief Columnar batch publishing settings (both handlers)
+ *
+ * When enabled, rows are collected into typed column vectors and sent as
+ * one `.u.upd` call per maxRows rows or maxDelayUs microseconds.
+ */
+struct BatchConfig {
+    bool enabled = false;
+    int maxRows = 100;
+    long long maxDelayUs = 1000;
+};
+
+/**
+ * @brief REST snapshot client settings (quote handler)
+ *
+ * Snapshots are fetched by a pool of workers, each holding one persistent
+ * keep-alive connection. Requests are charged against a weight budget
+ * below Binance's 6000/min IP limit.
+ */
+struct RestConfig {
+    int workers = 4;                // 0 = synchronous fetch on book thread
+    int maxWeightPerMinute = 3000;
+};
+
+/**
+ * @brief Sharded quote handler settings (quote handler)
+ *
+ * Symbols are split round-robin across shards. Each shard has its own
+ * WebSocket connection, thread and book; all shards publish through one
+ * shared batched TP publisher thread. shards is raised automatically so
+ * that no connection exceeds Binance's per-connection stream limit.
+ */
+struct ShardConfig {
+    int shards = 1;                 // 1 = unsharded (single handler thread)
+    std::vector<int> cpus;          // Shard i pinned to cpus[i] (missing/-1 = unpinned)
+    int publisherCpu = -1;          // -1 = unpinned
+    int queueCapacity = 65536;      // Per-shard quote ring (rounded up to power of two)
+};
+
+/**
+ * @brief In-process analytics stage settings (both handlers)
+ *
+ * When enabled, the handler computes per-symbol analytics as it publishes
+ * (rolling VWAP in the trade handler; imbalance, microprice and spread in
+ * the quote handler) and sends them to the analytics table. vwapWindowsSec
+ * must match the TP's -analyticsWindows (it sets the table's columns).
+ */
+struct AnalyticsConfig {
+    bool enabled = false;
+    std::vector<int> vwapWindowsSec{60, 300};
+    std::string table = "analytics_binance";
+};
+
+/**
+ * @brief Shared-memory transport to the TP (both handlers)
+ *
+ * When enabled, market data updates are written to the ring the TP
+ * created at path (tp.q -shm) instead of the TCP handle, which stays open
+ * for health rows and as the fallback when the ring is missing or full.
+ */
+struct ShmConfig {
+    bool enabled = false;
+    std::string path;               // Must match one of the TP's -shm paths
+    int spinUs = 200;               // Wait this long for ring space before falling back to TCP
+};
+
+/**
+ * @brief Quote conflation settings (quote handler)
+ *
+ * When enabled, a book change marks the symbol dirty instead of being
+ * published at once; dirty symbols are published with their latest state
+ * every intervalUs, and as soon as the downstream queue (TP socket, shm
+ * ring or shard ring) is empty when flushOnIdle is set. At most one
+ * pending quote per symbol exists. criticalSymbols keep per-tick publishing.
+ */
+struct ConflationConfig {
+    bool enabled = false;
+    long long intervalUs = 10000;   // Flush cadence
+    bool flushOnIdle = true;        // Also flush whenever downstream has drained
+    std::vector<std::string> criticalSymbols;  // Lowercase, as in "symbols"
+};
+
+/**
+ * @brief Outbound backlog while the TP is unreachable (both handlers)
+ *
+ * A failed TP send no longer reconnects inline: updates are serialised
+ * into an in-memory queue of up to queueMb while a background thread
+ * reconnects, then replayed in order. Past queueMb they are appended to
+ * spillPath (spillEnabled, up to spillMaxMb); beyond that they are dropped
+ * and counted in health.
+ */
+struct OutboundConfig {
+    int queueMb = 64;
+    bool spillEnabled = false;
+    std::string spillPath;          // Truncated when the first update spills
+    int spillMaxMb = 1024;
+};
+
+/**
+ * @brief Raw input capture for offline replay (both handlers)
+ *
+ * When enabled, every WebSocket frame (and, in the quote handler, the
+ * exchangeInfo scales and each applied snapshot) is appended to path with
+ * its receive time; feed it back with --replay (see ReplayOptions).
+ * Shard i writes <path>.s<i>.
+ */
+struct CaptureConfig {
+    bool enabled = false;
+    std::string path;
+    int chunkMb = 64;               // File grows (and is mapped) in steps of this size
+};
+
+/**
+ * @brief Book checkpoint for warm restarts (quote handler)
+ *
+ * When enabled, every VALID book is saved to path every intervalMs and at
+ * shutdown. On startup a checkpoint at most maxAgeMs old is restored and
+ * each book is validated against its first delta's U/u; books that do not
+ * line up fall back to a REST snapshot. Shard i uses <path>.s<i>.
+ */
+struct CheckpointConfig {
+    bool enabled = false;
+    std::string path;
+    int intervalMs = 1000;
+    int maxAgeMs = 10000;           // Older checkpoints are ignored (cold start)
+};
+
+/**
+ * @brief One worker thread of the unified feed_handler
+ *
+ * Each worker owns one Binance connection carrying the listed streams
+ * ("trade", "depth") for its symbols (empty = every configured symbol),
+ * one io_context for the read loop and both handlers' timers, one TP
+ * connection and one health row. cpu pins the thread (-1 = unpinned).
+ * No "workers" block = one worker with both streams for all symbols.
+ */
+struct WorkerConfig {
+    std::vector<std::string> streams{"trade", "depth"};
+    std::vector<std::string> symbols;
+    int cpu = -1;
+    
+    bool hasStream(const std::string& name) const {
+        for (const auto& s : streams) {
+            if (s == name) return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Command line: [config.json] [--replay <file> [--speed <x>|max] [--no-tp]]
+ *
+ * Replay feeds a capture file through the handler's parse, book and
+ * publish path instead of connecting to Binance: at the recorded pace
+ * (speed 1), N times faster, or as fast as possible (max). --no-tp builds
+ * every update but does not send it.
+ */
+struct ReplayOptions {
+    std::string path;               // Empty = live mode
+    double speed = 1.0;             // 0 = max
+    bool useTp = true;
+    
+    bool enabled() const { return !path.empty(); }
+    
+    /**
+     * @brief Parse argv; the first non-option argument is the config path
+     * @return false (after printing why) on a malformed command line
+     */
+    static bool parse(int argc, char* argv[], std::string& configPath, ReplayOptions& out) {
+        for (int i = 1; i < argc; ++i) {
+            const char* a = argv[i];
+            if (std::strcmp(a, "--replay") == 0 && i + 1 < argc) {
+                out.path = argv[++i];
+            } else if (std::strcmp(a, "--speed") == 0 && i + 1 < argc) {
+                const char* v = argv[++i];
+                out.speed = std::strcmp(v, "max") == 0 ? 0.0 : std::atof(v);
+                if (out.speed < 0) out.speed = 0;
+            } else if (std::strcmp(a, "--no-tp") == 0) {
+                out.useTp = false;
+            } else if (a[0] == '-' && a[1] == '-') {
+                std::cerr << "Unknown or incomplete option: " << a << std::endl;
+                std::cerr << "Usage: " << argv[0]
+                          << " [config.json] [--replay <file> [--speed <x>|max] [--no-tp]]" << std::endl;
+                return false;
+            } else {
+                configPath = a;
+            }
+        }
+        return true;
+    }
+};
+
 /**
  * @brief Configuration for feed handlers
  */
@@ -27,6 +234,43 @@ struct FeedHandlerConfig {
     std::string logLevel = "info";
     std::string logFile = "";  // Empty = console only
     
+    // Reader/publisher pipeline config
+    PipelineConfig pipeline;
+    
+    // Columnar batch publishing config
+    BatchConfig batching;
+    
+    // REST snapshot client config
+    RestConfig rest;
+    
+    // Sharded quote handler config
+    ShardConfig sharding;
+    
+    // In-process analytics config
+    AnalyticsConfig analytics;
+    
+    // Shared-memory TP transport config
+    ShmConfig shm;
+    
+    // Quote conflation config (quote handler)
+    ConflationConfig conflation;
+    
+    // Raw input capture config
+    CaptureConfig capture;
+    
+    // TP outbound backlog config
+    OutboundConfig outbound;
+    
+    // Book checkpoint config (quote handler)
+    CheckpointConfig checkpoint;
+    
+    // Worker threads of the unified feed_handler (empty = one worker)
+    std::vector<WorkerConfig> workers;
+    
+    // Quote book config (quote handler)
+    int bookDepth = 5;                         // 1, 5, 10 or 20 levels per side
+    std::string quoteTable = "quote_binance";  // TP table with matching generated schema
+    
     /**
      * @brief Load configuration from JSON file
      * @param filepath Path to JSON config file
@@ -95,12 +339,275 @@ struct FeedHandlerConfig {
             }
         }
         
+        // Parse pipeline config
+        if (doc.HasMember("pipeline") && doc["pipeline"].IsObject()) {
+            const auto& pl = doc["pipeline"];
+            if (pl.HasMember("enabled") && pl["enabled"].IsBool()) {
+                pipeline.enabled = pl["enabled"].GetBool();
+            }
+            if (pl.HasMember("queue_capacity") && pl["queue_capacity"].IsInt()) {
+                pipeline.queueCapacity = pl["queue_capacity"].GetInt();
+            }
+            if (pl.HasMember("reader_cpu") && pl["reader_cpu"].IsInt()) {
+                pipeline.readerCpu = pl["reader_cpu"].GetInt();
+            }
+            if (pl.HasMember("publisher_cpu") && pl["publisher_cpu"].IsInt()) {
+                pipeline.publisherCpu = pl["publisher_cpu"].GetInt();
+            }
+        }
+        
+        // Parse batching config
+        if (doc.HasMember("batching") && doc["batching"].IsObject()) {
+            const auto& bt = doc["batching"];
+            if (bt.HasMember("enabled") && bt["enabled"].IsBool()) {
+                batching.enabled = bt["enabled"].GetBool();
+            }
+            if (bt.HasMember("max_rows") && bt["max_rows"].IsInt()) {
+                batching.maxRows = bt["max_rows"].GetInt();
+            }
+            if (bt.HasMember("max_delay_us") && bt["max_delay_us"].IsInt64()) {
+                batching.maxDelayUs = bt["max_delay_us"].GetInt64();
+            }
+        }
+        
+        // Parse book config
+        if (doc.HasMember("book") && doc["book"].IsObject()) {
+            const auto& bk = doc["book"];
+            if (bk.HasMember("depth") && bk["depth"].IsInt()) {
+                bookDepth = bk["depth"].GetInt();
+            }
+            if (bk.HasMember("table") && bk["table"].IsString()) {
+                quoteTable = bk["table"].GetString();
+            }
+        }
+        
+        // Parse sharding config
+        if (doc.HasMember("sharding") && doc["sharding"].IsObject()) {
+            const auto& sh = doc["sharding"];
+            if (sh.HasMember("shards") && sh["shards"].IsInt()) {
+                sharding.shards = sh["shards"].GetInt();
+            }
+            if (sh.HasMember("cpus") && sh["cpus"].IsArray()) {
+                sharding.cpus.clear();
+                const auto& arr = sh["cpus"];
+                for (rapidjson::SizeType i = 0; i < arr.Size(); ++i) {
+                    sharding.cpus.push_back(arr[i].IsInt() ? arr[i].GetInt() : -1);
+                }
+            }
+            if (sh.HasMember("publisher_cpu") && sh["publisher_cpu"].IsInt()) {
+                sharding.publisherCpu = sh["publisher_cpu"].GetInt();
+            }
+            if (sh.HasMember("queue_capacity") && sh["queue_capacity"].IsInt()) {
+                sharding.queueCapacity = sh["queue_capacity"].GetInt();
+            }
+        }
+        
+        // Parse analytics config
+        if (doc.HasMember("analytics") && doc["analytics"].IsObject()) {
+            const auto& an = doc["analytics"];
+            if (an.HasMember("enabled") && an["enabled"].IsBool()) {
+                analytics.enabled = an["enabled"].GetBool();
+            }
+            if (an.HasMember("vwap_windows_sec") && an["vwap_windows_sec"].IsArray()) {
+                analytics.vwapWindowsSec.clear();
+                const auto& arr = an["vwap_windows_sec"];
+                for (rapidjson::SizeType i = 0; i < arr.Size(); ++i) {
+                    if (arr[i].IsInt()) {
+                        analytics.vwapWindowsSec.push_back(arr[i].GetInt());
+                    }
+                }
+            }
+            if (an.HasMember("table") && an["table"].IsString()) {
+                analytics.table = an["table"].GetString();
+            }
+        }
+        
+        // Parse shared-memory transport config
+        if (doc.HasMember("shm") && doc["shm"].IsObject()) {
+            const auto& sm = doc["shm"];
+            if (sm.HasMember("enabled") && sm["enabled"].IsBool()) {
+                shm.enabled = sm["enabled"].GetBool();
+            }
+            if (sm.HasMember("path") && sm["path"].IsString()) {
+                shm.path = sm["path"].GetString();
+            }
+            if (sm.HasMember("spin_us") && sm["spin_us"].IsInt()) {
+                shm.spinUs = sm["spin_us"].GetInt();
+            }
+        }
+        
+        // Parse conflation config
+        if (doc.HasMember("conflation") && doc["conflation"].IsObject()) {
+            const auto& cf = doc["conflation"];
+            if (cf.HasMember("enabled") && cf["enabled"].IsBool()) {
+                conflation.enabled = cf["enabled"].GetBool();
+            }
+            if (cf.HasMember("interval_us") && cf["interval_us"].IsInt64()) {
+                conflation.intervalUs = cf["interval_us"].GetInt64();
+            }
+            if (cf.HasMember("flush_on_idle") && cf["flush_on_idle"].IsBool()) {
+                conflation.flushOnIdle = cf["flush_on_idle"].GetBool();
+            }
+            if (cf.HasMember("critical_symbols") && cf["critical_symbols"].IsArray()) {
+                conflation.criticalSymbols.clear();
+                const auto& arr = cf["critical_symbols"];
+                for (rapidjson::SizeType i = 0; i < arr.Size(); ++i) {
+                    if (arr[i].IsString()) {
+                        conflation.criticalSymbols.push_back(arr[i].GetString());
+                    }
+                }
+            }
+        }
+        
+        // Parse capture config
+        if (doc.HasMember("capture") && doc["capture"].IsObject()) {
+            const auto& cp = doc["capture"];
+            if (cp.HasMember("enabled") && cp["enabled"].IsBool()) {
+                capture.enabled = cp["enabled"].GetBool();
+            }
+            if (cp.HasMember("path") && cp["path"].IsString()) {
+                capture.path = cp["path"].GetString();
+            }
+            if (cp.HasMember("chunk_mb") && cp["chunk_mb"].IsInt()) {
+                capture.chunkMb = cp["chunk_mb"].GetInt();
+            }
+        }
+        
+        // Parse outbound backlog config
+        if (doc.HasMember("outbound") && doc["outbound"].IsObject()) {
+            const auto& ob = doc["outbound"];
+            if (ob.HasMember("queue_mb") && ob["queue_mb"].IsInt()) {
+                outbound.queueMb = ob["queue_mb"].GetInt();
+            }
+            if (ob.HasMember("spill_enabled") && ob["spill_enabled"].IsBool()) {
+                outbound.spillEnabled = ob["spill_enabled"].GetBool();
+            }
+            if (ob.HasMember("spill_path") && ob["spill_path"].IsString()) {
+                outbound.spillPath = ob["spill_path"].GetString();
+            }
+            if (ob.HasMember("spill_max_mb") && ob["spill_max_mb"].IsInt()) {
+                outbound.spillMaxMb = ob["spill_max_mb"].GetInt();
+            }
+        }
+        
+        // Parse book checkpoint config
+        if (doc.HasMember("checkpoint") && doc["checkpoint"].IsObject()) {
+            const auto& ck = doc["checkpoint"];
+            if (ck.HasMember("enabled") && ck["enabled"].IsBool()) {
+                checkpoint.enabled = ck["enabled"].GetBool();
+            }
+            if (ck.HasMember("path") && ck["path"].IsString()) {
+                checkpoint.path = ck["path"].GetString();
+            }
+            if (ck.HasMember("interval_ms") && ck["interval_ms"].IsInt()) {
+                checkpoint.intervalMs = ck["interval_ms"].GetInt();
+            }
+            if (ck.HasMember("max_age_ms") && ck["max_age_ms"].IsInt()) {
+                checkpoint.maxAgeMs = ck["max_age_ms"].GetInt();
+            }
+        }
+        
+        // Parse unified feed_handler workers
+        if (doc.HasMember("workers") && doc["workers"].IsArray()) {
+            workers.clear();
+            const auto& arr = doc["workers"];
+            for (rapidjson::SizeType i = 0; i < arr.Size(); ++i) {
+                if (!arr[i].IsObject()) continue;
+                const auto& w = arr[i];
+                WorkerConfig worker;
+                if (w.HasMember("streams") && w["streams"].IsArray()) {
+                    worker.streams.clear();
+                    const auto& st = w["streams"];
+                    for (rapidjson::SizeType j = 0; j < st.Size(); ++j) {
+                        if (st[j].IsString()) {
+                            worker.streams.push_back(st[j].GetString());
+                        }
+                    }
+                }
+                if (w.HasMember("symbols") && w["symbols"].IsArray()) {
+                    const auto& sy = w["symbols"];
+                    for (rapidjson::SizeType j = 0; j < sy.Size(); ++j) {
+                        if (sy[j].IsString()) {
+                            worker.symbols.push_back(sy[j].GetString());
+                        }
+                    }
+                }
+                if (w.HasMember("cpu") && w["cpu"].IsInt()) {
+                    worker.cpu = w["cpu"].GetInt();
+                }
+                workers.push_back(worker);
+            }
+        }
+        
+        // Parse REST config
+        if (doc.HasMember("rest") && doc["rest"].IsObject()) {
+            const auto& rs = doc["rest"];
+            if (rs.HasMember("workers") && rs["workers"].IsInt()) {
+                rest.workers = rs["workers"].GetInt();
+            }
+            if (rs.HasMember("max_weight_per_minute") && rs["max_weight_per_minute"].IsInt()) {
+                rest.maxWeightPerMinute = rs["max_weight_per_minute"].GetInt();
+            }
+        }
+        
         std::cout << "[Config] Loaded from: " << filepath << std::endl;
         std::cout << "[Config] Symbols: ";
         for (const auto& s : symbols) std::cout << s << " ";
         std::cout << std::endl;
         std::cout << "[Config] TP: " << tpHost << ":" << tpPort << std::endl;
         std::cout << "[Config] Log level: " << logLevel << std::endl;
+        if (pipeline.enabled) {
+            std::cout << "[Config] Pipeline: queue=" << pipeline.queueCapacity
+                      << " readerCpu=" << pipeline.readerCpu
+                      << " publisherCpu=" << pipeline.publisherCpu << std::endl;
+        }
+        if (batching.enabled) {
+            std::cout << "[Config] Batching: maxRows=" << batching.maxRows
+                      << " maxDelayUs=" << batching.maxDelayUs << std::endl;
+        }
+        if (sharding.shards > 1) {
+            std::cout << "[Config] Sharding: shards=" << sharding.shards
+                      << " queue=" << sharding.queueCapacity
+                      << " publisherCpu=" << sharding.publisherCpu << std::endl;
+        }
+        if (analytics.enabled) {
+            std::cout << "[Config] Analytics: table=" << analytics.table << " vwapWindowsSec=";
+            for (int w : analytics.vwapWindowsSec) std::cout << w << " ";
+            std::cout << std::endl;
+        }
+        if (shm.enabled) {
+            std::cout << "[Config] Shared memory: path=" << shm.path
+                      << " spinUs=" << shm.spinUs << std::endl;
+        }
+        if (capture.enabled) {
+            std::cout << "[Config] Capture: path=" << capture.path
+                      << " chunkMb=" << capture.chunkMb << std::endl;
+        }
+        std::cout << "[Config] Outbound: queueMb=" << outbound.queueMb;
+        if (outbound.spillEnabled) {
+            std::cout << " spill=" << outbound.spillPath << " spillMaxMb=" << outbound.spillMaxMb;
+        }
+        std::cout << std::endl;
+        if (checkpoint.enabled) {
+            std::cout << "[Config] Checkpoint: path=" << checkpoint.path
+                      << " intervalMs=" << checkpoint.intervalMs
+                      << " maxAgeMs=" << checkpoint.maxAgeMs << std::endl;
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            std::cout << "[Config] Worker " << i << ": streams=";
+            for (const auto& s : workers[i].streams) std::cout << s << " ";
+            std::cout << "symbols=";
+            if (workers[i].symbols.empty()) std::cout << "all ";
+            for (const auto& s : workers[i].symbols) std::cout << s << " ";
+            std::cout << "cpu=" << workers[i].cpu << std::endl;
+        }
+        if (conflation.enabled) {
+            std::cout << "[Config] Conflation: intervalUs=" << conflation.intervalUs
+                      << " flushOnIdle=" << (conflation.flushOnIdle ? "true" : "false")
+                      << " critical=";
+            for (const auto& s : conflation.criticalSymbols) std::cout << s << " ";
+            std::cout << std::endl;
+        }
         
         return true;
     }
@@ -0,0 +1,34 @@
+/**
+ * @file cpu_affinity.hpp
+ * @brief Thread-to-core pinning helper
+ *
+ * Pinning the reader and publisher threads to dedicated cores avoids
+ * scheduler migrations and keeps each thread's working set in its own
+ * core's cache.
+ */
+
+#ifndef CPU_AFFINITY_HPP
+#define CPU_AFFINITY_HPP
+
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief Pin the calling thread to a single CPU
+ * @param cpu CPU index (negative = leave unpinned)
+ * @return true if pinned (or no pinning requested), false on failure
+ */
+inline bool pinCurrentThread(int cpu) {
+    if (cpu < 0) return true;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+#endif // CPU_AFFINITY_HPP
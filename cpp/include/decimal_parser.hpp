@@ -0,0 +1,185 @@
+/**
+ * @file decimal_parser.hpp
+ * @brief Fast parser for Binance decimal strings ("43250.12000000")
+ *
+ * Binance sends prices and quantities as fixed-point decimal strings with
+ * up to 8 fractional digits. std::stod goes through locale handling and
+ * the general strtod machinery for every field; this parser accumulates
+ * the digits into a 64-bit integer mantissa and divides once by an exact
+ * power of ten.
+ *
+ * Exactness:
+ *   When the mantissa (trailing zeros stripped) is below 2^53 and the
+ *   scale is at most 10^22, both operands are exact doubles and IEEE
+ *   division is correctly rounded, so the result is identical to strtod.
+ *   Anything outside that fast path (exponents, very long inputs) falls
+ *   back to std::strtod.
+ *
+ * Fixed-point:
+ *   parseScaled() returns the exact integer value * 10^decimals (e.g.
+ *   "43250.12" at 8 decimals -> 4325012000000), for integer tick/lot
+ *   books that never go through a double.
+ */
+
+#ifndef DECIMAL_PARSER_HPP
+#define DECIMAL_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace decimal {
+
+/// Exact powers of ten representable as doubles
+constexpr double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/// Largest integer exactly representable in a double
+constexpr uint64_t MAX_EXACT_MANTISSA = 1ULL << 53;
+
+/**
+ * @brief Slow path for inputs the fast path cannot represent exactly
+ */
+inline double parseFallback(const char* s, size_t len) {
+    std::string tmp(s, len);
+    return std::strtod(tmp.c_str(), nullptr);
+}
+
+/**
+ * @brief Parse a decimal string to double
+ * @param s Pointer to first character (not necessarily NUL-terminated)
+ * @param len Number of characters
+ * @return Parsed value (0.0 for empty input)
+ */
+inline double parseDouble(const char* s, size_t len) {
+    const char* p = s;
+    const char* end = s + len;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;          // Significant digits accumulated
+    int fracDigits = 0;      // Digits after the decimal point (kept)
+    int pendingZeros = 0;    // Trailing fractional zeros not yet applied
+    bool seenPoint = false;
+
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (c >= '0' && c <= '9') {
+            if (seenPoint && c == '0') {
+                ++pendingZeros;
+                continue;
+            }
+            // Apply deferred zeros now that a non-zero digit follows
+            for (; pendingZeros > 0; --pendingZeros) {
+                mantissa *= 10;
+                ++fracDigits;
+                if (mantissa != 0) ++digits;
+            }
+            mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+            if (mantissa != 0) ++digits;
+            if (seenPoint) ++fracDigits;
+            if (digits > 18) return parseFallback(s, len);  // Would overflow
+        } else if (c == '.' && !seenPoint) {
+            seenPoint = true;
+        } else {
+            return parseFallback(s, len);  // Exponent or unexpected char
+        }
+    }
+
+    if (mantissa >= MAX_EXACT_MANTISSA || fracDigits > 22) {
+        return parseFallback(s, len);
+    }
+
+    double value = static_cast<double>(mantissa) / POW10[fracDigits];
+    return negative ? -value : value;
+}
+
+/**
+ * @brief Parse a NUL-terminated decimal string to double
+ */
+inline double parseDouble(const char* s) {
+    size_t len = 0;
+    while (s[len] != '\0') ++len;
+    return parseDouble(s, len);
+}
+
+/// Binance quotes prices and quantities with at most 8 decimal places
+constexpr int ATOM_DECIMALS = 8;
+
+/// Exact integer powers of ten (up to 10^18)
+constexpr int64_t IPOW10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+    100000000LL, 1000000000LL, 10000000000LL, 100000000000LL,
+    1000000000000LL, 10000000000000LL, 100000000000000LL,
+    1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+/**
+ * @brief Parse a decimal string to an exact scaled integer
+ * @param s Pointer to first character (not necessarily NUL-terminated)
+ * @param len Number of characters
+ * @param decimals Fixed number of fractional digits in the result (0..18)
+ * @param out Result: value * 10^decimals
+ * @return false if the value has more significant fractional digits than
+ *         decimals, overflows int64, or is not a plain decimal
+ */
+inline bool parseScaled(const char* s, size_t len, int decimals, int64_t& out) {
+    const char* p = s;
+    const char* end = s + len;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t value = 0;
+    int digits = 0;          // Significant digits accumulated
+    int fracDigits = 0;      // Fractional digits applied to value
+    int pendingZeros = 0;    // Trailing fractional zeros not yet applied
+    bool seenPoint = false;
+
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (c >= '0' && c <= '9') {
+            if (seenPoint && c == '0') {
+                ++pendingZeros;
+                continue;
+            }
+            for (; pendingZeros > 0; --pendingZeros) {
+                value *= 10;
+                ++fracDigits;
+                if (value != 0) ++digits;
+            }
+            value = value * 10 + static_cast<uint64_t>(c - '0');
+            if (value != 0) ++digits;
+            if (seenPoint) ++fracDigits;
+            if (digits > 18 || fracDigits > decimals) return false;
+        } else if (c == '.' && !seenPoint) {
+            seenPoint = true;
+        } else {
+            return false;
+        }
+    }
+
+    // Scale up to the requested number of decimals
+    const int shift = decimals - fracDigits;
+    if (digits + shift > 18) return false;
+    value *= static_cast<uint64_t>(IPOW10[shift]);
+
+    out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    return true;
+}
+
+} // namespace decimal
+
+#endif // DECIMAL_PARSER_HPP
@@ -0,0 +1,151 @@
+/**
+ * @file delta_arena.hpp
+ * @brief Preallocated per-symbol storage for deltas buffered before a snapshot
+ *
+ * While a book is in INIT the handler buffers every delta until the REST
+ * snapshot arrives, then replays them in order and discards the lot. The
+ * buffer is therefore strictly append-then-drain, which lets it live in
+ * fixed storage allocated once at construction:
+ *
+ *   per symbol:  maxRecords record slots  +  levelsPerSymbol level slots
+ *   shared:      overflowLevels level slots (overflow slab, allocated on
+ *                the first spill)
+ *
+ * A record holds its bids followed by its asks contiguously, in the
+ * symbol's own level storage, or in the shared overflow slab when the
+ * symbol's storage cannot fit it (a burst of large deltas). The slab is a
+ * bump allocator rewound once no symbol holds spilled records.
+ *
+ * begin() returns nullptr when the record cap is reached or no level
+ * storage is left; the caller counts the overflow and forces a
+ * re-snapshot (reset) instead of growing the buffer.
+ *
+ * Steady state (after construction): no heap allocation. The slab is the
+ * exception: a manager that never spills never allocates it, and one
+ * that does keeps it for the rest of its life.
+ *
+ * Not thread-safe: owned by the book manager's thread.
+ */
+
+#ifndef DELTA_ARENA_HPP
+#define DELTA_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+template<typename Level>
+class DeltaArena {
+public:
+    /**
+     * @brief One buffered delta; levels point into arena storage
+     */
+    struct Record {
+        long long firstUpdateId = 0;
+        long long finalUpdateId = 0;
+        long long eventTimeMs = 0;
+        Level* levels = nullptr;    // numBids bids, then numAsks asks
+        int numBids = 0;
+        int numAsks = 0;
+        bool spilled = false;       // Levels live in the overflow slab
+
+        const Level* bids() const { return levels; }
+        const Level* asks() const { return levels + numBids; }
+    };
+
+    /**
+     * @param numSymbols Number of books
+     * @param maxRecords Buffered deltas per symbol (cap)
+     * @param levelsPerSymbol Level slots per symbol
+     * @param overflowLevels Level slots in the shared overflow slab
+     *        (capped at numSymbols * levelsPerSymbol)
+     */
+    DeltaArena(int numSymbols, size_t maxRecords, size_t levelsPerSymbol, size_t overflowLevels)
+        : maxRecords_(maxRecords)
+        , levelsPerSymbol_(levelsPerSymbol)
+        , records_(static_cast<size_t>(numSymbols) * maxRecords)
+        , levels_(static_cast<size_t>(numSymbols) * levelsPerSymbol)
+        , overflowCap_(std::min(overflowLevels, static_cast<size_t>(numSymbols) * levelsPerSymbol))
+        , count_(numSymbols, 0)
+        , levelsUsed_(numSymbols, 0)
+        , spilled_(numSymbols, 0)
+    {
+    }
+
+    // Non-copyable (records point into own storage)
+    DeltaArena(const DeltaArena&) = delete;
+    DeltaArena& operator=(const DeltaArena&) = delete;
+
+    /**
+     * @brief Reserve the next record for a symbol with room for maxLevels levels
+     * @return Record to fill (levels, then commit()), nullptr if full
+     */
+    Record* begin(int idx, size_t maxLevels) {
+        if (count_[idx] >= maxRecords_) return nullptr;
+
+        Record& rec = records_[idx * maxRecords_ + count_[idx]];
+        if (levelsUsed_[idx] + maxLevels <= levelsPerSymbol_) {
+            rec.levels = &levels_[idx * levelsPerSymbol_ + levelsUsed_[idx]];
+            rec.spilled = false;
+        } else if (overflowUsed_ + maxLevels <= overflowCap_) {
+            if (overflow_.empty()) overflow_.resize(overflowCap_);
+            rec.levels = overflow_.data() + overflowUsed_;
+            rec.spilled = true;
+        } else {
+            return nullptr;
+        }
+        rec.numBids = 0;
+        rec.numAsks = 0;
+        return &rec;
+    }
+
+    /**
+     * @brief Append a record filled after begin() (numBids/numAsks set)
+     */
+    void commit(int idx, Record& rec) {
+        const size_t used = static_cast<size_t>(rec.numBids + rec.numAsks);
+        if (rec.spilled) {
+            overflowUsed_ += used;
+            if (spilled_[idx]++ == 0) ++spillingSymbols_;
+        } else {
+            levelsUsed_[idx] += used;
+        }
+        ++count_[idx];
+    }
+
+    /// Buffered records for a symbol (oldest first)
+    size_t size(int idx) const { return count_[idx]; }
+    bool empty(int idx) const { return count_[idx] == 0; }
+    const Record& at(int idx, size_t i) const { return records_[idx * maxRecords_ + i]; }
+
+    /**
+     * @brief Drop all buffered records for a symbol
+     */
+    void clear(int idx) {
+        count_[idx] = 0;
+        levelsUsed_[idx] = 0;
+        if (spilled_[idx] > 0) {
+            spilled_[idx] = 0;
+            if (--spillingSymbols_ == 0) overflowUsed_ = 0;
+        }
+    }
+
+    size_t maxRecords() const { return maxRecords_; }
+
+private:
+    size_t maxRecords_;
+    size_t levelsPerSymbol_;
+
+    std::vector<Record> records_;   // [numSymbols * maxRecords]
+    std::vector<Level> levels_;     // [numSymbols * levelsPerSymbol]
+    size_t overflowCap_;
+    std::vector<Level> overflow_;   // Shared slab (empty until the first spill)
+
+    std::vector<size_t> count_;         // Records per symbol
+    std::vector<size_t> levelsUsed_;    // Own level slots used per symbol
+    std::vector<size_t> spilled_;       // Records in the slab per symbol
+    size_t overflowUsed_ = 0;
+    int spillingSymbols_ = 0;
+};
+
+#endif // DELTA_ARENA_HPP
@@ -0,0 +1,77 @@
+/**
+ * @file json_parser.hpp
+ * @brief Reusable, allocation-free in-situ JSON parser for WebSocket frames
+ *
+ * The default rapidjson::Document creates a new heap allocator and parse
+ * stack for every message and copies every string out of the input. This
+ * wrapper instead:
+ *   - Parses in situ: strings stay in the receive buffer (no copies)
+ *   - Uses memory-pool allocators over buffers allocated once at startup
+ *   - Rewinds the pools before each parse (no per-message malloc/free)
+ *
+ * Messages larger than the pools still parse correctly; the pool then
+ * borrows extra chunks from the heap until the next parse.
+ *
+ * Usage:
+ *   JsonParser parser;                       // one per thread
+ *   auto& doc = parser.parseInsitu(buf);     // buf: mutable, NUL-terminated
+ *   // doc and its strings valid until next parseInsitu() or buf reuse
+ */
+
+#ifndef JSON_PARSER_HPP
+#define JSON_PARSER_HPP
+
+#include <rapidjson/document.h>
+
+#include <optional>
+#include <vector>
+
+class JsonParser {
+public:
+    using Allocator = rapidjson::MemoryPoolAllocator<rapidjson::CrtAllocator>;
+    using Document = rapidjson::GenericDocument<rapidjson::UTF8<>, Allocator, Allocator>;
+    using Value = rapidjson::GenericValue<rapidjson::UTF8<>, Allocator>;
+
+    /// Value pool size (depth messages with ~100 levels need a few KB)
+    static constexpr size_t VALUE_POOL_BYTES = 256 * 1024;
+
+    /// Parse stack pool size
+    static constexpr size_t STACK_POOL_BYTES = 16 * 1024;
+
+    JsonParser()
+        : valueBuf_(VALUE_POOL_BYTES)
+        , stackBuf_(STACK_POOL_BYTES)
+        , valueAlloc_(valueBuf_.data(), valueBuf_.size())
+        , stackAlloc_(stackBuf_.data(), stackBuf_.size())
+    {
+    }
+
+    // Non-copyable (allocators point into owned buffers)
+    JsonParser(const JsonParser&) = delete;
+    JsonParser& operator=(const JsonParser&) = delete;
+
+    /**
+     * @brief Parse a mutable, NUL-terminated buffer in place
+     * @param json Buffer (modified: strings are unescaped and terminated in place)
+     * @return Parsed document (check HasParseError()/IsObject())
+     */
+    Document& parseInsitu(char* json) {
+        // Drop previous document, then rewind both pools to their buffers
+        doc_.reset();
+        valueAlloc_.Clear();
+        stackAlloc_.Clear();
+
+        doc_.emplace(&valueAlloc_, STACK_POOL_BYTES / 2, &stackAlloc_);
+        doc_->ParseInsitu(json);
+        return *doc_;
+    }
+
+private:
+    std::vector<char> valueBuf_;
+    std::vector<char> stackBuf_;
+    Allocator valueAlloc_;
+    Allocator stackAlloc_;
+    std::optional<Document> doc_;
+};
+
+#endif // JSON_PARSER_HPP
@@ -0,0 +1,173 @@
+/**
+ * @file kdb_batch.hpp
+ * @brief Columnar row batcher for kdb+ IPC publishing
+ *
+ * Collects rows into typed column vectors (ktn(KF, n) etc.) and hands them
+ * out as one general list of columns, ready for a single
+ * `.u.upd[table; columns]` call. Replaces one boxed knk row of atoms
+ * (one K object per field) and one IPC message per event.
+ *
+ * Flush policy (checked by the caller):
+ *   - full():  maxRows rows collected
+ *   - due():   oldest row has waited maxDelayUs
+ *
+ * Per-row send accounting:
+ *   If a send-time column is set, take() fills it for every row with the
+ *   time between that row's start mark (setRowStart) and the flush, in
+ *   microseconds. This keeps fhSendUs meaningful per row in batch mode.
+ *
+ * Not thread-safe: one batch per publishing thread.
+ *
+ * @see docs/decisions/adr-002-Feed-handler-to-kdb-ingestion-path.md
+ */
+
+#ifndef KDB_BATCH_HPP
+#define KDB_BATCH_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "k.h"
+}
+
+class ColumnBatch {
+public:
+    /**
+     * @brief Create a batch for a table
+     * @param table Target table name (e.g., "trade_binance")
+     * @param types kdb+ type per column (KP, KS, KJ, KF, KB)
+     * @param maxRows Flush threshold in rows
+     * @param maxDelayUs Flush threshold in microseconds since first row
+     */
+    ColumnBatch(const std::string& table, std::vector<int> types,
+                int maxRows, long long maxDelayUs)
+        : table_(table)
+        , types_(std::move(types))
+        , cols_(types_.size(), nullptr)
+        , maxRows_(maxRows > 0 ? maxRows : 1)
+        , maxDelay_(std::chrono::microseconds(maxDelayUs))
+    {
+        rowStartNs_.reserve(maxRows_);
+    }
+
+    ~ColumnBatch() { discard(); }
+
+    // Non-copyable (owns K objects)
+    ColumnBatch(const ColumnBatch&) = delete;
+    ColumnBatch& operator=(const ColumnBatch&) = delete;
+
+    /**
+     * @brief Start a new row
+     * @return Row index to fill with the set*() methods
+     */
+    int beginRow() {
+        if (rows_ == 0) {
+            allocate();
+            firstRowTime_ = std::chrono::steady_clock::now();
+        }
+        rowStartNs_.push_back(0);
+        return rows_++;
+    }
+
+    // Column setters (column index, row index, value)
+    void setTimestamp(int col, int row, long long kdbNs) { kJ(cols_[col])[row] = kdbNs; }
+    void setSymbol(int col, int row, const char* sym) { kS(cols_[col])[row] = ss((S)sym); }
+    void setInterned(int col, int row, S sym) { kS(cols_[col])[row] = sym; }  // Already ss()'d
+    void setLong(int col, int row, long long v) { kJ(cols_[col])[row] = v; }
+    void setFloat(int col, int row, double v) { kF(cols_[col])[row] = v; }
+    void setBool(int col, int row, bool v) { kG(cols_[col])[row] = v ? 1 : 0; }
+
+    /**
+     * @brief Mark the start of a row's send interval (monotonic ns)
+     */
+    void setRowStart(int row, long long steadyNs) { rowStartNs_[row] = steadyNs; }
+
+    /**
+     * @brief Column filled with per-row send duration (µs) at take()
+     * @param col Column index (must be KJ), -1 to disable
+     */
+    void setSendTimeColumn(int col) { sendTimeCol_ = col; }
+
+    int rows() const { return rows_; }
+    bool empty() const { return rows_ == 0; }
+    bool full() const { return rows_ >= maxRows_; }
+
+    /**
+     * @brief Check whether the oldest row has waited long enough
+     */
+    bool due(std::chrono::steady_clock::time_point now) const {
+        return rows_ > 0 && now - firstRowTime_ >= maxDelay_;
+    }
+
+    const std::string& table() const { return table_; }
+
+    /**
+     * @brief Hand out the collected columns and reset
+     *
+     * Caller owns the returned K (general list of typed vectors), which is
+     * normally consumed by k(-h, ".u.upd", table, data, (K)0).
+     *
+     * @return Column list, or nullptr if the batch is empty
+     */
+    K take() {
+        if (rows_ == 0) return nullptr;
+
+        if (sendTimeCol_ >= 0) {
+            long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            for (int r = 0; r < rows_; ++r) {
+                kJ(cols_[sendTimeCol_])[r] = (nowNs - rowStartNs_[r]) / 1000;
+            }
+        }
+
+        K data = ktn(0, static_cast<J>(cols_.size()));
+        for (size_t c = 0; c < cols_.size(); ++c) {
+            cols_[c]->n = rows_;
+            kK(data)[c] = cols_[c];
+            cols_[c] = nullptr;
+        }
+
+        rows_ = 0;
+        rowStartNs_.clear();
+        return data;
+    }
+
+    /**
+     * @brief Drop collected rows without publishing
+     */
+    void discard() {
+        for (auto& col : cols_) {
+            if (col) {
+                r0(col);
+                col = nullptr;
+            }
+        }
+        rows_ = 0;
+        rowStartNs_.clear();
+    }
+
+private:
+    std::string table_;
+    std::vector<int> types_;
+    std::vector<K> cols_;
+    int maxRows_;
+    std::chrono::steady_clock::duration maxDelay_;
+
+    int rows_{0};
+    int sendTimeCol_{-1};
+    std::chrono::steady_clock::time_point firstRowTime_;
+    std::vector<long long> rowStartNs_;
+
+    /// Allocate full-capacity column vectors (trimmed to rows_ at take())
+    void allocate() {
+        for (size_t c = 0; c < cols_.size(); ++c) {
+            if (!cols_[c]) {
+                cols_[c] = ktn(types_[c], maxRows_);
+            }
+        }
+    }
+};
+
+#endif // KDB_BATCH_HPP
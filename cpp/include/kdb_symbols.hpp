@@ -0,0 +1,97 @@
+/**
+ * @file kdb_symbols.hpp
+ * @brief kdb+ symbols and symbol atoms created once and shared by reference
+ *
+ * ks(name) interns the name with ss() (a hash into the k symbol pool) and
+ * allocates a new atom on every call, and ColumnBatch::setSymbol() interns
+ * once per row. For names fixed at startup both are done once:
+ *
+ *   SymAtom          a table (or function) name atom; get() hands out
+ *                    r1(atom) for k()/knk(), which consume a reference
+ *   InternedSymbols  a symbol set's ss() pointers (for KS columns, see
+ *                    ColumnBatch::setInterned) and per-symbol atoms (for
+ *                    boxed rows), indexed like the SymbolTable built from
+ *                    the same names
+ *
+ * Both are filled on first use, because ss()/ks() need the k memory
+ * manager that khpu()/khp() set up. r1/r0 are not atomic, so each
+ * instance belongs to one publishing thread.
+ *
+ * @see symbol_table.hpp
+ */
+
+#ifndef KDB_SYMBOLS_HPP
+#define KDB_SYMBOLS_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "k.h"
+}
+
+class SymAtom {
+public:
+    explicit SymAtom(std::string name) : name_(std::move(name)) {}
+    ~SymAtom() { if (atom_) r0(atom_); }
+
+    // Non-copyable (owns a K reference)
+    SymAtom(const SymAtom&) = delete;
+    SymAtom& operator=(const SymAtom&) = delete;
+
+    /// New reference to the atom
+    K get() {
+        if (!atom_) atom_ = ks((S)name_.c_str());
+        return r1(atom_);
+    }
+
+    const std::string& name() const { return name_; }
+
+private:
+    std::string name_;
+    K atom_{nullptr};
+};
+
+class InternedSymbols {
+public:
+    explicit InternedSymbols(std::vector<std::string> names)
+        : names_(std::move(names))
+        , syms_(names_.size(), nullptr)
+        , atoms_(names_.size(), nullptr)
+    {
+    }
+
+    ~InternedSymbols() {
+        for (K a : atoms_) {
+            if (a) r0(a);
+        }
+    }
+
+    // Non-copyable (owns K references)
+    InternedSymbols(const InternedSymbols&) = delete;
+    InternedSymbols& operator=(const InternedSymbols&) = delete;
+
+    /// Interned symbol (for KS columns)
+    S sym(int idx) {
+        S& s = syms_[idx];
+        if (!s) s = ss((S)names_[idx].c_str());
+        return s;
+    }
+
+    /// New reference to the symbol's atom (for a boxed row)
+    K atom(int idx) {
+        K& a = atoms_[idx];
+        if (!a) a = ks(sym(idx));
+        return r1(a);
+    }
+
+    int size() const { return static_cast<int>(names_.size()); }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<S> syms_;
+    std::vector<K> atoms_;
+};
+
+#endif // KDB_SYMBOLS_HPP
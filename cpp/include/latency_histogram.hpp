@@ -0,0 +1,306 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief Lock-free log-linear latency histograms for feed handler stages
+ *
+ * Each histogram counts nanosecond samples in HDR-style log-linear
+ * buckets: 16 linear sub-buckets per power of two (<= 6.25% relative
+ * error) from 1 ns up to 2^36 ns (~69 s); larger values land in the top
+ * bucket. Recording is one relaxed load/store on a counter: no locks, no
+ * RMW, no allocation.
+ *
+ * Stages (monotonic clock):
+ *   parse    socket read returned -> message parsed
+ *   apply    parsed -> book updated (quote handler)
+ *   publish  updated/parsed -> handed to the publish path (row built,
+ *            appended to batch or queued; includes queueing in pipeline mode)
+ *   send     duration of the k() IPC write to the TP
+ *
+ * LatencyStats keeps one histogram per (symbol, stage) plus a handler-level
+ * slot for samples with no symbol (batched sends). takeInterval() turns the
+ * counts recorded since its previous call into telemetry_fh_hist rows:
+ * one per (symbol, stage) with samples, plus one per stage for the whole
+ * handler (sym = `), each with p50/p90/p99/p99.9/max and the non-zero
+ * buckets (lower bound, count) so intervals and handlers can be merged.
+ *
+ * Thread safety:
+ *   - Each histogram has a single writer (the thread that owns that stage)
+ *   - takeInterval() may run on any one thread concurrently with writers
+ */
+
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "k.h"
+}
+
+namespace latency {
+
+enum Stage : int {
+    STAGE_PARSE = 0,
+    STAGE_APPLY,
+    STAGE_PUBLISH,
+    STAGE_SEND,
+    NUM_STAGES
+};
+
+constexpr const char* STAGE_NAMES[NUM_STAGES] = {"parse", "apply", "publish", "send"};
+
+/// Monotonic clock in nanoseconds
+inline long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace latency
+
+/**
+ * @brief Single-writer log-linear histogram of nanosecond samples
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB = 1 << SUB_BITS;       // Sub-buckets per power of two
+    static constexpr int MAX_MSB = 35;              // Top bucket group: [2^35, 2^36)
+    static constexpr int NUM_BUCKETS = (MAX_MSB - SUB_BITS + 2) * SUB;
+
+    /// Bucket index for a sample (negative samples count as 0)
+    static int bucketOf(long long ns) {
+        if (ns < SUB) return ns < 0 ? 0 : static_cast<int>(ns);
+        const uint64_t v = static_cast<uint64_t>(ns);
+        const int msb = 63 - __builtin_clzll(v);
+        if (msb > MAX_MSB) return NUM_BUCKETS - 1;
+        const int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB + static_cast<int>((v >> shift) - SUB);
+    }
+
+    /// Smallest value in a bucket
+    static long long lowerBound(int b) {
+        if (b < SUB) return b;
+        const int shift = b / SUB - 1;
+        return static_cast<long long>(SUB + b % SUB) << shift;
+    }
+
+    /// Largest value in a bucket
+    static long long upperBound(int b) {
+        if (b < SUB) return b;
+        const int shift = b / SUB - 1;
+        return (static_cast<long long>(SUB + b % SUB + 1) << shift) - 1;
+    }
+
+    /// Record one sample (owning thread only)
+    void record(long long ns) {
+        auto& c = counts_[bucketOf(ns)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /// Cumulative count in a bucket (any thread)
+    uint64_t count(int b) const { return counts_[b].load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> counts_{};
+};
+
+/**
+ * @brief Per-symbol, per-stage latency histograms for one handler
+ */
+class LatencyStats {
+public:
+    /**
+     * @param symbols Symbol names, indexed as in record() (e.g. "BTCUSDT")
+     */
+    explicit LatencyStats(std::vector<std::string> symbols)
+        : symbols_(std::move(symbols))
+        , hist_((symbols_.size() + 1) * latency::NUM_STAGES)
+        , prev_(hist_.size() * LatencyHistogram::NUM_BUCKETS, 0)
+        , delta_(LatencyHistogram::NUM_BUCKETS, 0)
+        , total_(LatencyHistogram::NUM_BUCKETS, 0)
+    {
+    }
+
+    // Non-copyable (atomics)
+    LatencyStats(const LatencyStats&) = delete;
+    LatencyStats& operator=(const LatencyStats&) = delete;
+
+    /**
+     * @brief Record a stage sample
+     * @param symIdx Symbol index, or -1 for a handler-level sample
+     */
+    void record(latency::Stage stage, int symIdx, long long ns) {
+        hist_[slot(symIdx, stage)].record(ns);
+    }
+
+    /**
+     * @brief Build telemetry_fh_hist rows for samples since the last call
+     *
+     * Columns: time, handler, sym, stage, cnt, p50Ns, p90Ns, p99Ns,
+     * p999Ns, maxNs, bucketLoNs, bucketCnt (percentiles are bucket upper
+     * bounds). Caller owns the result (for .u.upd).
+     *
+     * @param handler Handler name (e.g. "quote_fh")
+     * @param kdbTimeNs Row time (ns since 2000.01.01)
+     * @return Column list, or nullptr if nothing was recorded
+     */
+    K takeInterval(const char* handler, long long kdbTimeNs) {
+        rows_.clear();
+        const int numSyms = static_cast<int>(symbols_.size());
+        for (int st = 0; st < latency::NUM_STAGES; ++st) {
+            std::fill(total_.begin(), total_.end(), 0);
+            for (int s = 0; s <= numSyms; ++s) {
+                // s == numSyms: handler-level slot (counted in the total only)
+                const int sym = s < numSyms ? s : -1;
+                if (!takeDelta(slot(sym, static_cast<latency::Stage>(st)))) continue;
+                for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) total_[b] += delta_[b];
+                if (sym >= 0) addRow(sym, st, delta_);
+            }
+            addRow(-1, st, total_);
+        }
+        if (rows_.empty()) return nullptr;
+
+        const J n = static_cast<J>(rows_.size());
+        K time = ktn(KP, n);
+        K hnd = ktn(KS, n);
+        K sym = ktn(KS, n);
+        K stage = ktn(KS, n);
+        K cnt = ktn(KJ, n);
+        K p50 = ktn(KJ, n);
+        K p90 = ktn(KJ, n);
+        K p99 = ktn(KJ, n);
+        K p999 = ktn(KJ, n);
+        K mx = ktn(KJ, n);
+        K lo = ktn(0, n);
+        K bc = ktn(0, n);
+        for (J i = 0; i < n; ++i) {
+            const Row& r = rows_[i];
+            kJ(time)[i] = kdbTimeNs;
+            kS(hnd)[i] = ss((S)handler);
+            kS(sym)[i] = ss((S)(r.sym >= 0 ? symbols_[r.sym].c_str() : ""));
+            kS(stage)[i] = ss((S)latency::STAGE_NAMES[r.stage]);
+            kJ(cnt)[i] = r.cnt;
+            kJ(p50)[i] = r.p50;
+            kJ(p90)[i] = r.p90;
+            kJ(p99)[i] = r.p99;
+            kJ(p999)[i] = r.p999;
+            kJ(mx)[i] = r.max;
+            const J m = static_cast<J>(r.buckets.size());
+            K l = ktn(KJ, m);
+            K c = ktn(KJ, m);
+            for (J j = 0; j < m; ++j) {
+                kJ(l)[j] = LatencyHistogram::lowerBound(r.buckets[j]);
+                kJ(c)[j] = r.counts[j];
+            }
+            kK(lo)[i] = l;
+            kK(bc)[i] = c;
+        }
+        return knk(12, time, hnd, sym, stage, cnt, p50, p90, p99, p999, mx, lo, bc);
+    }
+
+    /// Cumulative handler-wide percentiles of one stage
+    struct Summary {
+        long long cnt = 0, p50 = 0, p99 = 0, p999 = 0, max = 0;
+    };
+
+    /**
+     * @brief All samples of a stage since construction, over every symbol
+     *        (independent of takeInterval; e.g. a replay's final report)
+     */
+    Summary summary(latency::Stage stage) const {
+        std::vector<uint64_t> counts(LatencyHistogram::NUM_BUCKETS, 0);
+        for (size_t s = 0; s <= symbols_.size(); ++s) {
+            const LatencyHistogram& h = hist_[s * latency::NUM_STAGES + stage];
+            for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) counts[b] += h.count(b);
+        }
+        Summary r;
+        for (uint64_t c : counts) r.cnt += static_cast<long long>(c);
+        if (r.cnt == 0) return r;
+        auto at = [&](double p) -> long long {
+            const long long rank = static_cast<long long>(p * r.cnt + 0.999999);
+            long long seen = 0;
+            for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+                seen += static_cast<long long>(counts[b]);
+                if (seen >= rank) return LatencyHistogram::upperBound(b);
+            }
+            return LatencyHistogram::upperBound(LatencyHistogram::NUM_BUCKETS - 1);
+        };
+        r.p50 = at(0.5);
+        r.p99 = at(0.99);
+        r.p999 = at(0.999);
+        r.max = at(1.0);
+        return r;
+    }
+
+private:
+    struct Row {
+        int sym;
+        int stage;
+        long long cnt, p50, p90, p99, p999, max;
+        std::vector<int> buckets;       // Non-zero buckets
+        std::vector<long long> counts;
+    };
+
+    size_t slot(int symIdx, latency::Stage stage) const {
+        const size_t s = symIdx >= 0 ? static_cast<size_t>(symIdx) : symbols_.size();
+        return s * latency::NUM_STAGES + stage;
+    }
+
+    /// delta_ = counts since last call for one histogram; false if none
+    bool takeDelta(size_t h) {
+        uint64_t* prev = &prev_[h * LatencyHistogram::NUM_BUCKETS];
+        bool any = false;
+        for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+            const uint64_t c = hist_[h].count(b);
+            delta_[b] = c - prev[b];
+            prev[b] = c;
+            any |= delta_[b] != 0;
+        }
+        return any;
+    }
+
+    void addRow(int sym, int stage, const std::vector<uint64_t>& counts) {
+        Row r{sym, stage, 0, 0, 0, 0, 0, 0, {}, {}};
+        for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+            if (counts[b]) {
+                r.cnt += static_cast<long long>(counts[b]);
+                r.buckets.push_back(b);
+                r.counts.push_back(static_cast<long long>(counts[b]));
+            }
+        }
+        if (r.cnt == 0) return;
+
+        // Value at percentile p: upper bound of the bucket holding rank ceil(p*cnt)
+        auto at = [&r](double p) -> long long {
+            long long rank = static_cast<long long>(p * r.cnt + 0.999999);
+            long long seen = 0;
+            for (size_t j = 0; j < r.buckets.size(); ++j) {
+                seen += r.counts[j];
+                if (seen >= rank) return LatencyHistogram::upperBound(r.buckets[j]);
+            }
+            return LatencyHistogram::upperBound(r.buckets.back());
+        };
+        r.p50 = at(0.5);
+        r.p90 = at(0.9);
+        r.p99 = at(0.99);
+        r.p999 = at(0.999);
+        r.max = LatencyHistogram::upperBound(r.buckets.back());
+        rows_.push_back(std::move(r));
+    }
+
+    std::vector<std::string> symbols_;
+    std::vector<LatencyHistogram> hist_;    // [(numSymbols + 1) * NUM_STAGES]
+
+    // Exporter state (takeInterval() caller only)
+    std::vector<uint64_t> prev_;            // Counts at last export, per histogram
+    std::vector<uint64_t> delta_;
+    std::vector<uint64_t> total_;
+    std::vector<Row> rows_;
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
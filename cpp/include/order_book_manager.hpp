@@ -1,25 +1,44 @@
 /**
  * @file order_book_manager.hpp
- * @brief Flat-array order book manager for L5 depth with snapshot reconciliation
+ * @brief Flat-array order book manager for depth-N books with snapshot reconciliation
  * 
  * Optimized for 100+ symbols with:
  *   - O(1) symbol lookup via index mapping
- *   - Contiguous memory for cache efficiency
- *   - All book state in flat arrays
+ *   - One cache-line-aligned block per symbol for everything a delta touches
  *   - Publisher state integrated
  * 
  * Architecture:
  *   - Symbol string → index mapping (one-time lookup)
- *   - All price/qty data in flat arrays [numSymbols * DEPTH]
+ *   - Per-symbol blocks in flat arrays indexed by symbol [numSymbols]
  *   - State machine per symbol (INIT → SYNCING → VALID)
- *   - L5 quote extraction for kdb+ publication
+ *   - Depth-N quote extraction for kdb+ publication (N = 1/5/10/20, template)
  * 
- * Memory layout for 100 symbols:
- *   bidPrices_:  100 * 5 * 8 bytes = 4,000 bytes
- *   bidQtys_:    100 * 5 * 8 bytes = 4,000 bytes
- *   askPrices_:  100 * 5 * 8 bytes = 4,000 bytes
- *   askQtys_:    100 * 5 * 8 bytes = 4,000 bytes
- *   Total book data: ~16 KB (fits in L1 cache)
+ * Representation:
+ *   OrderBookManager<PriceRep> stores prices/qtys as PriceRep::value_type
+ *   (double, or int64 ticks/lots with TickPriceRep - see price_rep.hpp).
+ *   Values are converted to double only in getQuote() for publication.
+ * 
+ * Memory layout (hot/cold split, both representations are 8 bytes):
+ *   books_[i]      HotBook, alignas(64): state, update ids, event time,
+ *                  scale, then bid prices/qtys and ask prices/qtys
+ *                  (48-byte header; L1: 128 bytes, L5: 256, L20: 704)
+ *   published_[i]  PublishedBook, alignas(64): levels as last published,
+ *                  publish time and validity, conflation flag
+ *   cold vectors   symbol strings, generations, snapshot flags, overflow
+ *                  counters, delta buffer (DeltaArena)
+ * A delta touches only its symbol's HotBook - the header line plus the
+ * lines of the sides it updates - instead of one line in each of ~10
+ * separate per-field arrays; the publish decision adds its PublishedBook.
+ * Each side's prices stay contiguous for the SIMD level search.
+ * 
+ * Deltas buffered in INIT live in a DeltaArena preallocated at
+ * construction (MAX_DELTA_BUFFER_SIZE records and DELTA_LEVELS_PER_SYMBOL
+ * levels per symbol, plus a shared overflow slab of up to
+ * DELTA_OVERFLOW_LEVELS levels allocated on the first spill).
+ * 
+ * Warm start: exportBook()/restoreBook() copy a book to and from a
+ * BookImage (see book_checkpoint.hpp); a restored book is SYNCING and is
+ * validated by its first delta like a REST snapshot.
  * 
  * @see docs/decisions/adr-009-L1-Order-Book-Architecture.md
  */
@@ -27,20 +46,27 @@
 #ifndef ORDER_BOOK_MANAGER_HPP
 #define ORDER_BOOK_MANAGER_HPP
 
+#include <array>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <deque>
 #include <chrono>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <stdexcept>
+#include <type_traits>
+
+#include "book_kernels.hpp"
+#include "delta_arena.hpp"
+#include "price_rep.hpp"
+#include "publish_scheduler.hpp"
+#include "symbol_table.hpp"
 
 // ============================================================================
 // CONFIGURATION
 // ============================================================================
 
-/// Number of price levels to maintain per side (L5)
+/// Default number of price levels per side (L5); see OrderBookManager<..., Depth>
 constexpr int BOOK_DEPTH = 5;
 
 /// Publish timeout in milliseconds (publish even if no change)
@@ -49,79 +75,66 @@ constexpr int PUBLISH_TIMEOUT_MS = 50;
 /// Maximum delta buffer size before forced snapshot
 constexpr size_t MAX_DELTA_BUFFER_SIZE = 1000;
 
+/// Preallocated level slots per symbol for buffered deltas
+constexpr size_t DELTA_LEVELS_PER_SYMBOL = 4096;
+
+/// Shared overflow level slots for buffered deltas (bursts of large deltas);
+/// at most DELTA_LEVELS_PER_SYMBOL per symbol, allocated on the first spill
+constexpr size_t DELTA_OVERFLOW_LEVELS = 1 << 20;
+
 // ============================================================================
 // DATA STRUCTURES
 // ============================================================================
 
 /**
- * @brief Single price level (price + quantity)
+ * @brief Single price level (price + quantity) as double
  */
-struct PriceLevel {
-    double price = 0.0;
-    double qty = 0.0;
-    
-    bool operator==(const PriceLevel& other) const {
-        return price == other.price && qty == other.qty;
-    }
-    
-    bool operator!=(const PriceLevel& other) const {
-        return !(*this == other);
-    }
-    
-    bool isEmpty() const {
-        return price == 0.0 && qty == 0.0;
-    }
-};
+using PriceLevel = BasicPriceLevel<DoublePriceRep>;
 
 /**
- * @brief L5 quote for kdb+ publication (22 price/qty fields + metadata)
+ * @brief Depth-N quote for kdb+ publication (4*Depth price/qty fields + metadata)
+ * 
+ * Published with the generated quote schema (kdb/schema.q):
+ *   time, sym, bidPrice1..N, bidQty1..N, askPrice1..N, askQty1..N,
+ *   isValid, exchEventTimeMs, fhRecvTimeUtcNs, fhSeqNo
+ * 
+ * Change detection is done by the book on its native representation
+ * (OrderBookManager::shouldPublish), not on these converted doubles.
  */
-struct L5Quote {
-    std::string sym;
-    
-    // Bids (best to worst: index 0 = best bid)
-    double bidPrice1 = 0.0, bidQty1 = 0.0;
-    double bidPrice2 = 0.0, bidQty2 = 0.0;
-    double bidPrice3 = 0.0, bidQty3 = 0.0;
-    double bidPrice4 = 0.0, bidQty4 = 0.0;
-    double bidPrice5 = 0.0, bidQty5 = 0.0;
-    
-    // Asks (best to worst: index 0 = best ask)
-    double askPrice1 = 0.0, askQty1 = 0.0;
-    double askPrice2 = 0.0, askQty2 = 0.0;
-    double askPrice3 = 0.0, askQty3 = 0.0;
-    double askPrice4 = 0.0, askQty4 = 0.0;
-    double askPrice5 = 0.0, askQty5 = 0.0;
+template<int Depth>
+struct DepthQuote {
+    static constexpr int DEPTH = Depth;
+    
+    /// Fields sent by the FH: time, sym, 4*Depth levels, 4 metadata
+    static constexpr int NUM_FIELDS = 2 + 4 * Depth + 4;
+    
+    const char* sym = "";       // Book manager's symbol name (lives as long as it)
+    
+    // Best to worst: index 0 = best bid / best ask
+    std::array<double, Depth> bidPrices{};
+    std::array<double, Depth> bidQtys{};
+    std::array<double, Depth> askPrices{};
+    std::array<double, Depth> askQtys{};
     
     bool isValid = false;
     long long exchEventTimeMs = 0;
     long long fhRecvTimeUtcNs = 0;
     long long fhSeqNo = 0;
-    
-    // Compare L5 for change detection (price and qty only)
-    bool samePricesAs(const L5Quote& other) const {
-        return bidPrice1 == other.bidPrice1 && bidQty1 == other.bidQty1 &&
-               bidPrice2 == other.bidPrice2 && bidQty2 == other.bidQty2 &&
-               bidPrice3 == other.bidPrice3 && bidQty3 == other.bidQty3 &&
-               bidPrice4 == other.bidPrice4 && bidQty4 == other.bidQty4 &&
-               bidPrice5 == other.bidPrice5 && bidQty5 == other.bidQty5 &&
-               askPrice1 == other.askPrice1 && askQty1 == other.askQty1 &&
-               askPrice2 == other.askPrice2 && askQty2 == other.askQty2 &&
-               askPrice3 == other.askPrice3 && askQty3 == other.askQty3 &&
-               askPrice4 == other.askPrice4 && askQty4 == other.askQty4 &&
-               askPrice5 == other.askPrice5 && askQty5 == other.askQty5;
-    }
 };
 
+/// L5 quote (default depth)
+using L5Quote = DepthQuote<BOOK_DEPTH>;
+
 /**
- * @brief Buffered delta for replay after snapshot
+ * @brief Decoded live delta (reused decode target; buffered deltas live in DeltaArena)
  */
-struct BufferedDelta {
+template<typename PriceRep>
+struct BasicDeltaUpdate {
     long long firstUpdateId;
     long long finalUpdateId;
     long long eventTimeMs;
-    std::vector<PriceLevel> bids;   // Level updates (price, qty) - qty=0 means delete
-    std::vector<PriceLevel> asks;
+    std::vector<BasicPriceLevel<PriceRep>> bids;   // Level updates (price, qty) - qty=0 means delete
+    std::vector<BasicPriceLevel<PriceRep>> asks;
 };
 
 /**
@@ -129,7 +142,7 @@ struct BufferedDelta {
  */
 enum class BookState {
     INIT,       // Initial state, buffering deltas
-    SYNCING,    // Snapshot applied, replaying buffered deltas
+    SYNCING,    // Snapshot (or checkpoint) applied, awaiting the first in-sequence delta
     VALID,      // Normal operation, applying live deltas
     INVALID     // Sequence gap detected, needs rebuild
 };
@@ -140,16 +153,31 @@ enum class BookState {
 
 /**
  * @class OrderBookManager
- * @brief Manages L5 order books for multiple symbols with flat-array storage
+ * @brief Manages depth-N order books for multiple symbols in per-symbol blocks
  * 
  * Key design choices:
  *   - Symbol → index mapping for O(1) access
- *   - Flat arrays for all book data (cache-friendly)
+ *   - Hot/cold split: one aligned block per symbol for delta and publish
+ *     state, rarely touched state kept apart
  *   - Per-symbol state machine
- *   - Integrated publisher state (last published, timeout)
+ *   - Integrated publisher state (last published, heartbeat deadlines,
+ *     conflation dirty set)
+ * 
+ * @tparam PriceRep DoublePriceRep or TickPriceRep (see price_rep.hpp)
+ * @tparam Depth Price levels per side
  */
+template<typename PriceRep = DoublePriceRep, int Depth = BOOK_DEPTH>
 class OrderBookManager {
 public:
+    static_assert(Depth >= 1, "Depth must be at least 1");
+    
+    static constexpr int DEPTH = Depth;
+    using Quote = DepthQuote<Depth>;
+    using Value = typename PriceRep::value_type;
+    using Level = BasicPriceLevel<PriceRep>;
+    using Delta = BasicDeltaUpdate<PriceRep>;
+    using DeltaRecord = typename DeltaArena<Level>::Record;
+
     // ========================================================================
     // CONSTRUCTION
     // ========================================================================
@@ -158,39 +186,25 @@ public:
      * @brief Initialize manager with symbol list
      * @param symbols List of symbols (uppercase, e.g., "BTCUSDT")
      */
-    explicit OrderBookManager(const std::vector<std::string>& symbols) {
-        numSymbols_ = static_cast<int>(symbols.size());
-        
-        // Build symbol ↔ index mapping
-        for (int i = 0; i < numSymbols_; ++i) {
-            symToIdx_[symbols[i]] = i;
-            idxToSym_.push_back(symbols[i]);
-        }
+    explicit OrderBookManager(const std::vector<std::string>& symbols)
+        : numSymbols_(static_cast<int>(symbols.size()))
+        , symbols_(symbols)
+        , books_(numSymbols_)
+        , published_(numSymbols_)
+        , deltaArena_(numSymbols_, MAX_DELTA_BUFFER_SIZE, DELTA_LEVELS_PER_SYMBOL, DELTA_OVERFLOW_LEVELS)
+        , heartbeats_(numSymbols_, std::chrono::milliseconds(PUBLISH_TIMEOUT_MS))
+    {        
+        // Cold per-symbol state
+        deltaOverflows_.resize(numSymbols_, 0);
+        offGridLevels_.resize(numSymbols_, 0);
+        snapshotRequested_.resize(numSymbols_, 0);
+        generations_.resize(numSymbols_, 0);
+        dirtyList_.reserve(numSymbols_);
         
-        // Allocate flat arrays
-        const int totalLevels = numSymbols_ * BOOK_DEPTH;
-        bidPrices_.resize(totalLevels, 0.0);
-        bidQtys_.resize(totalLevels, 0.0);
-        askPrices_.resize(totalLevels, 0.0);
-        askQtys_.resize(totalLevels, 0.0);
-        
-        // Per-symbol state
-        states_.resize(numSymbols_, BookState::INIT);
-        lastUpdateIds_.resize(numSymbols_, 0);
-        snapshotUpdateIds_.resize(numSymbols_, 0);
-        exchEventTimeMs_.resize(numSymbols_, 0);
-        deltaBuffers_.resize(numSymbols_);
-        snapshotRequested_.resize(numSymbols_, false);
-        
-        // Publisher state
-        lastPublished_.resize(numSymbols_);
-        lastPublishTimes_.resize(numSymbols_);
-        hasPublished_.resize(numSymbols_, false);
-        
-        // Initialize lastPublishTimes to now
+        // Initialize last publish times to now
         auto now = std::chrono::steady_clock::now();
-        for (int i = 0; i < numSymbols_; ++i) {
-            lastPublishTimes_[i] = now;
+        for (auto& pub : published_) {
+            pub.lastPublishTime = now;
         }
     }
     
@@ -202,38 +216,127 @@ public:
      * @brief Get symbol index (returns -1 if not found)
      */
     int getSymbolIndex(const std::string& sym) const {
-        auto it = symToIdx_.find(sym);
-        return (it != symToIdx_.end()) ? it->second : -1;
+        return symbols_.find(sym);
+    }
+    
+    /**
+     * @brief Get symbol index from raw bytes (e.g. a JSON string; no copy)
+     */
+    int getSymbolIndex(const char* sym, size_t len) const {
+        return symbols_.find(sym, len);
     }
     
     /**
      * @brief Get symbol name by index
      */
     const std::string& getSymbol(int idx) const {
-        return idxToSym_[idx];
+        return symbols_.name(idx);
     }
     
+    /// Symbol set, indexed like the books
+    const SymbolTable& symbols() const { return symbols_; }
+    
     /**
      * @brief Get number of symbols
      */
     int numSymbols() const { return numSymbols_; }
     
+    // ========================================================================
+    // PRICE REPRESENTATION
+    // ========================================================================
+    
+    /**
+     * @brief Set a symbol's tick/lot sizes (from exchangeInfo)
+     * 
+     * With TickPriceRep, existing levels are in the old units, so a change
+     * resets the book (it rebuilds from a fresh snapshot).
+     */
+    void setScale(int idx, const InstrumentScale& scale) {
+        if (books_[idx].scale == scale) return;
+        books_[idx].scale = scale;
+        reset(idx);
+    }
+    
+    const InstrumentScale& getScale(int idx) const { return books_[idx].scale; }
+    
+    /**
+     * @brief Decode one wire ["price","qty"] pair into the book's representation
+     * @return false if a value is off the symbol's tick/lot grid (counted in
+     *         offGridLevels(); lvl holds the nearest units, a non-zero qty
+     *         stays non-zero). The caller should not apply it: resync the
+     *         symbol, e.g. with the 1e-8 atom scale.
+     */
+    bool parseLevel(int idx, const char* price, size_t priceLen,
+                    const char* qty, size_t qtyLen, Level& lvl) {
+        const InstrumentScale& sc = books_[idx].scale;
+        const bool priceExact = PriceRep::parsePrice(price, priceLen, sc, lvl.price);
+        const bool qtyExact = PriceRep::parseQty(qty, qtyLen, sc, lvl.qty);
+        if (priceExact && qtyExact) return true;
+        ++offGridLevels_[idx];
+        ++totalOffGridLevels_;
+        return false;
+    }
+    
+    /// Levels rejected as off the tick/lot grid (per symbol / all symbols)
+    long long offGridLevels(int idx) const { return offGridLevels_[idx]; }
+    long long offGridLevels() const { return totalOffGridLevels_; }
+    
     // ========================================================================
     // STATE ACCESS
     // ========================================================================
     
-    BookState getState(int idx) const { return states_[idx]; }
-    bool isValid(int idx) const { return states_[idx] == BookState::VALID; }
-    bool needsSnapshot(int idx) const { return states_[idx] == BookState::INIT && !snapshotRequested_[idx]; }
-    void setSnapshotRequested(int idx, bool val) { snapshotRequested_[idx] = val; }
+    BookState getState(int idx) const { return books_[idx].state; }
+    bool isValid(int idx) const { return books_[idx].state == BookState::VALID; }
+    bool needsSnapshot(int idx) const { return books_[idx].state == BookState::INIT && !snapshotRequested_[idx]; }
+    void setSnapshotRequested(int idx, bool val) { snapshotRequested_[idx] = val ? 1 : 0; }
+    bool snapshotRequested(int idx) const { return snapshotRequested_[idx] != 0; }
     
     /**
-     * @brief Get delta buffer for a symbol (for adding incoming deltas)
+     * @brief Book generation (incremented on every reset)
+     *
+     * Tagged onto async snapshot requests so a response that arrives after
+     * the book was reset (reconnect, gap) is recognised as stale.
      */
-    std::deque<BufferedDelta>& getDeltaBuffer(int idx) {
-        return deltaBuffers_[idx];
+    long long generation(int idx) const { return generations_[idx]; }
+    
+    // ========================================================================
+    // DELTA BUFFER (INIT state, preallocated)
+    // ========================================================================
+    
+    /**
+     * @brief Start buffering a delta with up to maxLevels bid+ask levels
+     * 
+     * The caller decodes levels straight into rec->levels (bids first),
+     * sets numBids/numAsks and calls commitBufferedDelta().
+     * 
+     * @return Record to fill, or nullptr if the buffer is at its cap
+     *         (counted in deltaOverflows(); caller should force a re-snapshot)
+     */
+    DeltaRecord* beginBufferedDelta(int idx, long long firstUpdateId, long long finalUpdateId,
+                                    long long eventTimeMs, size_t maxLevels) {
+        DeltaRecord* rec = deltaArena_.begin(idx, maxLevels);
+        if (!rec) {
+            ++deltaOverflows_[idx];
+            ++totalDeltaOverflows_;
+            return nullptr;
+        }
+        rec->firstUpdateId = firstUpdateId;
+        rec->finalUpdateId = finalUpdateId;
+        rec->eventTimeMs = eventTimeMs;
+        return rec;
     }
     
+    void commitBufferedDelta(int idx, DeltaRecord& rec) { deltaArena_.commit(idx, rec); }
+    
+    /// Buffered deltas for a symbol (oldest first)
+    size_t bufferedDeltaCount(int idx) const { return deltaArena_.size(idx); }
+    const DeltaRecord& bufferedDelta(int idx, size_t i) const { return deltaArena_.at(idx, i); }
+    void clearBufferedDeltas(int idx) { deltaArena_.clear(idx); }
+    
+    /// Deltas rejected because the buffer was full (per symbol / all symbols)
+    long long deltaOverflows(int idx) const { return deltaOverflows_[idx]; }
+    long long deltaOverflows() const { return totalDeltaOverflows_; }
+    
     // ========================================================================
     // BOOK OPERATIONS
     // ========================================================================
@@ -246,27 +349,27 @@ public:
      * @param asks Ask levels from snapshot (sorted low→high)
      */
     void applySnapshot(int idx, long long lastUpdateId,
-                       const std::vector<PriceLevel>& bids,
-                       const std::vector<PriceLevel>& asks) {
+                       const std::vector<Level>& bids,
+                       const std::vector<Level>& asks) {
         // Clear existing book
         clearBook(idx);
         
-        // Copy top BOOK_DEPTH levels
-        const int offset = idx * BOOK_DEPTH;
+        // Copy top Depth levels
+        HotBook& b = books_[idx];
         
-        for (size_t i = 0; i < bids.size() && i < BOOK_DEPTH; ++i) {
-            bidPrices_[offset + i] = bids[i].price;
-            bidQtys_[offset + i] = bids[i].qty;
+        for (size_t i = 0; i < bids.size() && i < Depth; ++i) {
+            b.bidPrices[i] = bids[i].price;
+            b.bidQtys[i] = bids[i].qty;
         }
         
-        for (size_t i = 0; i < asks.size() && i < BOOK_DEPTH; ++i) {
-            askPrices_[offset + i] = asks[i].price;
-            askQtys_[offset + i] = asks[i].qty;
+        for (size_t i = 0; i < asks.size() && i < Depth; ++i) {
+            b.askPrices[i] = asks[i].price;
+            b.askQtys[i] = asks[i].qty;
         }
         
-        snapshotUpdateIds_[idx] = lastUpdateId;
-        lastUpdateIds_[idx] = lastUpdateId;
-        states_[idx] = BookState::SYNCING;
+        b.snapshotUpdateId = lastUpdateId;
+        b.lastUpdateId = lastUpdateId;
+        b.state = BookState::SYNCING;
     }
     
     /**
@@ -275,35 +378,38 @@ public:
      * @param firstUpdateId Delta's first update ID (U)
      * @param finalUpdateId Delta's final update ID (u)
      * @param bidUpdates Bid level updates (qty=0 means delete)
+     * @param numBids Number of bid updates
      * @param askUpdates Ask level updates
+     * @param numAsks Number of ask updates
      * @param eventTimeMs Exchange event time
      * @return true if applied successfully, false if sequence gap
      */
     bool applyDelta(int idx, long long firstUpdateId, long long finalUpdateId,
-                    const std::vector<PriceLevel>& bidUpdates,
-                    const std::vector<PriceLevel>& askUpdates,
+                    const Level* bidUpdates, size_t numBids,
+                    const Level* askUpdates, size_t numAsks,
                     long long eventTimeMs) {
         
-        BookState state = states_[idx];
+        HotBook& b = books_[idx];
+        BookState state = b.state;
         
         if (state == BookState::SYNCING) {
             // First delta after snapshot
             // Must satisfy: U <= snapshotUpdateId+1 <= u
-            if (firstUpdateId > snapshotUpdateIds_[idx] + 1) {
+            if (firstUpdateId > b.snapshotUpdateId + 1) {
                 // Snapshot is too old, need new snapshot
                 invalidate(idx, "Snapshot too old");
                 return false;
             }
-            if (finalUpdateId < snapshotUpdateIds_[idx] + 1) {
+            if (finalUpdateId < b.snapshotUpdateId + 1) {
                 // Delta is stale, skip it
                 return true;
             }
             // Transition to VALID
-            states_[idx] = BookState::VALID;
+            b.state = BookState::VALID;
         }
         else if (state == BookState::VALID) {
             // Normal operation: expect consecutive sequence
-            if (firstUpdateId != lastUpdateIds_[idx] + 1) {
+            if (firstUpdateId != b.lastUpdateId + 1) {
                 invalidate(idx, "Sequence gap");
                 return false;
             }
@@ -314,31 +420,46 @@ public:
         }
         
         // Apply bid updates
-        for (const auto& upd : bidUpdates) {
-            applyLevelUpdate(idx, true, upd);
+        for (size_t i = 0; i < numBids; ++i) {
+            applyLevelUpdate(b.bidPrices, b.bidQtys, true, bidUpdates[i]);
         }
         
         // Apply ask updates
-        for (const auto& upd : askUpdates) {
-            applyLevelUpdate(idx, false, upd);
+        for (size_t i = 0; i < numAsks; ++i) {
+            applyLevelUpdate(b.askPrices, b.askQtys, false, askUpdates[i]);
         }
         
-        lastUpdateIds_[idx] = finalUpdateId;
-        exchEventTimeMs_[idx] = eventTimeMs;
+        b.lastUpdateId = finalUpdateId;
+        b.exchEventTimeMs = eventTimeMs;
         return true;
     }
     
+    /// Apply a decoded live delta
+    bool applyDelta(int idx, const Delta& d) {
+        return applyDelta(idx, d.firstUpdateId, d.finalUpdateId,
+                          d.bids.data(), d.bids.size(), d.asks.data(), d.asks.size(), d.eventTimeMs);
+    }
+    
+    /// Apply a buffered delta
+    bool applyDelta(int idx, const DeltaRecord& r) {
+        return applyDelta(idx, r.firstUpdateId, r.finalUpdateId,
+                          r.bids(), static_cast<size_t>(r.numBids),
+                          r.asks(), static_cast<size_t>(r.numAsks), r.eventTimeMs);
+    }
+    
     /**
      * @brief Reset a symbol's book to INIT state
      */
     void reset(int idx) {
         clearBook(idx);
-        states_[idx] = BookState::INIT;
-        lastUpdateIds_[idx] = 0;
-        snapshotUpdateIds_[idx] = 0;
-        exchEventTimeMs_[idx] = 0;
-        deltaBuffers_[idx].clear();
-        snapshotRequested_[idx] = false;
+        HotBook& b = books_[idx];
+        b.state = BookState::INIT;
+        b.lastUpdateId = 0;
+        b.snapshotUpdateId = 0;
+        b.exchEventTimeMs = 0;
+        deltaArena_.clear(idx);
+        snapshotRequested_[idx] = 0;
+        ++generations_[idx];
     }
     
     /**
@@ -354,43 +475,97 @@ public:
      * @brief Mark book as invalid
      */
     void invalidate(int idx, const char* reason) {
-        states_[idx] = BookState::INVALID;
+        books_[idx].state = BookState::INVALID;
         // Caller should log the reason
     }
-    
+
     // ========================================================================
-    // L5 EXTRACTION
+    // CHECKPOINT (warm start, see book_checkpoint.hpp)
+    // ========================================================================
+
+    /// One symbol's book as saved to and restored from a checkpoint
+    struct BookImage {
+        long long lastUpdateId = 0;
+        long long exchEventTimeMs = 0;
+        InstrumentScale scale;
+        Value bidPrices[Depth] = {};
+        Value bidQtys[Depth] = {};
+        Value askPrices[Depth] = {};
+        Value askQtys[Depth] = {};
+    };
+    static_assert(std::is_trivially_copyable<BookImage>::value, "BookImage is saved as raw bytes");
+
+    /**
+     * @brief Copy a VALID book into an image
+     * @return false if the book is not VALID (nothing worth restoring)
+     */
+    bool exportBook(int idx, BookImage& out) const {
+        const HotBook& b = books_[idx];
+        if (b.state != BookState::VALID) return false;
+        out.lastUpdateId = b.lastUpdateId;
+        out.exchEventTimeMs = b.exchEventTimeMs;
+        out.scale = b.scale;
+        std::copy_n(b.bidPrices, Depth, out.bidPrices);
+        std::copy_n(b.bidQtys, Depth, out.bidQtys);
+        std::copy_n(b.askPrices, Depth, out.askPrices);
+        std::copy_n(b.askQtys, Depth, out.askQtys);
+        return true;
+    }
+
+    /**
+     * @brief Restore an INIT book from an image, as if it were a snapshot
+     *
+     * The book enters SYNCING with the image's lastUpdateId as its
+     * snapshot id, so the first delta must satisfy U <= lastUpdateId+1 <= u
+     * (VALID without a REST snapshot); otherwise applyDelta() invalidates it.
+     *
+     * @return false if the book is not INIT or its scale differs from the
+     *         image's (levels would be in other units)
+     */
+    bool restoreBook(int idx, const BookImage& img) {
+        HotBook& b = books_[idx];
+        if (b.state != BookState::INIT || b.scale != img.scale || img.lastUpdateId <= 0) return false;
+        std::copy_n(img.bidPrices, Depth, b.bidPrices);
+        std::copy_n(img.bidQtys, Depth, b.bidQtys);
+        std::copy_n(img.askPrices, Depth, b.askPrices);
+        std::copy_n(img.askQtys, Depth, b.askQtys);
+        b.snapshotUpdateId = img.lastUpdateId;
+        b.lastUpdateId = img.lastUpdateId;
+        b.exchEventTimeMs = img.exchEventTimeMs;
+        b.state = BookState::SYNCING;
+        deltaArena_.clear(idx);
+        snapshotRequested_[idx] = 0;
+        return true;
+    }
+
+    // ========================================================================
+    // QUOTE EXTRACTION
     // ========================================================================
     
     /**
-     * @brief Extract L5 quote for publication
+     * @brief Extract depth-N quote for publication
      * @param idx Symbol index
      * @param fhRecvTimeUtcNs Feed handler receive timestamp
      * @param fhSeqNo Feed handler sequence number
-     * @return L5Quote ready for kdb+ publication
+     * @return Quote ready for kdb+ publication
      */
-    L5Quote getL5(int idx, long long fhRecvTimeUtcNs, long long fhSeqNo) const {
-        L5Quote q;
-        q.sym = idxToSym_[idx];
+    Quote getQuote(int idx, long long fhRecvTimeUtcNs, long long fhSeqNo) const {
+        Quote q;
+        q.sym = symbols_.name(idx).c_str();
         
-        const int offset = idx * BOOK_DEPTH;
+        const HotBook& b = books_[idx];
+        const InstrumentScale& sc = b.scale;
         
-        // Copy L5 bid levels
-        q.bidPrice1 = bidPrices_[offset + 0]; q.bidQty1 = bidQtys_[offset + 0];
-        q.bidPrice2 = bidPrices_[offset + 1]; q.bidQty2 = bidQtys_[offset + 1];
-        q.bidPrice3 = bidPrices_[offset + 2]; q.bidQty3 = bidQtys_[offset + 2];
-        q.bidPrice4 = bidPrices_[offset + 3]; q.bidQty4 = bidQtys_[offset + 3];
-        q.bidPrice5 = bidPrices_[offset + 4]; q.bidQty5 = bidQtys_[offset + 4];
-        
-        // Copy L5 ask levels
-        q.askPrice1 = askPrices_[offset + 0]; q.askQty1 = askQtys_[offset + 0];
-        q.askPrice2 = askPrices_[offset + 1]; q.askQty2 = askQtys_[offset + 1];
-        q.askPrice3 = askPrices_[offset + 2]; q.askQty3 = askQtys_[offset + 2];
-        q.askPrice4 = askPrices_[offset + 3]; q.askQty4 = askQtys_[offset + 3];
-        q.askPrice5 = askPrices_[offset + 4]; q.askQty5 = askQtys_[offset + 4];
+        // Copy levels (converted to double for kdb+)
+        for (int i = 0; i < Depth; ++i) {
+            q.bidPrices[i] = PriceRep::toPrice(b.bidPrices[i], sc);
+            q.bidQtys[i] = PriceRep::toQty(b.bidQtys[i], sc);
+            q.askPrices[i] = PriceRep::toPrice(b.askPrices[i], sc);
+            q.askQtys[i] = PriceRep::toQty(b.askQtys[i], sc);
+        }
         
-        q.isValid = (states_[idx] == BookState::VALID);
-        q.exchEventTimeMs = exchEventTimeMs_[idx];
+        q.isValid = (b.state == BookState::VALID);
+        q.exchEventTimeMs = b.exchEventTimeMs;
         q.fhRecvTimeUtcNs = fhRecvTimeUtcNs;
         q.fhSeqNo = fhSeqNo;
         
@@ -402,72 +577,116 @@ public:
     // ========================================================================
     
     /**
-     * @brief Check if should publish L5 for a symbol
+     * @brief Check if should publish quote for a symbol
      * @param idx Symbol index
-     * @param current Current L5 quote
+     * @param current Current quote
+     * @param now Loop time (read once per event by the caller)
      * @return true if should publish
      */
-    bool shouldPublish(int idx, const L5Quote& current) {
-        auto now = std::chrono::steady_clock::now();
+    bool shouldPublish(int idx, const Quote& current, std::chrono::steady_clock::time_point now) {
+        return shouldPublish(idx, current.isValid, now);
+    }
+    
+    /**
+     * @brief Same check from the book state alone (no quote extraction)
+     * @param isValid Validity the quote would carry
+     */
+    bool shouldPublish(int idx, bool isValid, std::chrono::steady_clock::time_point now) {
+        const PublishedBook& pub = published_[idx];
         
         // First publish ever
-        if (!hasPublished_[idx]) {
+        if (!pub.hasPublished) {
             return true;
         }
         
         // Validity changed
-        if (current.isValid != lastPublished_[idx].isValid) {
+        if (isValid != pub.valid) {
             return true;
         }
         
         // If invalid, don't spam
-        if (!current.isValid) {
+        if (!isValid) {
             return false;
         }
         
-        // Price/qty changed
-        if (!current.samePricesAs(lastPublished_[idx])) {
+        // Price/qty changed (exact compare on native representation)
+        if (!sameAsPublished(idx)) {
             return true;
         }
         
         // Timeout (publish heartbeat even if unchanged)
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - lastPublishTimes_[idx]).count();
-        if (elapsed >= PUBLISH_TIMEOUT_MS) {
-            return true;
-        }
-        
-        return false;
+        return now - pub.lastPublishTime >= std::chrono::milliseconds(PUBLISH_TIMEOUT_MS);
     }
     
     /**
-     * @brief Record that a quote was published
+     * @brief Record that a quote was published (re-arms its heartbeat)
      */
-    void recordPublish(int idx, const L5Quote& quote) {
-        lastPublished_[idx] = quote;
-        lastPublishTimes_[idx] = std::chrono::steady_clock::now();
-        hasPublished_[idx] = true;
+    void recordPublish(int idx, const Quote& quote, std::chrono::steady_clock::time_point now) {
+        const HotBook& b = books_[idx];
+        PublishedBook& pub = published_[idx];
+        std::copy_n(b.bidPrices, Depth, pub.bidPrices);
+        std::copy_n(b.bidQtys, Depth, pub.bidQtys);
+        std::copy_n(b.askPrices, Depth, pub.askPrices);
+        std::copy_n(b.askQtys, Depth, pub.askQtys);
+        pub.valid = quote.isValid;
+        pub.lastPublishTime = now;
+        pub.hasPublished = true;
+        heartbeats_.schedule(idx, now);
     }
     
     /**
-     * @brief Check if any symbol needs timeout publish
-     * @return Vector of symbol indices that need timeout publish
+     * @brief Symbols whose heartbeat is due
+     * @param result Filled with VALID symbol indices unpublished for
+     *        PUBLISH_TIMEOUT_MS (cleared first; pass a reused vector)
+     * @param now Loop time (read once per event by the caller)
+     * 
+     * Only due symbols are visited (PublishScheduler); a due symbol that
+     * is not VALID is skipped and checked again one timeout later.
      */
-    std::vector<int> getTimeoutPublishNeeded() {
-        std::vector<int> result;
-        auto now = std::chrono::steady_clock::now();
-        
-        for (int i = 0; i < numSymbols_; ++i) {
-            if (states_[i] == BookState::VALID && hasPublished_[i]) {
-                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    now - lastPublishTimes_[i]).count();
-                if (elapsed >= PUBLISH_TIMEOUT_MS) {
-                    result.push_back(i);
-                }
+    void getTimeoutPublishNeeded(std::vector<int>& result, std::chrono::steady_clock::time_point now) {
+        result.clear();
+        heartbeats_.expire(now, [&](int idx) {
+            if (books_[idx].state == BookState::VALID) {
+                result.push_back(idx);
             }
+        });
+    }
+
+    // ========================================================================
+    // CONFLATION
+    // ========================================================================
+    
+    /**
+     * @brief Mark a symbol's book as changed but not yet published
+     * @param fhRecvTimeUtcNs Receive time of the latest change (quoted at flush)
+     * @return false if it was already pending (that state is superseded)
+     */
+    bool markDirty(int idx, long long fhRecvTimeUtcNs) {
+        PublishedBook& pub = published_[idx];
+        pub.dirtyRecvNs = fhRecvTimeUtcNs;
+        if (pub.dirty) return false;
+        pub.dirty = 1;
+        dirtyList_.push_back(idx);  // Reserved for every symbol: no allocation
+        return true;
+    }
+    
+    bool isDirty(int idx) const { return published_[idx].dirty != 0; }
+    
+    size_t dirtyCount() const { return dirtyList_.size(); }
+    
+    /**
+     * @brief Clear every pending symbol, calling f(idx, fhRecvTimeUtcNs)
+     *        for each in the order they were first marked
+     * 
+     * f may publish but must not mark symbols dirty.
+     */
+    template<typename F>
+    void takeDirty(F&& f) {
+        for (int idx : dirtyList_) {
+            published_[idx].dirty = 0;
+            f(idx, published_[idx].dirtyRecvNs);
         }
-        
-        return result;
+        dirtyList_.clear();
     }
 
 private:
@@ -476,38 +695,74 @@ private:
     // ========================================================================
     
     int numSymbols_;
-    std::unordered_map<std::string, int> symToIdx_;
-    std::vector<std::string> idxToSym_;
+    SymbolTable symbols_;
     
     // ========================================================================
-    // BOOK DATA (flat arrays)
+    // BOOK DATA (hot: one block per symbol)
     // ========================================================================
     
-    // Price and qty arrays: [numSymbols * BOOK_DEPTH]
-    // Access: bidPrices_[symIdx * BOOK_DEPTH + level]
-    std::vector<double> bidPrices_;     // Bids sorted high→low (index 0 = best bid)
-    std::vector<double> bidQtys_;
-    std::vector<double> askPrices_;     // Asks sorted low→high (index 0 = best ask)
-    std::vector<double> askQtys_;
+    /// Everything applyDelta reads or writes for one symbol
+    struct alignas(64) HotBook {
+        BookState state = BookState::INIT;
+        long long lastUpdateId = 0;
+        long long snapshotUpdateId = 0;
+        long long exchEventTimeMs = 0;
+        InstrumentScale scale;          // Tick/lot sizes (used by TickPriceRep)
+        Value bidPrices[Depth] = {};    // Bids sorted high→low (index 0 = best bid)
+        Value bidQtys[Depth] = {};
+        Value askPrices[Depth] = {};    // Asks sorted low→high (index 0 = best ask)
+        Value askQtys[Depth] = {};
+    };
+    
+    std::vector<HotBook> books_;        // [numSymbols]
     
     // ========================================================================
-    // STATE (per symbol)
+    // PUBLISHER STATE (one block per symbol)
     // ========================================================================
     
-    std::vector<BookState> states_;
-    std::vector<long long> lastUpdateIds_;
-    std::vector<long long> snapshotUpdateIds_;
-    std::vector<long long> exchEventTimeMs_;
-    std::vector<std::deque<BufferedDelta>> deltaBuffers_;
-    std::vector<bool> snapshotRequested_;
+    /// Book as of last publish (native representation) and conflation flag
+    struct alignas(64) PublishedBook {
+        Value bidPrices[Depth] = {};
+        Value bidQtys[Depth] = {};
+        Value askPrices[Depth] = {};
+        Value askQtys[Depth] = {};
+        std::chrono::steady_clock::time_point lastPublishTime;
+        long long dirtyRecvNs = 0;      // Latest receive time while dirty
+        bool valid = false;
+        bool hasPublished = false;
+        uint8_t dirty = 0;
+    };
+    
+    std::vector<PublishedBook> published_;  // [numSymbols]
     
     // ========================================================================
-    // PUBLISHER STATE (per symbol)
+    // DELTA BUFFER (INIT state)
     // ========================================================================
     
-    std::vector<L5Quote> lastPublished_;
-    std::vector<std::chrono::steady_clock::time_point> lastPublishTimes_;
-    std::vector<bool> hasPublished_;
+    DeltaArena<Level> deltaArena_;
+    std::vector<long long> deltaOverflows_;
+    long long totalDeltaOverflows_ = 0;
+    
+    // Wire levels off the tick/lot grid (see parseLevel)
+    std::vector<long long> offGridLevels_;
+    long long totalOffGridLevels_ = 0;
+    
+    // ========================================================================
+    // PUBLISH SCHEDULING
+    // ========================================================================
+    
+    // Heartbeat deadlines of published symbols, earliest first
+    PublishScheduler heartbeats_;
+    
+    // Conflation: pending symbols in the order they were marked
+    std::vector<int> dirtyList_;
+    
+    // ========================================================================
+    // COLD STATE (per symbol)
+    // ========================================================================
+    
+    std::vector<uint8_t> snapshotRequested_;
+    std::vector<long long> generations_;
     
     // ========================================================================
     // PRIVATE HELPERS
@@ -517,13 +772,23 @@ private:
      * @brief Clear a symbol's book to zeros
      */
     void clearBook(int idx) {
-        const int offset = idx * BOOK_DEPTH;
-        for (int i = 0; i < BOOK_DEPTH; ++i) {
-            bidPrices_[offset + i] = 0.0;
-            bidQtys_[offset + i] = 0.0;
-            askPrices_[offset + i] = 0.0;
-            askQtys_[offset + i] = 0.0;
-        }
+        HotBook& b = books_[idx];
+        std::fill_n(b.bidPrices, Depth, Value{});
+        std::fill_n(b.bidQtys, Depth, Value{});
+        std::fill_n(b.askPrices, Depth, Value{});
+        std::fill_n(b.askQtys, Depth, Value{});
+    }
+    
+    /**
+     * @brief Check whether a symbol's book equals the last published book
+     */
+    bool sameAsPublished(int idx) const {
+        const HotBook& b = books_[idx];
+        const PublishedBook& pub = published_[idx];
+        return std::equal(b.bidPrices, b.bidPrices + Depth, pub.bidPrices) &&
+               std::equal(b.bidQtys, b.bidQtys + Depth, pub.bidQtys) &&
+               std::equal(b.askPrices, b.askPrices + Depth, pub.askPrices) &&
+               std::equal(b.askQtys, b.askQtys + Depth, pub.askQtys);
     }
     
     /**
@@ -533,60 +798,34 @@ private:
      *   - qty > 0: update or insert at this price
      *   - qty = 0: delete this price level
      * 
-     * @param idx Symbol index
+     * @param prices One side's prices in its symbol's HotBook
+     * @param qtys The same side's quantities
      * @param isBid true for bid side, false for ask side
      * @param update Price level update
      */
-    void applyLevelUpdate(int idx, bool isBid, const PriceLevel& update) {
-        const int offset = idx * BOOK_DEPTH;
-        double* prices = isBid ? &bidPrices_[offset] : &askPrices_[offset];
-        double* qtys = isBid ? &bidQtys_[offset] : &askQtys_[offset];
+    void applyLevelUpdate(Value* prices, Value* qtys, bool isBid, const Level& update) {
         
-        // Find existing price or insertion point
-        int existingIdx = -1;
-        int insertIdx = BOOK_DEPTH;  // Default: beyond end
-        
-        for (int i = 0; i < BOOK_DEPTH; ++i) {
-            if (prices[i] == update.price && qtys[i] > 0.0) {
-                existingIdx = i;
-                break;
-            }
-            
-            // Find insertion point (maintain sort order)
-            if (prices[i] == 0.0 || (isBid ? update.price > prices[i] : update.price < prices[i])) {
-                if (insertIdx == BOOK_DEPTH) {
-                    insertIdx = i;
-                }
-            }
-        }
+        // Find existing price or insertion point (SIMD where available)
+        const book_kernels::LevelSearch found =
+            book_kernels::findLevel(prices, Depth, update.price, isBid);
         
-        if (update.qty == 0.0) {
-            // DELETE: remove this price level
-            if (existingIdx >= 0) {
-                // Shift remaining levels up
-                for (int i = existingIdx; i < BOOK_DEPTH - 1; ++i) {
-                    prices[i] = prices[i + 1];
-                    qtys[i] = qtys[i + 1];
-                }
-                // Clear last level
-                prices[BOOK_DEPTH - 1] = 0.0;
-                qtys[BOOK_DEPTH - 1] = 0.0;
+        if (update.qty == 0) {
+            // DELETE: remove this price level, shift remaining levels up
+            if (found.existing >= 0) {
+                book_kernels::removeAt(prices, Depth, found.existing);
+                book_kernels::removeAt(qtys, Depth, found.existing);
             }
         } else {
             // UPDATE or INSERT
-            if (existingIdx >= 0) {
+            if (found.existing >= 0) {
                 // Update existing level
-                qtys[existingIdx] = update.qty;
-            } else if (insertIdx < BOOK_DEPTH) {
+                qtys[found.existing] = update.qty;
+            } else if (found.insert < Depth) {
                 // Insert new level: shift levels down
-                for (int i = BOOK_DEPTH - 1; i > insertIdx; --i) {
-                    prices[i] = prices[i - 1];
-                    qtys[i] = qtys[i - 1];
-                }
-                prices[insertIdx] = update.price;
-                qtys[insertIdx] = update.qty;
+                book_kernels::insertAt(prices, Depth, found.insert, update.price);
+                book_kernels::insertAt(qtys, Depth, found.insert, update.qty);
             }
-            // else: price would be beyond L5, ignore
+            // else: price would be beyond book depth, ignore
         }
     }
 };
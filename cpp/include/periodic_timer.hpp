@@ -0,0 +1,89 @@
+/**
+ * @file periodic_timer.hpp
+ * @brief Drift-free repeating steady_timer for the handlers' event loops
+ *
+ * Each handler runs one io_context for its whole run: the WebSocket
+ * connect and async_read, REST completion wake-ups and these timers
+ * (publish heartbeats, batch flush, health, stop check) are all
+ * dispatched on the handler's own thread, so timers fire on time whether
+ * or not market data is arriving or a connection is up.
+ *
+ * Expiries advance by exactly one period from the previous expiry (not
+ * from when the callback ran), so the schedule does not drift; if the
+ * loop fell more than a period behind, the next expiry restarts from now
+ * instead of firing a burst of catch-up ticks.
+ *
+ * Not thread-safe: use from the io_context's thread only.
+ */
+
+#ifndef PERIODIC_TIMER_HPP
+#define PERIODIC_TIMER_HPP
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <functional>
+#include <utility>
+
+class PeriodicTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param ioc Event loop
+     * @param period Interval between ticks
+     * @param onTick Called every period; return false to stop the timer
+     */
+    PeriodicTimer(boost::asio::io_context& ioc, Clock::duration period, std::function<bool()> onTick)
+        : timer_(ioc)
+        , period_(period)
+        , onTick_(std::move(onTick))
+    {
+    }
+
+    // Non-copyable (the pending wait refers to this)
+    PeriodicTimer(const PeriodicTimer&) = delete;
+    PeriodicTimer& operator=(const PeriodicTimer&) = delete;
+
+    /// First tick one period from now
+    void start() {
+        active_ = true;
+        timer_.expires_after(period_);
+        wait();
+    }
+
+    /// No further ticks (a pending wait completes as cancelled)
+    void cancel() {
+        active_ = false;
+        timer_.cancel();
+    }
+
+    Clock::duration period() const { return period_; }
+
+private:
+    void wait() {
+        timer_.async_wait([this](const boost::system::error_code& ec) {
+            if (ec || !active_) return;
+            if (!onTick_()) {
+                active_ = false;
+                return;
+            }
+            if (!active_) return;  // Cancelled from inside onTick
+            const Clock::time_point next = timer_.expiry() + period_;
+            if (next < Clock::now()) {
+                timer_.expires_after(period_);
+            } else {
+                timer_.expires_at(next);
+            }
+            wait();
+        });
+    }
+
+    boost::asio::steady_timer timer_;
+    Clock::duration period_;
+    std::function<bool()> onTick_;
+    bool active_{false};
+};
+
+#endif // PERIODIC_TIMER_HPP
@@ -0,0 +1,159 @@
+/**
+ * @file price_rep.hpp
+ * @brief Price/quantity representations for OrderBookManager
+ *
+ * The book is parameterised on a representation policy:
+ *
+ *   DoublePriceRep  - double prices/qtys (original behaviour)
+ *   TickPriceRep    - int64 ticks (price / tickSize) and lots (qty / stepSize)
+ *
+ * With TickPriceRep, wire strings are parsed straight to integers with
+ * decimal::parseScaled (no double in between), level matching is exact
+ * integer equality, and values are converted to double only when a quote
+ * is built for kdb+ publication.
+ *
+ * Per-symbol tick and lot sizes come from GET /api/v3/exchangeInfo
+ * (PRICE_FILTER.tickSize, LOT_SIZE.stepSize). Until they are known the
+ * scale is one "atom" (1e-8, Binance's finest precision), which is still
+ * exact.
+ *
+ * A wire value that is not a whole number of ticks/lots (the scale no
+ * longer matches the exchange) is reported, not silently rounded: the
+ * parse returns false with the nearest unit, and a non-zero qty is never
+ * mapped to 0 (which would delete the level). The caller resyncs the
+ * symbol (see OrderBookManager::parseLevel).
+ *
+ * Policy interface:
+ *   value_type
+ *   static bool parsePrice(const char*, size_t, const InstrumentScale&, value_type&)
+ *   static bool parseQty(const char*, size_t, const InstrumentScale&, value_type&)
+ *   static double toPrice(value_type, const InstrumentScale&)
+ *   static double toQty(value_type, const InstrumentScale&)
+ */
+
+#ifndef PRICE_REP_HPP
+#define PRICE_REP_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+
+#include "decimal_parser.hpp"
+
+/**
+ * @brief Per-symbol price/quantity increments in atoms (1e-8 units)
+ */
+struct InstrumentScale {
+    int64_t tickAtoms = 1;   // e.g. tickSize "0.01000000" -> 1000000
+    int64_t lotAtoms = 1;    // e.g. stepSize "0.00001000" -> 1000
+
+    /**
+     * @brief Build from exchangeInfo filter strings (invalid -> 1 atom)
+     */
+    static InstrumentScale fromStrings(const std::string& tickSize, const std::string& stepSize) {
+        InstrumentScale sc;
+        int64_t v = 0;
+        if (decimal::parseScaled(tickSize.data(), tickSize.size(), decimal::ATOM_DECIMALS, v) && v > 0) {
+            sc.tickAtoms = v;
+        }
+        if (decimal::parseScaled(stepSize.data(), stepSize.size(), decimal::ATOM_DECIMALS, v) && v > 0) {
+            sc.lotAtoms = v;
+        }
+        return sc;
+    }
+
+    bool operator==(const InstrumentScale& o) const {
+        return tickAtoms == o.tickAtoms && lotAtoms == o.lotAtoms;
+    }
+    bool operator!=(const InstrumentScale& o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Floating-point representation (prices and qtys as double)
+ */
+struct DoublePriceRep {
+    using value_type = double;
+    static constexpr const char* NAME = "double";
+
+    static bool parsePrice(const char* s, size_t len, const InstrumentScale&, value_type& out) {
+        out = decimal::parseDouble(s, len);
+        return true;
+    }
+    static bool parseQty(const char* s, size_t len, const InstrumentScale&, value_type& out) {
+        out = decimal::parseDouble(s, len);
+        return true;
+    }
+    static double toPrice(value_type v, const InstrumentScale&) { return v; }
+    static double toQty(value_type v, const InstrumentScale&) { return v; }
+};
+
+/**
+ * @brief Fixed-point representation (int64 ticks and lots)
+ */
+struct TickPriceRep {
+    using value_type = int64_t;
+    static constexpr const char* NAME = "ticks";
+
+    static bool parsePrice(const char* s, size_t len, const InstrumentScale& sc, value_type& out) {
+        return toUnits(s, len, sc.tickAtoms, out);
+    }
+    static bool parseQty(const char* s, size_t len, const InstrumentScale& sc, value_type& out) {
+        return toUnits(s, len, sc.lotAtoms, out);
+    }
+
+    // atoms / 1e8: both operands exact below 2^53, so correctly rounded
+    // (same double as strtod on the original string)
+    static double toPrice(value_type v, const InstrumentScale& sc) {
+        return static_cast<double>(v * sc.tickAtoms) / decimal::POW10[decimal::ATOM_DECIMALS];
+    }
+    static double toQty(value_type v, const InstrumentScale& sc) {
+        return static_cast<double>(v * sc.lotAtoms) / decimal::POW10[decimal::ATOM_DECIMALS];
+    }
+
+private:
+    /// false if s is not a whole number of units (units: the nearest, >= 1 if s > 0)
+    static bool toUnits(const char* s, size_t len, int64_t unitAtoms, value_type& units) {
+        int64_t atoms = 0;
+        bool exact = decimal::parseScaled(s, len, decimal::ATOM_DECIMALS, atoms);
+        if (!exact) {
+            // More than 8 decimals or exponent form (not sent by Binance)
+            const double scaled = decimal::parseFallback(s, len) * decimal::POW10[decimal::ATOM_DECIMALS];
+            atoms = std::llround(scaled);
+            exact = static_cast<double>(atoms) == scaled;
+            if (atoms == 0 && scaled > 0) atoms = 1;
+        }
+        // Exchange guarantees multiples of the increment: anything else
+        // means the scale is stale, so report it instead of rounding it
+        // onto a neighbouring level
+        units = atoms / unitAtoms;
+        const int64_t rem = atoms % unitAtoms;
+        if (rem != 0) {
+            exact = false;
+            if (2 * rem >= unitAtoms || units == 0) ++units;
+        }
+        return exact;
+    }
+};
+
+/**
+ * @brief Single price level (price + quantity) in a given representation
+ */
+template<typename PriceRep>
+struct BasicPriceLevel {
+    typename PriceRep::value_type price{};
+    typename PriceRep::value_type qty{};
+
+    bool operator==(const BasicPriceLevel& other) const {
+        return price == other.price && qty == other.qty;
+    }
+
+    bool operator!=(const BasicPriceLevel& other) const {
+        return !(*this == other);
+    }
+
+    bool isEmpty() const {
+        return price == 0 && qty == 0;
+    }
+};
+
+#endif // PRICE_REP_HPP
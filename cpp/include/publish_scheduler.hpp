@@ -0,0 +1,122 @@
+/**
+ * @file publish_scheduler.hpp
+ * @brief Per-symbol heartbeat deadlines ordered by expiry
+ *
+ * Every published symbol must be republished PUBLISH_TIMEOUT_MS after its
+ * last publish even if the book did not change. With one timeout for all
+ * symbols, deadlines are armed in publish order, so a FIFO is already a
+ * priority queue: an intrusive doubly linked list over symbol indices,
+ * re-arming a symbol moves it to the tail (O(1)) and expiry pops from the
+ * head until it reaches a deadline in the future.
+ *
+ *   head -> [sym 7, t+3ms] -> [sym 2, t+12ms] -> ... -> [sym 9, t+50ms] <- tail
+ *
+ * A check therefore touches only the symbols that are due (plus one),
+ * instead of scanning every symbol. A deadline earlier than the tail's
+ * (caller passed an older time) is inserted in order by walking back from
+ * the tail, so the list stays sorted regardless.
+ *
+ * Steady state (after construction): no heap allocation.
+ *
+ * Not thread-safe: owned by the book manager's thread.
+ */
+
+#ifndef PUBLISH_SCHEDULER_HPP
+#define PUBLISH_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class PublishScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param numSymbols Symbol indices are [0, numSymbols)
+     * @param timeout Deadline distance from the last publish
+     */
+    PublishScheduler(int numSymbols, Clock::duration timeout)
+        : timeout_(timeout)
+        , next_(numSymbols, NONE)
+        , prev_(numSymbols, NONE)
+        , deadlines_(numSymbols)
+        , linked_(numSymbols, 0)
+    {
+    }
+
+    /// (Re)arm a symbol's deadline at lastPublish + timeout
+    void schedule(int idx, Clock::time_point lastPublish) {
+        unlink(idx);
+        deadlines_[idx] = lastPublish + timeout_;
+        insert(idx);
+    }
+
+    /// Remove a symbol's deadline
+    void cancel(int idx) { unlink(idx); }
+
+    bool scheduled(int idx) const { return linked_[idx] != 0; }
+
+    /// Earliest deadline (Clock::time_point::max() if none)
+    Clock::time_point nextDeadline() const {
+        return head_ == NONE ? Clock::time_point::max() : deadlines_[head_];
+    }
+
+    /**
+     * @brief Call onDue(idx) for every symbol whose deadline is <= now
+     *
+     * Each due symbol is re-armed one timeout after now before onDue runs,
+     * so a caller that does not publish it is asked again next timeout
+     * (publishing re-arms it anyway).
+     */
+    template<typename F>
+    void expire(Clock::time_point now, F&& onDue) {
+        while (head_ != NONE && deadlines_[head_] <= now) {
+            const int idx = head_;
+            schedule(idx, now);
+            onDue(idx);
+        }
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    static constexpr int NONE = -1;
+
+    void unlink(int idx) {
+        if (!linked_[idx]) return;
+        const int p = prev_[idx];
+        const int n = next_[idx];
+        if (p != NONE) next_[p] = n; else head_ = n;
+        if (n != NONE) prev_[n] = p; else tail_ = p;
+        next_[idx] = prev_[idx] = NONE;
+        linked_[idx] = 0;
+        --size_;
+    }
+
+    void insert(int idx) {
+        // Walk back past later deadlines (none when armed in time order)
+        int after = tail_;
+        while (after != NONE && deadlines_[after] > deadlines_[idx]) {
+            after = prev_[after];
+        }
+        const int before = after == NONE ? head_ : next_[after];
+        prev_[idx] = after;
+        next_[idx] = before;
+        if (after != NONE) next_[after] = idx; else head_ = idx;
+        if (before != NONE) prev_[before] = idx; else tail_ = idx;
+        linked_[idx] = 1;
+        ++size_;
+    }
+
+    Clock::duration timeout_;
+    std::vector<int> next_;
+    std::vector<int> prev_;
+    std::vector<Clock::time_point> deadlines_;
+    std::vector<uint8_t> linked_;
+    int head_{NONE};
+    int tail_{NONE};
+    size_t size_{0};
+};
+
+#endif // PUBLISH_SCHEDULER_HPP
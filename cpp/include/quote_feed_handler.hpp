@@ -1,21 +1,70 @@
 /**
  * @file quote_feed_handler.hpp
- * @brief WebSocket depth stream handler with snapshot reconciliation (L5)
+ * @brief WebSocket depth stream handler with snapshot reconciliation (L1/L5/L10/L20)
  * 
- * Implements the full L5 book lifecycle:
+ * Implements the full book lifecycle:
  *   1. Connect to @depth@100ms WebSocket stream
  *   2. Buffer incoming deltas
- *   3. Fetch REST snapshot
- *   4. Apply snapshot + buffered deltas
+ *   3. Fetch REST snapshot (async worker pool, keep-alive connections)
+ *   4. Apply snapshot + buffered deltas (on the WebSocket thread)
  *   5. Continue applying live deltas
- *   6. Publish L5 on change/timeout
+ *   6. Publish depth-N quote on change/timeout
+ * 
+ * Book depth is a template parameter (QuoteFeedHandler<Depth>); main()
+ * instantiates the depth configured in "book.depth" (1, 5, 10 or 20).
  * 
  * State machine (per symbol):
  *   INIT → (start buffering) → SYNCING → (snapshot + deltas) → VALID
  *   VALID → (sequence gap) → INVALID → INIT (rebuild)
  * 
+ * Stage latency histograms (see latency_histogram.hpp): parse, apply,
+ * publish per symbol and send per handler, exported every
+ * HEALTH_INTERVAL_SEC as telemetry_fh_hist rows alongside the health row.
+ * 
+ * In-process analytics (optional, see AnalyticsConfig): depth imbalance,
+ * microprice and spread are computed from each published quote and sent
+ * to analytics_binance (by the shared publisher in shard mode).
+ * 
+ * Shared-memory transport (optional, see ShmConfig): quote and analytics
+ * updates go through the TP's shared-memory ring, TCP otherwise (owned by
+ * the shared publisher in shard mode).
+ * 
+ * Conflation (optional, see ConflationConfig): changed books are marked
+ * dirty in OrderBookManager and published with their latest state on a
+ * cadence or when downstream has drained; superseded states are counted
+ * in the health row's conflated column. Critical symbols publish per tick.
+ * 
+ * Event loop: one io_context for the handler's run on its thread
+ * (BinanceStream, see binance_stream.hpp) multiplexes the WebSocket
+ * async_read, REST snapshot completions (posted by the workers) and
+ * drift-free timers for publish timeouts, batch flushes, health and the
+ * stop check (see periodic_timer.hpp), so quiet streams no longer delay
+ * heartbeats until the next frame. Connecting is asynchronous too, so the
+ * timers keep running while Binance is reconnecting.
+ * 
+ * TP outages (see OutboundConfig): updates are queued in memory, then a
+ * spill file, while a background thread reconnects, and replayed in
+ * order afterwards; the WebSocket loop keeps reading throughout.
+ * 
+ * Capture and replay (optional, see CaptureConfig / ReplayOptions): raw
+ * frames, exchangeInfo scales, applied snapshots and reconnect resets are
+ * appended to a capture file; --replay feeds one back through the same
+ * parse, book and publish path without Binance or REST access.
+ * 
+ * Warm start (optional, see CheckpointConfig): VALID books are saved to an
+ * mmap'd checkpoint on a timer and at shutdown; on restart they are
+ * restored in SYNCING state and kept if the first delta lines up with the
+ * checkpoint's lastUpdateId, instead of waiting for a REST snapshot.
+ * 
+ * Unified mode (feed_handler, see attach()): the handler runs on a
+ * worker's shared connection next to the trade handler, publishing
+ * through the worker's TP connection. The handler's own Binance and TP
+ * connections are only created by run(), so an attached handler holds no
+ * transport state.
+ * 
  * Uses OrderBookManager for:
  *   - Flat-array storage (cache-friendly for 100+ symbols)
+ *   - Exact int64 tick/lot prices (FH_FIXED_POINT_BOOK, default) or doubles
  *   - O(1) symbol lookup
  *   - Integrated publisher state
  * 
@@ -35,59 +84,78 @@
 #include <string>
 #include <vector>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 
+#include "analytics_engine.hpp"
+#include "binance_stream.hpp"
+#include "book_checkpoint.hpp"
+#include "capture_file.hpp"
+#include "config.hpp"
+#include "json_parser.hpp"
+#include "kdb_batch.hpp"
+#include "kdb_symbols.hpp"
+#include "latency_histogram.hpp"
 #include "order_book_manager.hpp"
 #include "rest_client.hpp"
+#include "shm_publisher.hpp"
+#include "tp_outbound.hpp"
 
 extern "C" {
 #include "k.h"
 }
 
-namespace beast = boost::beast;
-namespace websocket = beast::websocket;
 namespace net = boost::asio;
-namespace ssl = net::ssl;
-using tcp = net::ip::tcp;
+
+/// Book price representation, selected at compile time (CMake FH_FIXED_POINT_BOOK)
+#ifdef FH_FIXED_POINT_BOOK
+using QuotePriceRep = TickPriceRep;
+#else
+using QuotePriceRep = DoublePriceRep;
+#endif
+
+template<int Depth>
+class QuoteShardPublisher;
 
 /**
  * @class QuoteFeedHandler
- * @brief Handles real-time L5 quote data from Binance depth streams
+ * @brief Handles real-time depth-N quote data from Binance depth streams
  * 
  * Key responsibilities:
  *   - WebSocket connection management (TLS) with auto-reconnect
  *   - Order book state management via OrderBookManager
  *   - REST snapshot fetching for initial sync
  *   - Delta buffering and replay
- *   - L5 quote extraction and publication
+ *   - Depth-N quote extraction and publication
  *   - Graceful shutdown on signal
+ * 
+ * @tparam Depth Price levels per side
  */
+template<int Depth>
 class QuoteFeedHandler {
 public:
+    using QuoteBook = OrderBookManager<QuotePriceRep, Depth>;
+    using Quote = typename QuoteBook::Quote;
+    using Level = typename QuoteBook::Level;
+    using Delta = typename QuoteBook::Delta;
+    
     // ========================================================================
     // CONFIGURATION CONSTANTS
     // ========================================================================
     
-    /// Binance WebSocket host
-    static constexpr const char* BINANCE_HOST = "stream.binance.com";
-    
-    /// Binance WebSocket port (TLS)
-    static constexpr const char* BINANCE_PORT = "9443";
-    
     /// Nanoseconds between Unix epoch (1970) and kdb+ epoch (2000)
     static constexpr long long KDB_EPOCH_OFFSET_NS = 946684800000000000LL;
     
-    /// Initial reconnection backoff (milliseconds)
-    static constexpr int INITIAL_BACKOFF_MS = 1000;
-    
-    /// Maximum reconnection backoff (milliseconds)
-    static constexpr int MAX_BACKOFF_MS = 8000;
+    /// Shortest housekeeping tick (microseconds; bounds tiny batch delays)
+    static constexpr int MIN_TICK_US = 100;
     
-    /// Backoff multiplier
-    static constexpr int BACKOFF_MULTIPLIER = 2;
-    
-    /// Snapshot depth to request (get more than L5 for safety)
+    /// Snapshot depth to request (more than the deepest book for safety)
     static constexpr int SNAPSHOT_DEPTH = 50;
+    
+    /// Binance limit on streams per WebSocket connection (shard mode splits above this)
+    static constexpr int MAX_STREAMS_PER_CONNECTION = BinanceStream::MAX_STREAMS;
 
     // ========================================================================
     // CONSTRUCTION
@@ -98,10 +166,30 @@ public:
      * @param symbols List of symbols to subscribe to (lowercase, e.g., "btcusdt")
      * @param tpHost Tickerplant hostname
      * @param tpPort Tickerplant port
+     * @param batching Columnar batch publishing settings
+     * @param rest REST snapshot client settings
+     * @param quoteTable Target kdb+ table (schema generated for Depth)
+     * @param restLimiter Weight budget shared with other shards (nullptr = own)
+     * @param analytics In-process analytics settings (ignored in shard mode)
+     * @param shm Shared-memory TP transport settings (ignored in shard mode)
+     * @param conflation Latest-state-only publishing under load
+     * @param capture Raw input capture settings (shard i writes <path>.s<i>)
+     * @param outbound TP backlog bounds while reconnecting (ignored in shard mode)
+     * @param checkpoint Book checkpoint for warm restarts (shard i uses <path>.s<i>)
      */
     QuoteFeedHandler(const std::vector<std::string>& symbols,
                      const std::string& tpHost = "localhost",
-                     int tpPort = 5010);
+                     int tpPort = 5010,
+                     const BatchConfig& batching = BatchConfig(),
+                     const RestConfig& rest = RestConfig(),
+                     const std::string& quoteTable = "quote_binance",
+                     std::shared_ptr<WeightLimiter> restLimiter = nullptr,
+                     const AnalyticsConfig& analytics = AnalyticsConfig(),
+                     const ShmConfig& shm = ShmConfig(),
+                     const ConflationConfig& conflation = ConflationConfig(),
+                     const CaptureConfig& capture = CaptureConfig(),
+                     const OutboundConfig& outbound = OutboundConfig(),
+                     const CheckpointConfig& checkpoint = CheckpointConfig());
     
     /// Destructor - ensures cleanup
     ~QuoteFeedHandler();
@@ -129,6 +217,15 @@ public:
      */
     void stop();
     
+    /**
+     * @brief Replay a capture file instead of connecting to Binance
+     * 
+     * Call before run() (unsharded only). run() then processes the file
+     * once and returns; without useTp nothing is sent (updates are built
+     * and dropped).
+     */
+    void setReplay(const ReplayOptions& replay) { replay_ = replay; }
+    
     /**
      * @brief Check if handler is running
      */
@@ -138,6 +235,73 @@ public:
      * @brief Get count of messages processed
      */
     long long messageCount() const { return fhSeqNo_; }
+    
+    // ========================================================================
+    // SHARD MODE
+    // ========================================================================
+    
+    /**
+     * @brief Run as one shard of a sharded deployment
+     * 
+     * Must be called before run(). The handler then skips its own TP
+     * connection, batch and health publishing, and hands quotes to the
+     * shared publisher (which batches, sequences and reports health).
+     * 
+     * @param shardId Shard index (used in logs and the health handler name)
+     * @param publisher Shared TP publisher
+     */
+    void attachShard(int shardId, QuoteShardPublisher<Depth>* publisher) {
+        shardId_ = shardId;
+        shardPublisher_ = publisher;
+        batch_.reset();
+        analytics_.reset();
+        shm_.reset();
+    }
+    
+    int shardId() const { return shardId_; }
+    
+    // ========================================================================
+    // UNIFIED MODE (feed_handler)
+    // ========================================================================
+    
+    /**
+     * @brief Run on a shared connection instead of run()
+     * 
+     * Loads scales and the checkpoint, then registers this handler's
+     * depth streams, frame route, reconnect reset and timers on stream,
+     * and sends through tp (opened by the caller, used on the stream's
+     * thread only) instead of its own TP connection. No health row: the
+     * caller publishes one per connection from the accessors below. Call
+     * detach() once stream.run() returns.
+     */
+    void attach(BinanceStream& stream, TpOutbound& tp);
+    
+    /// Flush pending quotes, save the checkpoint, close the capture
+    void detach();
+    
+    // Health accessors (thread-safe)
+    std::chrono::system_clock::time_point startTime() const { return startTime_; }
+    long long msgsReceived() const { return msgsReceived_.load(std::memory_order_relaxed); }
+    long long msgsPublished() const { return msgsPublished_.load(std::memory_order_relaxed); }
+    std::chrono::system_clock::time_point lastMsgTime() const { return lastMsgTime_.load(std::memory_order_relaxed); }
+    std::chrono::system_clock::time_point lastPubTime() const { return lastPubTime_.load(std::memory_order_relaxed); }
+    const char* connState() const { return connState_.load(); }
+    long long conflated() const { return conflated_.load(std::memory_order_relaxed); }
+    int symbolCount() const { return static_cast<int>(symbolsLower_.size()); }
+    
+    /// Stage latency histograms (exported by whoever publishes health)
+    LatencyStats& latencyStats() { return *latency_; }
+    
+    // ========================================================================
+    // KDB+ ROW LAYOUT (shared with QuoteShardPublisher)
+    // ========================================================================
+    
+    /// Column types as sent by the FH: time, sym, 4*Depth price/qty,
+    /// isValid, exchEventTimeMs, fhRecvTimeUtcNs, fhSeqNo
+    static std::vector<int> batchColumnTypes();
+    
+    /// Append one quote as a row of a columnar batch (sym = quote.sym, interned)
+    static void appendToBatch(ColumnBatch& batch, const Quote& quote, S sym);
 
 private:
     // ========================================================================
@@ -146,8 +310,8 @@ private:
     
     std::vector<std::string> symbolsLower_;    // Lowercase for WebSocket subscription
     std::vector<std::string> symbolsUpper_;    // Uppercase for internal use
-    std::string tpHost_;
-    int tpPort_;
+    BatchConfig batching_;
+    SymAtom quoteTable_;
     
     // ========================================================================
     // STATE
@@ -156,21 +320,120 @@ private:
     /// Shutdown flag
     std::atomic<bool> running_{true};
     
-    /// Order book manager (flat arrays, all symbols)
-    std::unique_ptr<OrderBookManager> bookMgr_;
+    /// Order book manager (per-symbol blocks, all symbols)
+    std::unique_ptr<QuoteBook> bookMgr_;
+    
+    /// kdb+ symbols of the book's symbols, same indices (publishing thread only)
+    std::unique_ptr<InternedSymbols> interned_;
     
-    /// Tickerplant connection handle
-    int tpHandle_{-1};
+    /// Tickerplant connection and outage backlog (unused in shard mode):
+    /// this handler's own, created by run(), or the worker's in unified mode
+    std::string tpHost_;
+    int tpPort_;
+    OutboundConfig outboundCfg_;
+    std::unique_ptr<TpOutbound> ownTp_;
+    TpOutbound* tp_{nullptr};
+    SymAtom healthTable_{"health_feed_handler"};
+    SymAtom histTable_{"telemetry_fh_hist"};
     
     /// FH sequence number
     long long fhSeqNo_{0};
     
-    /// Binance reconnection attempt counter
-    int binanceReconnectAttempt_{0};
-    
-    /// REST client for snapshots
+    /// REST client for snapshots (async worker pool)
     RestClient restClient_;
     
+    /// Reused buffer for completed snapshot requests
+    std::vector<SnapshotResult> snapshotResults_;
+    
+    /// Reused in-situ JSON parser
+    JsonParser parser_;
+    
+    /// Reused decode target for live deltas (keeps vector capacity;
+    /// INIT-state deltas are decoded straight into the book's DeltaArena)
+    Delta scratchDelta_;
+    
+    /// Reused result of getTimeoutPublishNeeded()
+    std::vector<int> timeoutSymbols_;
+    
+    /// Steady time of the event being handled (read once per read, tick
+    /// or snapshot completion; used for publish decisions and heartbeats)
+    std::chrono::steady_clock::time_point loopNow_{std::chrono::steady_clock::now()};
+    
+    /// Event loop of the live connection (REST completions are posted to
+    /// it; nullptr between connections). Guarded by loopMutex_.
+    std::mutex loopMutex_;
+    net::io_context* loopIoc_{nullptr};
+    
+    // ========================================================================
+    // STAGE LATENCY
+    // ========================================================================
+    
+    /// Stage latency histograms (per symbol and handler-level)
+    std::unique_ptr<LatencyStats> latency_;
+    
+    /// End of the previous stage for the message in flight (monotonic ns):
+    /// socket read, then parse, then book apply
+    long long stageMarkNs_{0};
+    
+    /// Reused decode targets for snapshot levels
+    std::vector<Level> snapshotBids_;
+    std::vector<Level> snapshotAsks_;
+    
+    /// Columnar quote batch (batching mode only)
+    std::unique_ptr<ColumnBatch> batch_;
+    
+    /// Quote metrics stage (analytics enabled, unsharded only)
+    std::unique_ptr<AnalyticsEngine> analytics_;
+    
+    /// Shared-memory TP transport (shm enabled, unsharded only)
+    std::unique_ptr<ShmPublisher> shm_;
+    
+    /// Conflation settings and per-symbol opt-out (1 = publish per tick)
+    ConflationConfig conflation_;
+    std::vector<uint8_t> critical_;
+    
+    /// Shard index (-1 = unsharded)
+    int shardId_{-1};
+    
+    /// Shared TP publisher (shard mode only, not owned)
+    QuoteShardPublisher<Depth>* shardPublisher_{nullptr};
+    
+    // ========================================================================
+    // CAPTURE / REPLAY
+    // ========================================================================
+    
+    CaptureConfig captureCfg_;
+    
+    /// Raw input capture (capture enabled only; handler thread)
+    std::unique_ptr<capture::Writer> capture_;
+    
+    /// Reused text of a captured snapshot or checkpoint record
+    std::string captureText_;
+    
+    // ========================================================================
+    // CHECKPOINT (warm start)
+    // ========================================================================
+    
+    CheckpointConfig checkpointCfg_;
+    
+    /// Book checkpoint being written (checkpoint enabled, live mode only)
+    std::unique_ptr<checkpoint::Writer> checkpoint_;
+    
+    /// 1 = restored from the checkpoint, not yet confirmed by a delta
+    std::vector<uint8_t> warm_;
+    int warmPending_{0};
+    int warmHits_{0};
+    int warmMisses_{0};
+    
+    /// Books were restored: the first connect keeps them instead of resetting
+    bool keepBooksOnConnect_{false};
+    
+    /// Replay source (empty path = live)
+    ReplayOptions replay_;
+    
+    /// Replay without a TP: updates are built and dropped
+    bool dryRun_{false};
+    
     // ========================================================================
     // HEALTH TRACKING
     // ========================================================================
@@ -178,60 +441,151 @@ private:
     /// Handler start time (for uptime calculation)
     std::chrono::system_clock::time_point startTime_;
     
+    // Counters are atomic: in shard mode the shared publisher thread reads
+    // them to build this shard's health row.
+    
     /// Total messages received from Binance
-    long long msgsReceived_{0};
+    std::atomic<long long> msgsReceived_{0};
     
-    /// Total messages published to TP
-    long long msgsPublished_{0};
+    /// Total messages published to TP (handed to the shard publisher in shard mode)
+    std::atomic<long long> msgsPublished_{0};
     
     /// Time of last message received
-    std::chrono::system_clock::time_point lastMsgTime_;
+    std::atomic<std::chrono::system_clock::time_point> lastMsgTime_{};
     
     /// Time of last publish to TP
-    std::chrono::system_clock::time_point lastPubTime_;
+    std::atomic<std::chrono::system_clock::time_point> lastPubTime_{};
     
-    /// Current connection state
-    std::string connState_{"disconnected"};
+    /// Quote states superseded by a later one before publish (conflation)
+    std::atomic<long long> conflated_{0};
+    
+    /// Current connection state (static string literal)
+    std::atomic<const char*> connState_{"disconnected"};
     
     /// Health publish interval in seconds
     static constexpr int HEALTH_INTERVAL_SEC = 5;
+    
+    /// Running on a shared connection (attach())
+    bool attached_{false};
 
     // ========================================================================
     // PRIVATE METHODS
     // ========================================================================
     
-    /// Build WebSocket path for depth streams
-    std::string buildDepthStreamPath() const;
+    /// Register depth streams, frame route, reconnect reset and timers on a connection
+    void registerOn(BinanceStream& stream);
+    
+    /// Handle one depth frame (mutable, NUL-terminated; parsed in place)
+    void onFrame(char* msg, size_t len, long long fhRecvTimeUtcNs);
+    
+    /// Reset every book before a (re)connect, unless just restored from the checkpoint
+    void resetBooks();
+    
+    /// Scales and warm start before the first connect (live mode)
+    void prepareBooks();
     
-    /// Connect to tickerplant with retry
-    bool connectToTP();
+    /// Publish what is pending and save the checkpoint (after the stream stopped)
+    void finishBooks();
     
-    /// Sleep with exponential backoff
-    bool sleepWithBackoff(int attempt);
+    /// Housekeeping tick: publish timeouts and batch delay, whichever is finer
+    std::chrono::microseconds timerTick() const;
     
-    /// Process incoming WebSocket message
-    void processMessage(const std::string& msg, long long fhRecvTimeUtcNs);
+    /// Set (or clear) the loop that REST completions are posted to
+    void setLoop(net::io_context* ioc) {
+        std::lock_guard<std::mutex> lock(loopMutex_);
+        loopIoc_ = ioc;
+    }
+    
+    /// Process incoming WebSocket message (mutable, NUL-terminated; parsed in place)
+    void processMessage(char* msg, long long fhRecvTimeUtcNs);
     
     /// Handle delta based on current book state
-    void handleDelta(int symIdx, const BufferedDelta& delta, long long fhRecvTimeUtcNs);
+    void handleDelta(int symIdx, const Delta& delta, long long fhRecvTimeUtcNs);
+    
+    /// A wire level was off the symbol's tick/lot grid (not applied):
+    /// invalidate the book and rebuild it in 1e-8 units from a snapshot
+    void resyncOffGrid(int symIdx, long long fhRecvTimeUtcNs);
     
-    /// Request and apply snapshot for a symbol
+    /// Load per-symbol tick/lot sizes from exchangeInfo into the book
+    void loadInstrumentScales();
+    
+    /// Queue an async snapshot request for a symbol (non-blocking)
     void requestSnapshot(int symIdx);
     
-    /// Maybe publish L5 for a symbol
+    /// Apply any snapshots completed by the REST workers
+    void processSnapshotCompletions();
+    
+    /// Apply one snapshot + buffered deltas (discarded if stale)
+    void applySnapshotResult(SnapshotResult& result);
+    
+    /// Record time since the previous stage mark and advance the mark
+    void recordStage(latency::Stage stage, int symIdx) {
+        const long long now = latency::nowNs();
+        latency_->record(stage, symIdx, now - stageMarkNs_);
+        stageMarkNs_ = now;
+    }
+    
+    /// Maybe publish quote for a symbol
     void maybePublish(int symIdx, long long fhRecvTimeUtcNs);
     
     /// Publish invalid state for a symbol
     void publishInvalid(int symIdx, long long fhRecvTimeUtcNs);
     
-    /// Publish L5 quote to kdb+
-    void publishL5(const L5Quote& quote);
+    /// Publish quote to kdb+ (row, or append to batch) and update its analytics
+    void publishQuote(int symIdx, const Quote& quote);
+    
+    /// Send pending batch if full or past its delay (force = always)
+    void flushBatch(bool force = false);
+    
+    /// Send pending analytics rows if full or past their delay (force = always)
+    void flushAnalytics(bool force = false);
+    
+    /// Send .u.upd[table; data] to TP, queued while it reconnects (takes ownership)
+    bool sendToTP(SymAtom& table, K data);
+    
+    /// TP opened (sends are delivered or queued), or replaying without one (dropped)
+    bool tpReady() const { return tp_->isOpen() || dryRun_; }
     
     /// Check publish timeouts for all symbols
     void checkPublishTimeouts(long long fhRecvTimeUtcNs);
     
-    /// Run the WebSocket connection loop
-    void runWebSocketLoop();
+    /// Publish the latest state of every dirty symbol (conflation)
+    void flushConflated();
+    
+    /// Nothing queued downstream: TP backlog and socket send queue, shm ring or shard ring
+    bool downstreamIdle() const;
+    
+    /// Open the capture file (live mode, capture enabled)
+    void openCapture();
+    
+    /// Append a snapshot as applied (REC_SNAPSHOT)
+    void captureSnapshot(const SnapshotResult& result);
+    
+    /// Append a book as restored from the checkpoint (REC_CHECKPOINT)
+    void captureCheckpoint(int symIdx);
+    
+    /// Checkpoint file of this handler (shard i: <path>.s<i>)
+    std::string checkpointPath() const;
+    
+    /// Restore books from the checkpoint (before the first connect)
+    void restoreCheckpoint();
+    
+    /// Create the checkpoint file written from now on
+    void openCheckpoint();
+    
+    /// Save every VALID book to the checkpoint
+    void saveCheckpoint();
+    
+    /// A restored book was confirmed (hit) or resynced via REST (miss)
+    void resolveWarm(int symIdx, bool hit);
+    
+    /// Apply a captured REC_SCALE / REC_SNAPSHOT / REC_CHECKPOINT record
+    void applyCapturedScale(const capture::Reader::Record& rec);
+    void applyCapturedSnapshot(const capture::Reader::Record& rec);
+    void applyCapturedCheckpoint(const capture::Reader::Record& rec);
+    
+    /// Feed the replay file through the book and publish path (replay mode)
+    void runReplay();
     
     /// Publish health metrics to TP
     void publishHealth();
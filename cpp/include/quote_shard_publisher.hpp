@@ -0,0 +1,462 @@
+/**
+ * @file quote_shard_publisher.hpp
+ * @brief Shared batched TP publisher for sharded quote handlers
+ *
+ * In shard mode the symbol set is split across K QuoteFeedHandler
+ * instances, each with its own WebSocket connection, thread and
+ * OrderBookManager slice. They do not talk to the TP themselves: each
+ * shard pushes its quotes into its own SPSC ring and this publisher's
+ * single thread drains all rings into one columnar batch.
+ *
+ *   shard 0 ──ring──┐
+ *   shard 1 ──ring──┼──► publisher thread ──► .u.upd[quote_binance; cols]
+ *   shard K ──ring──┘          │
+ *                              ├──► health_feed_handler (one row per shard
+ *                              │    + one publisher row) and each shard's
+ *                              │    telemetry_fh_hist rows
+ *                              └──► analytics_binance (analytics enabled)
+ *
+ * Sequencing:
+ *   fhSeqNo is reassigned here, in publish order, so the table keeps one
+ *   contiguous sequence regardless of how many shards feed it. A quote
+ *   dropped on a full ring is never sequenced; drops are reported per
+ *   shard in the queueOverflows health column instead. While the TP is
+ *   reconnecting, batches queue in the TpOutbound backlog and are
+ *   replayed in order (see tp_outbound.hpp).
+ *
+ * Thread safety:
+ *   - push(shard, ...) only from that shard's thread
+ *   - Everything else from the thread that owns the publisher
+ */
+
+#ifndef QUOTE_SHARD_PUBLISHER_HPP
+#define QUOTE_SHARD_PUBLISHER_HPP
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analytics_engine.hpp"
+#include "config.hpp"
+#include "cpu_affinity.hpp"
+#include "kdb_symbols.hpp"
+#include "shm_publisher.hpp"
+#include "spsc_ring.hpp"
+#include "symbol_table.hpp"
+#include "tp_outbound.hpp"
+#include "quote_feed_handler.hpp"
+
+template<int Depth>
+class QuoteShardPublisher {
+public:
+    using Handler = QuoteFeedHandler<Depth>;
+    using Quote = typename Handler::Quote;
+
+    /// Quotes taken from one ring before moving to the next (fairness)
+    static constexpr int DRAIN_BURST = 64;
+
+    /// Health publish interval (seconds)
+    static constexpr int HEALTH_INTERVAL_SEC = 5;
+
+    /**
+     * @param tpHost Tickerplant hostname
+     * @param tpPort Tickerplant port
+     * @param quoteTable Target kdb+ table (schema generated for Depth)
+     * @param batching Batch thresholds (always batched in shard mode)
+     * @param sharding Ring capacity and publisher CPU
+     * @param numShards Number of shards that will be attached
+     * @param analytics In-process analytics settings (computed on this thread)
+     * @param symbols All shards' symbols (lowercase, as in the config)
+     * @param shm Shared-memory TP transport settings
+     * @param outbound TP backlog bounds while reconnecting
+     */
+    QuoteShardPublisher(const std::string& tpHost, int tpPort,
+                        const std::string& quoteTable,
+                        const BatchConfig& batching,
+                        const ShardConfig& sharding,
+                        int numShards,
+                        const AnalyticsConfig& analytics = AnalyticsConfig(),
+                        const std::vector<std::string>& symbols = {},
+                        const ShmConfig& shm = ShmConfig(),
+                        const OutboundConfig& outbound = OutboundConfig())
+        : quoteTable_(quoteTable)
+        , publisherCpu_(sharding.publisherCpu)
+        , batch_(quoteTable, Handler::batchColumnTypes(), batching.maxRows, batching.maxDelayUs)
+        , symbols_(upperSymbols(symbols))
+        , interned_(symbols_.names())
+        , tp_(tpHost, tpPort, outbound, running_)
+        , latency_(std::vector<std::string>{})
+        , startTime_(std::chrono::system_clock::now())
+    {
+        const size_t capacity = static_cast<size_t>(std::max(sharding.queueCapacity, 2));
+        for (int i = 0; i < numShards; ++i) {
+            shards_.push_back(std::make_unique<Shard>(capacity));
+        }
+        if (analytics.enabled) {
+            analytics_ = std::make_unique<AnalyticsEngine>(symbols_.names(), analytics, batching);
+        }
+        if (shm.enabled) {
+            shm_ = std::make_unique<ShmPublisher>(shm);
+        }
+    }
+
+    ~QuoteShardPublisher() {
+        finish();
+    }
+
+    // Non-copyable (owns TP handle and thread)
+    QuoteShardPublisher(const QuoteShardPublisher&) = delete;
+    QuoteShardPublisher& operator=(const QuoteShardPublisher&) = delete;
+
+    /**
+     * @brief Attach a handler as shard shardId (before start())
+     */
+    void attach(int shardId, Handler& handler) {
+        shards_[shardId]->handler = &handler;
+        handler.attachShard(shardId, this);
+    }
+
+    /**
+     * @brief Queue a quote from a shard (shard thread only, never blocks)
+     * @return false if the shard's ring is full (quote dropped)
+     */
+    bool push(int shardId, const Quote& quote) {
+        Shard& shard = *shards_[shardId];
+        if (shard.ring.tryPush(quote)) {
+            return true;
+        }
+        long long n = ++shard.overflows;
+        if ((n & (n - 1)) == 0) {  // Log at powers of two to avoid spam
+            spdlog::warn("Shard {} publish queue full, dropped {} quotes so far", shardId, n);
+        }
+        return false;
+    }
+
+    /// Quotes a shard has queued that this thread has not taken yet (any thread)
+    size_t queued(int shardId) const { return shards_[shardId]->ring.size(); }
+
+    /**
+     * @brief Connect to the TP and start the publisher thread
+     * @return false if stopped before the TP connection was established
+     */
+    bool start() {
+        if (!tp_.connect()) {
+            return false;
+        }
+        spdlog::info("Shard publisher: {} shards, queue capacity {} (publisher cpu {})",
+            shards_.size(), shards_.empty() ? 0 : shards_[0]->ring.capacity(), publisherCpu_);
+        thread_ = std::thread(&QuoteShardPublisher::runLoop, this);
+        return true;
+    }
+
+    /**
+     * @brief Abort TP connect/reconnect waits (signal-safe flag only)
+     */
+    void stop() {
+        running_ = false;
+    }
+
+    /**
+     * @brief All shards have exited: drain rings, flush, join thread
+     */
+    void finish() {
+        producersDone_ = true;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    /// Config symbols (lowercase stream names) as they appear in quotes
+    static std::vector<std::string> upperSymbols(const std::vector<std::string>& symbols) {
+        std::vector<std::string> upper;
+        for (std::string s : symbols) {
+            std::transform(s.begin(), s.end(), s.begin(), ::toupper);
+            upper.push_back(s);
+        }
+        return upper;
+    }
+
+    struct Shard {
+        explicit Shard(size_t capacity) : ring(capacity) {}
+
+        SpscRing<Quote> ring;
+        std::atomic<long long> overflows{0};
+        Handler* handler = nullptr;
+    };
+
+    // ========================================================================
+    // PUBLISHER LOOP
+    // ========================================================================
+
+    void runLoop() {
+        if (!pinCurrentThread(publisherCpu_)) {
+            spdlog::warn("Failed to pin shard publisher thread to CPU {}", publisherCpu_);
+        }
+        spdlog::info("Shard publisher thread started");
+
+        // Spin briefly before yielding when all rings are empty
+        constexpr int SPINS_BEFORE_YIELD = 1000;
+
+        auto lastHealthPub = std::chrono::steady_clock::now();
+        int idleSpins = 0;
+
+        while (true) {
+            // Read the flag before draining so nothing pushed before it
+            // was set can be left behind
+            const bool done = producersDone_;
+
+            if (drainOnce() > 0) {
+                idleSpins = 0;
+            } else if (done) {
+                flushBatch(true);
+                break;  // Shards exited and rings drained
+            } else if (++idleSpins >= SPINS_BEFORE_YIELD) {
+                idleSpins = 0;
+                std::this_thread::yield();
+            }
+
+            // Send a partial batch once it has waited max_delay_us, and
+            // replay any TP backlog
+            flushBatch(false);
+            tp_.poll();
+
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - lastHealthPub).count() >= HEALTH_INTERVAL_SEC) {
+                publishHealth();
+                lastHealthPub = now;
+            }
+        }
+
+        // On this thread: the backlog's K objects never leave it
+        tp_.close();  // Replays what it can of any backlog first
+        spdlog::info("Shard publisher thread exiting (published {} quotes)", fhSeqNo_);
+    }
+
+    /**
+     * @brief Take up to DRAIN_BURST quotes from each ring, round-robin
+     * @return Number of quotes appended to the batch
+     */
+    int drainOnce() {
+        int taken = 0;
+        for (auto& shard : shards_) {
+            for (int i = 0; i < DRAIN_BURST && shard->ring.tryPop(scratch_); ++i) {
+                scratch_.fhSeqNo = ++fhSeqNo_;
+                const int symIdx = symbols_.find(scratch_.sym, std::strlen(scratch_.sym));
+                Handler::appendToBatch(batch_, scratch_,
+                    symIdx >= 0 ? interned_.sym(symIdx) : ss((S)scratch_.sym));
+                ++taken;
+                if (analytics_) {
+                    analytics_->onQuote(symIdx,
+                        scratch_.bidPrices, scratch_.bidQtys, scratch_.askPrices,
+                        scratch_.askQtys, scratch_.isValid, scratch_.fhRecvTimeUtcNs);
+                }
+                if (batch_.full() || (analytics_ && analytics_->batch().full())) {
+                    flushBatch(true);
+                }
+            }
+        }
+        return taken;
+    }
+
+    void flushBatch(bool force) {
+        flushAnalytics(force);
+        if (batch_.empty()) return;
+        if (!force && !batch_.full() && !batch_.due(std::chrono::steady_clock::now())) return;
+
+        int rows = batch_.rows();
+        K data = batch_.take();
+
+        spdlog::debug("Shard quote batch: rows={}", rows);
+
+        sendToTP(quoteTable_, data);
+
+        lastPubTime_ = std::chrono::system_clock::now();
+        rowsPublished_ += rows;
+    }
+
+    void flushAnalytics(bool force) {
+        if (!analytics_) return;
+        ColumnBatch& batch = analytics_->batch();
+        if (batch.empty()) return;
+        if (!force && !batch.full() && !batch.due(std::chrono::steady_clock::now())) return;
+
+        sendToTP(analytics_->tableAtom(), batch.take());
+    }
+
+    // ========================================================================
+    // TP CONNECTION
+    // ========================================================================
+
+    bool sendToTP(SymAtom& table, K data) {
+        long long sendStartNs = latency::nowNs();
+        if (shm_ && shm_->publish(table, data)) {
+            latency_.record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+            r0(data);
+            return true;
+        }
+
+        // Queued (not blocked on) while the TP reconnects
+        const bool sent = tp_.send(table, data);
+        latency_.record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+        return sent;
+    }
+
+    // ========================================================================
+    // HEALTH
+    // ========================================================================
+
+    /**
+     * @brief Publish one health row per shard plus one for the publisher
+     *
+     * Shard rows (handler quote_fh_s<i>): that shard's receive/publish
+     * counters, WebSocket state, symbols, ring depth and drops.
+     * Publisher row (handler quote_fh): totals, rows handed to the TP
+     * connection, its state and its outage backlog.
+     */
+    void publishHealth() {
+        if (!tp_.isOpen()) return;
+
+        auto now = std::chrono::system_clock::now();
+
+        auto toKdbTs = [](std::chrono::system_clock::time_point tp) -> long long {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                tp.time_since_epoch()).count() - Handler::KDB_EPOCH_OFFSET_NS;
+        };
+        auto uptimeOf = [&now](std::chrono::system_clock::time_point start) -> long long {
+            return std::chrono::duration_cast<std::chrono::seconds>(now - start).count();
+        };
+
+        long long totalReceived = 0;
+        long long totalDepth = 0;
+        long long totalOverflows = 0;
+        long long totalConflated = 0;
+        int totalSymbols = 0;
+        auto lastMsg = std::chrono::system_clock::time_point{};
+
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            const Shard& shard = *shards_[i];
+            const Handler* h = shard.handler;
+            if (!h) continue;
+
+            const long long depth = static_cast<long long>(shard.ring.size());
+            const long long overflows = shard.overflows.load(std::memory_order_relaxed);
+            const std::string name = "quote_fh_s" + std::to_string(i);
+
+            K row = knk(16,
+                ktj(-KP, toKdbTs(now)),                 // time
+                ks((S)name.c_str()),                     // handler
+                ktj(-KP, toKdbTs(h->startTime())),      // startTimeUtc
+                kj(uptimeOf(h->startTime())),            // uptimeSec
+                kj(h->msgsReceived()),                   // msgsReceived
+                kj(h->msgsPublished()),                  // msgsPublished (queued)
+                ktj(-KP, toKdbTs(h->lastMsgTime())),    // lastMsgTimeUtc
+                ktj(-KP, toKdbTs(h->lastPubTime())),    // lastPubTimeUtc
+                ks((S)h->connState()),                   // connState (WebSocket)
+                ki(h->symbolCount()),                    // symbolCount
+                kj(depth),                               // queueDepth
+                kj(overflows),                           // queueOverflows
+                kj(h->conflated()),                      // conflated
+                kj(0LL),                                 // tpBacklog (publisher row)
+                kj(0LL),                                 // tpSpilled
+                kj(0LL)                                  // tpDropped
+            );
+            tp_.send(healthTable_, row);
+            sendHistograms(shard.handler->latencyStats(), name.c_str(), toKdbTs(now));
+
+            totalReceived += h->msgsReceived();
+            totalDepth += depth;
+            totalOverflows += overflows;
+            totalConflated += h->conflated();
+            totalSymbols += h->symbolCount();
+            lastMsg = std::max(lastMsg, h->lastMsgTime());
+        }
+
+        K row = knk(16,
+            ktj(-KP, toKdbTs(now)),                     // time
+            ks((S)"quote_fh"),                           // handler
+            ktj(-KP, toKdbTs(startTime_)),              // startTimeUtc
+            kj(uptimeOf(startTime_)),                    // uptimeSec
+            kj(totalReceived),                           // msgsReceived
+            kj(rowsPublished_),                          // msgsPublished (sent to TP)
+            ktj(-KP, toKdbTs(lastMsg)),                 // lastMsgTimeUtc
+            ktj(-KP, toKdbTs(lastPubTime_)),            // lastPubTimeUtc
+            ks((S)(tp_.handle() > 0 ? "connected" : "reconnecting")),  // connState (TP)
+            ki(totalSymbols),                            // symbolCount
+            kj(totalDepth),                              // queueDepth
+            kj(totalOverflows),                          // queueOverflows
+            kj(totalConflated),                          // conflated
+            kj(tp_.backlog()),                           // tpBacklog
+            kj(tp_.spilled()),                           // tpSpilled
+            kj(tp_.dropped())                            // tpDropped
+        );
+        tp_.send(healthTable_, row);
+        sendHistograms(latency_, "quote_fh", toKdbTs(now));
+
+        spdlog::debug("Shard health published: shards={} msgs={}/{} queued={} dropped={} tpBacklog={}",
+            shards_.size(), totalReceived, rowsPublished_, totalDepth, totalOverflows, tp_.backlog());
+    }
+
+    /// Publish a handler's stage histograms for the interval since the last call
+    void sendHistograms(LatencyStats& stats, const char* handler, long long kdbTimeNs) {
+        K hist = stats.takeInterval(handler, kdbTimeNs);
+        if (hist) {
+            tp_.send(histTable_, hist);
+        }
+    }
+
+    // ========================================================================
+    // MEMBERS
+    // ========================================================================
+
+    SymAtom quoteTable_;
+    SymAtom healthTable_{"health_feed_handler"};
+    SymAtom histTable_{"telemetry_fh_hist"};
+    int publisherCpu_;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    /// Shared columnar batch (publisher thread only)
+    ColumnBatch batch_;
+
+    /// All shards' symbols (uppercase) and their kdb+ symbols (publisher thread only)
+    SymbolTable symbols_;
+    InternedSymbols interned_;
+
+    /// Quote metrics stage (analytics enabled only; publisher thread only)
+    std::unique_ptr<AnalyticsEngine> analytics_;
+
+    /// Shared-memory TP transport (shm enabled only; publisher thread only)
+    std::unique_ptr<ShmPublisher> shm_;
+
+    /// Pop target reused across quotes
+    Quote scratch_;
+
+    /// Table-wide sequence number, assigned in publish order
+    long long fhSeqNo_{0};
+
+    std::atomic<bool> running_{true};
+    std::atomic<bool> producersDone_{false};
+    std::thread thread_;
+
+    /// TP connection and outage backlog (publisher thread once started)
+    TpOutbound tp_;
+
+    /// Send-stage histogram for batched TP writes (handler-level only)
+    LatencyStats latency_;
+
+    // Publisher health (publisher thread only)
+    std::chrono::system_clock::time_point startTime_;
+    std::chrono::system_clock::time_point lastPubTime_{};
+    long long rowsPublished_{0};
+};
+
+#endif // QUOTE_SHARD_PUBLISHER_HPP
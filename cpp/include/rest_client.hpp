@@ -1,11 +1,32 @@
 /**
  * @file rest_client.hpp
  * @brief HTTPS REST client for Binance API using Boost.Beast
- * 
+ *
  * Used to fetch order book snapshots for reconciliation.
- * Synchronous implementation - blocks until response received.
- * 
+ *
+ * Two interfaces:
+ *   - fetchSnapshot():      synchronous, on the caller's thread
+ *   - fetchSnapshotAsync(): queued to a worker pool; results collected
+ *                           on the book thread with pollCompletions(),
+ *                           optionally prompted by a completion notifier
+ *
+ * Connection handling:
+ *   - Each worker owns one persistent HTTP/1.1 keep-alive TLS connection
+ *     (no resolve/connect/handshake per request)
+ *   - On reconnect the previous TLS session is offered for resumption
+ *   - Every step (resolve, connect, TLS handshake, write, read, TLS
+ *     shutdown) has a REQUEST_TIMEOUT_SEC deadline, so a half-open idle
+ *     connection cannot hang a worker (or stop() joining it)
+ *   - A dropped or timed-out keep-alive connection is re-established and
+ *     the request retried once
+ *
+ * Rate limiting:
+ *   Binance limits REST usage by request weight per minute per IP. A shared
+ *   token bucket charges each request its weight before it is sent, and a
+ *   429/418 response pauses all workers for the Retry-After period.
+ *
  * @see https://binance-docs.github.io/apidocs/spot/en/#order-book
+ * @see https://binance-docs.github.io/apidocs/spot/en/#limits
  */
 
 #ifndef REST_CLIENT_HPP
@@ -19,10 +40,20 @@
 #include <boost/asio/ssl/context.hpp>
 
 #include <rapidjson/document.h>
-
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
-#include <iostream>
 #include <stdexcept>
 
 #include "order_book_manager.hpp"
@@ -33,122 +64,584 @@ namespace net = boost::asio;
 namespace ssl = net::ssl;
 using tcp = net::ip::tcp;
 
+/**
+ * @brief Price level as received (decimal strings, e.g. "43250.12000000")
+ *
+ * Kept undecoded so the book thread can convert into its own
+ * representation (double or ticks) with the symbol's current scale.
+ * Short enough for the small-string buffer (no heap allocation).
+ */
+struct DecimalLevel {
+    std::string price;
+    std::string qty;
+};
+
 /**
  * @brief Snapshot data returned from REST API
  */
 struct SnapshotData {
     long long lastUpdateId = 0;
-    std::vector<PriceLevel> bids;
-    std::vector<PriceLevel> asks;
+    std::vector<DecimalLevel> bids;
+    std::vector<DecimalLevel> asks;
+    bool success = false;
+    std::string error;
+};
+
+/**
+ * @brief Trading filters for one symbol from exchangeInfo
+ */
+struct SymbolFilters {
+    std::string symbol;
+    std::string tickSize;   // PRICE_FILTER.tickSize
+    std::string stepSize;   // LOT_SIZE.stepSize
+};
+
+/**
+ * @brief exchangeInfo subset returned from REST API
+ */
+struct ExchangeInfoData {
+    std::vector<SymbolFilters> symbols;
     bool success = false;
     std::string error;
 };
 
 /**
- * @brief Synchronous HTTPS REST client for Binance
+ * @brief Completed async snapshot request
+ */
+struct SnapshotResult {
+    int symIdx = -1;            // Caller's symbol index
+    long long generation = 0;   // Caller's book generation at request time
+    SnapshotData data;
+};
+
+/**
+ * @brief Binance request weight for GET /api/v3/depth
+ */
+inline int depthRequestWeight(int limit) {
+    if (limit <= 100) return 5;
+    if (limit <= 500) return 25;
+    if (limit <= 1000) return 50;
+    return 250;
+}
+
+/// Binance request weight for GET /api/v3/exchangeInfo
+constexpr int EXCHANGE_INFO_WEIGHT = 20;
+
+/**
+ * @brief Token bucket over Binance request weight (shared by workers)
+ */
+class WeightLimiter {
+public:
+    explicit WeightLimiter(int weightPerMinute)
+        : capacity_(std::max(weightPerMinute, 1))
+        , tokens_(capacity_)
+        , lastRefill_(std::chrono::steady_clock::now())
+    {
+    }
+
+    /**
+     * @brief Block until the given weight is available, then consume it
+     * @param stop Abort flag (returns false if set while waiting)
+     */
+    bool acquire(int weight, const std::atomic<bool>& stop) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop) {
+            auto now = std::chrono::steady_clock::now();
+            refill(now);
+            if (now >= pausedUntil_ && tokens_ >= weight) {
+                tokens_ -= weight;
+                return true;
+            }
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            lock.lock();
+        }
+        return false;
+    }
+
+    /**
+     * @brief Pause all requests (HTTP 429/418 with Retry-After)
+     */
+    void pauseFor(std::chrono::seconds duration) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pausedUntil_ = std::max(pausedUntil_, std::chrono::steady_clock::now() + duration);
+    }
+
+private:
+    void refill(std::chrono::steady_clock::time_point now) {
+        double elapsedSec = std::chrono::duration<double>(now - lastRefill_).count();
+        tokens_ = std::min<double>(capacity_, tokens_ + elapsedSec * capacity_ / 60.0);
+        lastRefill_ = now;
+    }
+
+    std::mutex mutex_;
+    int capacity_;
+    double tokens_;
+    std::chrono::steady_clock::time_point lastRefill_;
+    std::chrono::steady_clock::time_point pausedUntil_{};
+};
+
+/**
+ * @brief One persistent keep-alive HTTPS connection (single thread use)
+ */
+class RestConnection {
+public:
+    /// Deadline of each step of a request (seconds)
+    static constexpr int REQUEST_TIMEOUT_SEC = 10;
+
+    RestConnection(ssl::context& ctx, std::string host, std::string port)
+        : ctx_(ctx), host_(std::move(host)), port_(std::move(port)) {}
+
+    ~RestConnection() {
+        close();
+        if (session_) SSL_SESSION_free(session_);
+    }
+
+    RestConnection(const RestConnection&) = delete;
+    RestConnection& operator=(const RestConnection&) = delete;
+
+    /**
+     * @brief GET a target, reusing the connection (reconnect + retry once)
+     * @throws beast::system_error on network failure or timeout after retry
+     */
+    http::response<http::string_body> get(const std::string& target) {
+        for (int attempt = 0; ; ++attempt) {
+            try {
+                if (!stream_) connect();
+                return send(target);
+            } catch (const std::exception&) {
+                close();
+                if (attempt > 0) throw;
+                // Server may have closed (or silently dropped) the idle
+                // keep-alive connection
+            }
+        }
+    }
+
+    void close() {
+        if (!stream_) return;
+        // Bounded: a half-open peer never answers close_notify
+        beast::get_lowest_layer(*stream_).expires_after(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        stream_->async_shutdown([](const beast::error_code&) {});  // Ignore shutdown errors (common with SSL)
+        runIo();
+        stream_.reset();
+    }
+
+    bool lastHandshakeResumed() const { return resumed_; }
+
+private:
+    ssl::context& ctx_;
+    std::string host_;
+    std::string port_;
+    net::io_context ioc_;
+    std::optional<beast::ssl_stream<beast::tcp_stream>> stream_;
+    beast::flat_buffer buffer_;
+    SSL_SESSION* session_ = nullptr;
+    bool resumed_ = false;
+
+    void connect() {
+        stream_.emplace(ioc_, ctx_);
+
+        // Set SNI hostname
+        if (!SSL_set_tlsext_host_name(stream_->native_handle(), host_.c_str())) {
+            throw beast::system_error(
+                beast::error_code(static_cast<int>(::ERR_get_error()),
+                                  net::error::get_ssl_category()),
+                "Failed to set SNI hostname");
+        }
+
+        // Offer previous session for abbreviated handshake
+        if (session_) {
+            SSL_set_session(stream_->native_handle(), session_);
+        }
+
+        // Resolve (the resolver has no deadline of its own: cancel it)
+        tcp::resolver resolver(ioc_);
+        tcp::resolver::results_type results;
+        beast::error_code ec;
+        bool resolved = false;
+        resolver.async_resolve(host_, port_,
+            [&](const beast::error_code& e, tcp::resolver::results_type r) {
+                ec = e;
+                results = std::move(r);
+                resolved = true;
+            });
+        ioc_.restart();
+        ioc_.run_for(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        if (!resolved) {
+            resolver.cancel();
+            runIo();
+            ec = beast::error::timeout;
+        }
+        check(ec, "resolve");
+
+        // Connect
+        auto& tcpStream = beast::get_lowest_layer(*stream_);
+        tcpStream.expires_after(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        tcpStream.async_connect(results, [&](const beast::error_code& e, const tcp::endpoint&) { ec = e; });
+        runIo();
+        check(ec, "connect");
+
+        // TLS handshake
+        tcpStream.expires_after(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        stream_->async_handshake(ssl::stream_base::client, [&](const beast::error_code& e) { ec = e; });
+        runIo();
+        check(ec, "TLS handshake");
+        resumed_ = SSL_session_reused(stream_->native_handle()) == 1;
+        buffer_.clear();
+    }
+
+    http::response<http::string_body> send(const std::string& target) {
+        // Build HTTP request (keep-alive is the HTTP/1.1 default)
+        http::request<http::string_body> req{http::verb::get, target, 11};
+        req.set(http::field::host, host_);
+        req.set(http::field::user_agent, "binance-feed-handler/1.0");
+        req.keep_alive(true);
+
+        // tcp_stream deadlines apply to async operations only
+        auto& tcpStream = beast::get_lowest_layer(*stream_);
+        beast::error_code ec;
+        tcpStream.expires_after(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        http::async_write(*stream_, req, [&](const beast::error_code& e, std::size_t) { ec = e; });
+        runIo();
+        check(ec, "write");
+
+        http::response<http::string_body> res;
+        tcpStream.expires_after(std::chrono::seconds(REQUEST_TIMEOUT_SEC));
+        http::async_read(*stream_, buffer_, res, [&](const beast::error_code& e, std::size_t) { ec = e; });
+        runIo();
+        check(ec, "read");
+        tcpStream.expires_never();
+
+        // Keep the (possibly ticket-updated) session for the next reconnect
+        if (SSL_SESSION* s = SSL_get1_session(stream_->native_handle())) {
+            if (session_) SSL_SESSION_free(session_);
+            session_ = s;
+        }
+
+        if (!res.keep_alive()) {
+            close();
+        }
+        return res;
+    }
+
+    /// Run the connection's loop until the pending operation completes
+    void runIo() {
+        ioc_.restart();
+        ioc_.run();
+    }
+
+    static void check(const beast::error_code& ec, const char* step) {
+        if (ec) throw beast::system_error(ec, step);
+    }
+};
+
+/**
+ * @brief HTTPS REST client for Binance (sync + async worker pool)
  */
 class RestClient {
 public:
-    RestClient() : ctx_(ssl::context::tlsv12_client) {
+    static constexpr const char* HOST = "api.binance.com";
+    static constexpr const char* PORT = "443";
+
+    /**
+     * @param workers Async worker threads = max concurrent requests (0 = sync only)
+     * @param weightPerMinute Request weight budget (Binance IP limit is 6000/min)
+     * @param sharedLimiter Limiter shared with other clients on the same IP
+     *        (e.g. quote shards); overrides weightPerMinute when set
+     */
+    explicit RestClient(int workers = 4, int weightPerMinute = 3000,
+                        std::shared_ptr<WeightLimiter> sharedLimiter = nullptr)
+        : ctx_(ssl::context::tlsv12_client)
+        , limiterOwner_(sharedLimiter ? std::move(sharedLimiter)
+                                      : std::make_shared<WeightLimiter>(weightPerMinute))
+        , limiter_(*limiterOwner_)
+        , numWorkers_(std::max(workers, 0))
+    {
         ctx_.set_default_verify_paths();
+        SSL_CTX_set_session_cache_mode(ctx_.native_handle(), SSL_SESS_CACHE_CLIENT);
     }
 
+    ~RestClient() { stop(); }
+
+    // Non-copyable
+    RestClient(const RestClient&) = delete;
+    RestClient& operator=(const RestClient&) = delete;
+
     /**
-     * @brief Fetch order book snapshot from Binance REST API
-     * 
+     * @brief Fetch order book snapshot from Binance REST API (blocking)
+     *
      * GET https://api.binance.com/api/v3/depth?symbol=BTCUSDT&limit=N
-     * 
+     *
      * @param symbol Symbol in uppercase (e.g., "BTCUSDT")
      * @param limit Number of levels (default BOOK_DEPTH)
      * @return SnapshotData with bids, asks, and lastUpdateId
      */
     SnapshotData fetchSnapshot(const std::string& symbol, int limit = BOOK_DEPTH) {
-        SnapshotData result;
-        
+        if (!syncConn_) {
+            syncConn_ = std::make_unique<RestConnection>(ctx_, HOST, PORT);
+        }
+        return fetchWith(*syncConn_, symbol, limit);
+    }
+
+    /**
+     * @brief Fetch tick/lot sizes for symbols (blocking)
+     *
+     * GET https://api.binance.com/api/v3/exchangeInfo?symbols=["BTCUSDT",...]
+     *
+     * @param symbols Symbols in uppercase
+     */
+    ExchangeInfoData fetchExchangeInfo(const std::vector<std::string>& symbols) {
+        ExchangeInfoData result;
+        if (!syncConn_) {
+            syncConn_ = std::make_unique<RestConnection>(ctx_, HOST, PORT);
+        }
+
+        if (!limiter_.acquire(EXCHANGE_INFO_WEIGHT, stopping_)) {
+            result.error = "Shutdown";
+            return result;
+        }
+
         try {
-            const std::string host = "api.binance.com";
-            const std::string port = "443";
-            const std::string target = "/api/v3/depth?symbol=" + symbol + 
-                                       "&limit=" + std::to_string(limit);
+            // symbols=["A","B"] URL-encoded
+            std::string target = "/api/v3/exchangeInfo?symbols=%5B";
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                if (i > 0) target += ",";
+                target += "%22" + symbols[i] + "%22";
+            }
+            target += "%5D";
 
-            std::cout << "[REST] Fetching snapshot: " << host << target << std::endl;
+            auto res = syncConn_->get(target);
+            if (res.result() != http::status::ok) {
+                result.error = "HTTP " + std::to_string(static_cast<int>(res.result()));
+                spdlog::error("[REST] exchangeInfo error: {}", result.error);
+                return result;
+            }
 
-            // IO context for this request
-            net::io_context ioc;
+            rapidjson::Document doc;
+            doc.Parse(res.body().c_str());
+            if (!doc.IsObject() || !doc.HasMember("symbols") || !doc["symbols"].IsArray()) {
+                result.error = "Invalid exchangeInfo response";
+                return result;
+            }
+
+            for (const auto& sym : doc["symbols"].GetArray()) {
+                if (!sym.IsObject() || !sym.HasMember("symbol") || !sym.HasMember("filters")) continue;
+                SymbolFilters f;
+                f.symbol = sym["symbol"].GetString();
+                for (const auto& flt : sym["filters"].GetArray()) {
+                    if (!flt.HasMember("filterType")) continue;
+                    std::string type = flt["filterType"].GetString();
+                    if (type == "PRICE_FILTER" && flt.HasMember("tickSize")) {
+                        f.tickSize = flt["tickSize"].GetString();
+                    } else if (type == "LOT_SIZE" && flt.HasMember("stepSize")) {
+                        f.stepSize = flt["stepSize"].GetString();
+                    }
+                }
+                result.symbols.push_back(std::move(f));
+            }
+            result.success = true;
 
-            // Resolver and SSL stream
-            tcp::resolver resolver(ioc);
-            beast::ssl_stream<beast::tcp_stream> stream(ioc, ctx_);
+        } catch (const std::exception& e) {
+            result.error = e.what();
+            spdlog::error("[REST] exchangeInfo exception: {}", result.error);
+        }
 
-            // Set SNI hostname
-            if (!SSL_set_tlsext_host_name(stream.native_handle(), host.c_str())) {
-                throw beast::system_error(
-                    beast::error_code(static_cast<int>(::ERR_get_error()),
-                                      net::error::get_ssl_category()),
-                    "Failed to set SNI hostname");
+        return result;
+    }
+
+    /**
+     * @brief Queue a snapshot request for the worker pool
+     *
+     * Thread-safe. Starts the workers on first use. The result is delivered
+     * through pollCompletions() on the caller's (book) thread.
+     *
+     * @param symIdx Caller's symbol index (echoed in the result)
+     * @param generation Caller's book generation (echoed, for stale detection)
+     * @param symbol Symbol in uppercase
+     * @param limit Number of levels
+     */
+    void fetchSnapshotAsync(int symIdx, long long generation,
+                            const std::string& symbol, int limit) {
+        if (numWorkers_ == 0) {
+            // No pool configured: complete inline
+            SnapshotResult r{symIdx, generation, fetchSnapshot(symbol, limit)};
+            std::lock_guard<std::mutex> lock(doneMutex_);
+            done_.push_back(std::move(r));
+            return;
+        }
+
+        startWorkers();
+        ++pending_;
+        {
+            std::lock_guard<std::mutex> lock(jobMutex_);
+            jobs_.push_back(Job{symIdx, generation, symbol, limit});
+        }
+        jobCv_.notify_one();
+    }
+
+    /**
+     * @brief Move completed async results into out (non-blocking)
+     * @return Number of results appended
+     */
+    size_t pollCompletions(std::vector<SnapshotResult>& out) {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        size_t n = done_.size();
+        for (auto& r : done_) out.push_back(std::move(r));
+        done_.clear();
+        return n;
+    }
+
+    /**
+     * @brief Call notify after each async completion (worker thread)
+     *
+     * Lets the owner wake its event loop to call pollCompletions() instead
+     * of polling; notify must be thread-safe and must not block.
+     */
+    void setCompletionNotifier(std::function<void()> notify) {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        notify_ = std::move(notify);
+    }
+
+    /// Requests queued or in flight
+    int pending() const { return pending_.load(); }
+
+    /**
+     * @brief Stop workers (queued requests are dropped)
+     */
+    void stop() {
+        stopping_ = true;
+        jobCv_.notify_all();
+        for (auto& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+        workers_.clear();
+    }
+
+private:
+    struct Job {
+        int symIdx;
+        long long generation;
+        std::string symbol;
+        int limit;
+    };
+
+    ssl::context ctx_;
+    std::shared_ptr<WeightLimiter> limiterOwner_;
+    WeightLimiter& limiter_;
+    int numWorkers_;
+    std::unique_ptr<RestConnection> syncConn_;
+
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> pending_{0};
+
+    std::mutex jobMutex_;
+    std::condition_variable jobCv_;
+    std::deque<Job> jobs_;
+
+    std::mutex doneMutex_;
+    std::vector<SnapshotResult> done_;
+    std::function<void()> notify_;
+
+    void startWorkers() {
+        if (!workers_.empty()) return;
+        spdlog::info("[REST] Starting {} snapshot workers", numWorkers_);
+        for (int i = 0; i < numWorkers_; ++i) {
+            workers_.emplace_back(&RestClient::workerLoop, this);
+        }
+    }
+
+    void workerLoop() {
+        RestConnection conn(ctx_, HOST, PORT);
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobMutex_);
+                jobCv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (stopping_) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
             }
 
-            // Resolve and connect
-            auto const results = resolver.resolve(host, port);
-            beast::get_lowest_layer(stream).connect(results);
+            SnapshotResult r{job.symIdx, job.generation, fetchWith(conn, job.symbol, job.limit)};
+            std::function<void()> notify;
+            {
+                std::lock_guard<std::mutex> lock(doneMutex_);
+                done_.push_back(std::move(r));
+                notify = notify_;
+            }
+            --pending_;
+            if (notify) notify();
+        }
+    }
 
-            // TLS handshake
-            stream.handshake(ssl::stream_base::client);
+    /**
+     * @brief Rate-limited snapshot fetch over a given connection
+     */
+    SnapshotData fetchWith(RestConnection& conn, const std::string& symbol, int limit) {
+        SnapshotData result;
 
-            // Build HTTP request
-            http::request<http::string_body> req{http::verb::get, target, 11};
-            req.set(http::field::host, host);
-            req.set(http::field::user_agent, "binance-feed-handler/1.0");
+        if (!limiter_.acquire(depthRequestWeight(limit), stopping_)) {
+            result.error = "Shutdown";
+            return result;
+        }
 
-            // Send request
-            http::write(stream, req);
+        try {
+            const std::string target = "/api/v3/depth?symbol=" + symbol +
+                                       "&limit=" + std::to_string(limit);
+
+            spdlog::debug("[REST] Fetching snapshot: {}{}", HOST, target);
+
+            auto res = conn.get(target);
 
-            // Receive response
-            beast::flat_buffer buffer;
-            http::response<http::string_body> res;
-            http::read(stream, buffer, res);
+            // Rate limited: pause everyone for Retry-After
+            if (res.result() == http::status::too_many_requests ||
+                static_cast<int>(res.result()) == 418) {
+                int retryAfter = 60;
+                auto it = res.find(http::field::retry_after);
+                if (it != res.end()) {
+                    retryAfter = std::max(1, std::atoi(std::string(it->value()).c_str()));
+                }
+                limiter_.pauseFor(std::chrono::seconds(retryAfter));
+                spdlog::warn("[REST] Rate limited (HTTP {}), pausing {}s",
+                    static_cast<int>(res.result()), retryAfter);
+            }
 
             // Check status
             if (res.result() != http::status::ok) {
                 result.error = "HTTP " + std::to_string(static_cast<int>(res.result()));
-                std::cerr << "[REST] Error: " << result.error << std::endl;
+                spdlog::error("[REST] Error: {}", result.error);
                 return result;
             }
 
             // Parse JSON response
             parseSnapshotResponse(res.body(), result);
 
-            // Graceful shutdown
-            beast::error_code ec;
-            stream.shutdown(ec);
-            // Ignore shutdown errors (common with SSL)
-
-            std::cout << "[REST] Snapshot received: lastUpdateId=" << result.lastUpdateId
-                      << " bids=" << result.bids.size()
-                      << " asks=" << result.asks.size() << std::endl;
+            spdlog::info("[REST] Snapshot received: {} lastUpdateId={} bids={} asks={}{}",
+                symbol, result.lastUpdateId, result.bids.size(), result.asks.size(),
+                conn.lastHandshakeResumed() ? " (resumed session)" : "");
 
         } catch (const std::exception& e) {
             result.error = e.what();
-            std::cerr << "[REST] Exception: " << result.error << std::endl;
+            spdlog::error("[REST] Exception: {}", result.error);
         }
 
         return result;
     }
 
-private:
-    ssl::context ctx_;
-
     /**
      * @brief Parse JSON snapshot response
-     * 
+     *
      * Response format:
      * {
      *   "lastUpdateId": 1027024,
      *   "bids": [["4.00000000", "431.00000000"], ...],
      *   "asks": [["4.00000200", "12.00000000"], ...]
      * }
-     * 
-     * Note: Prices and quantities are strings in Binance API
+     *
+     * Note: Prices and quantities are strings in Binance API; they are
+     * kept as strings and decoded by the book (see DecimalLevel)
      */
     void parseSnapshotResponse(const std::string& body, SnapshotData& result) {
         rapidjson::Document doc;
@@ -181,10 +674,9 @@ private:
             result.bids.reserve(bids.Size());
             for (rapidjson::SizeType i = 0; i < bids.Size(); ++i) {
                 if (bids[i].IsArray() && bids[i].Size() >= 2) {
-                    PriceLevel lvl;
-                    lvl.price = std::stod(bids[i][0].GetString());
-                    lvl.qty = std::stod(bids[i][1].GetString());
-                    result.bids.push_back(lvl);
+                    result.bids.push_back(DecimalLevel{
+                        std::string(bids[i][0].GetString(), bids[i][0].GetStringLength()),
+                        std::string(bids[i][1].GetString(), bids[i][1].GetStringLength())});
                 }
             }
         }
@@ -195,10 +687,9 @@ private:
             result.asks.reserve(asks.Size());
             for (rapidjson::SizeType i = 0; i < asks.Size(); ++i) {
                 if (asks[i].IsArray() && asks[i].Size() >= 2) {
-                    PriceLevel lvl;
-                    lvl.price = std::stod(asks[i][0].GetString());
-                    lvl.qty = std::stod(asks[i][1].GetString());
-                    result.asks.push_back(lvl);
+                    result.asks.push_back(DecimalLevel{
+                        std::string(asks[i][0].GetString(), asks[i][0].GetStringLength()),
+                        std::string(asks[i][1].GetString(), asks[i][1].GetStringLength())});
                 }
             }
         }
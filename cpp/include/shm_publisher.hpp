@@ -0,0 +1,122 @@
+/**
+ * @file shm_publisher.hpp
+ * @brief FH side of the shared-memory transport to the TP
+ *
+ * Serialises (`.u.upd; table; data) with b9 into kdb+ IPC bytes and
+ * copies them into the TP's ShmRing; the TP's shm extension deserialises
+ * and evaluates them as if they had arrived on the TCP handle.
+ *
+ * The TCP connection stays open alongside: it carries health and
+ * histogram rows, and any update the ring cannot take (ring missing, not
+ * yet created by the TP, or still full after spinUs) falls back to it.
+ * Ordering is only guaranteed within a transport, so a fallback under
+ * sustained overload may reorder updates by up to one ring's worth.
+ *
+ * Not thread-safe: owned by the handler's publishing thread.
+ *
+ * @see shm_ring.hpp
+ */
+
+#ifndef SHM_PUBLISHER_HPP
+#define SHM_PUBLISHER_HPP
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <string>
+
+#include "config.hpp"
+#include "kdb_symbols.hpp"
+#include "shm_ring.hpp"
+
+extern "C" {
+#include "k.h"
+}
+
+class ShmPublisher {
+public:
+    explicit ShmPublisher(const ShmConfig& cfg)
+        : cfg_(cfg)
+    {
+        tryAttach(std::chrono::steady_clock::now());
+    }
+
+    // Non-copyable (owns the mapping)
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    /**
+     * @brief Write .u.upd[table; data] to the ring (data is not consumed)
+     * @return false if the caller should send over TCP instead
+     */
+    bool publish(SymAtom& table, K data) {
+        auto now = std::chrono::steady_clock::now();
+        if (ring_.isOpen() && ring_.closed()) {
+            spdlog::warn("Shared-memory ring {} replaced by TP, reattaching", cfg_.path);
+            ring_.close();
+        }
+        if (!ring_.isOpen() && !tryAttach(now)) {
+            return false;
+        }
+
+        K msg = knk(3, upd_.get(), table.get(), r1(data));
+        K bytes = b9(3, msg);
+        r0(msg);
+        if (!bytes) {
+            ++fallbacks_;
+            return false;
+        }
+
+        bool written = ring_.tryWrite(kG(bytes), static_cast<size_t>(bytes->n));
+        if (!written) {
+            // TP behind: spin briefly for it to drain, then use TCP
+            const auto deadline = now + std::chrono::microseconds(cfg_.spinUs);
+            while (!written && std::chrono::steady_clock::now() < deadline) {
+                written = ring_.tryWrite(kG(bytes), static_cast<size_t>(bytes->n));
+            }
+        }
+        r0(bytes);
+        if (!written) {
+            long long n = ++fallbacks_;
+            if ((n & (n - 1)) == 0) {  // Log at powers of two to avoid spam
+                spdlog::warn("Shared-memory ring {} full: {} updates sent over TCP", cfg_.path, n);
+            }
+        }
+        return written;
+    }
+
+    bool attached() const { return ring_.isOpen(); }
+    
+    /// Bytes written but not yet drained by the TP (0 when not attached)
+    size_t pendingBytes() const { return ring_.isOpen() ? ring_.used() : 0; }
+
+    /// Updates sent over TCP because the ring could not take them
+    long long fallbacks() const { return fallbacks_; }
+
+private:
+    static constexpr int ATTACH_RETRY_SEC = 1;
+
+    bool tryAttach(std::chrono::steady_clock::time_point now) {
+        if (now < nextAttach_) return false;
+        nextAttach_ = now + std::chrono::seconds(ATTACH_RETRY_SEC);
+        if (!ring_.attach(cfg_.path)) {
+            if (!warned_) {
+                spdlog::warn("Shared-memory ring {} not available, using TCP until the TP creates it", cfg_.path);
+                warned_ = true;
+            }
+            return false;
+        }
+        spdlog::info("Attached to shared-memory ring {} ({} bytes)", cfg_.path, ring_.capacity());
+        warned_ = false;
+        return true;
+    }
+
+    ShmConfig cfg_;
+    ShmRing ring_;
+    SymAtom upd_{".u.upd"};
+    std::chrono::steady_clock::time_point nextAttach_{};
+    bool warned_{false};
+    long long fallbacks_{0};
+};
+
+#endif // SHM_PUBLISHER_HPP
@@ -0,0 +1,323 @@
+/**
+ * @file shm_ring.hpp
+ * @brief Shared-memory single-producer/single-consumer message ring
+ *
+ * Carries pre-serialised kdb+ IPC messages from a feed handler to the TP
+ * on the same host without a socket: the FH copies each message into an
+ * mmap'd file (normally under /dev/shm) and the TP's extension
+ * (shm_reader.cpp, loaded with 2:) deserialises it in place.
+ *
+ * Layout:
+ *   [0, 256)     Header: magic, capacity, closed flag; tail, head and
+ *                readerWaiting on separate cache lines
+ *   [256, ...)   Data: capacity bytes (power of two)
+ *
+ * Records are [uint32 length][4 bytes pad][payload], 8-byte aligned. A
+ * record never straddles the end of the data area: when it would, the
+ * producer writes a WRAP length and continues at offset 0. Head and tail
+ * are free-running byte counters (used = tail - head), as in SpscRing.
+ *
+ * Ownership:
+ *   - The reader (TP) creates the ring. An existing ring with the same
+ *     capacity is reused, so messages written while the TP was down are
+ *     read after it restarts. A different capacity replaces the file and
+ *     marks the old ring closed, so attached writers reattach.
+ *   - The writer (FH) attaches to an existing ring only.
+ *
+ * Wake-up: the reader sleeps in its event loop on a FIFO (<path>.wake).
+ * Before sleeping it sets readerWaiting and re-checks the ring; a writer
+ * that sees readerWaiting clears it and writes one byte to the FIFO. A
+ * busy reader therefore costs the writer no syscalls at all.
+ *
+ * Thread safety: exactly one writer and one reader, possibly in different
+ * processes (atomics are lock-free, hence address-free).
+ */
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class ShmRing {
+public:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t DATA_OFFSET = 256;
+    static constexpr size_t RECORD_HEADER = 8;
+    static constexpr uint32_t WRAP = 0xFFFFFFFFu;
+    static constexpr uint64_t MAGIC = 0x31474e5248534846ULL;  // "FHSHRNG1"
+
+    ShmRing() = default;
+    ~ShmRing() { close(); }
+
+    // Non-copyable (owns the mapping)
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * @brief Create or reuse the ring at path (reader side)
+     * @param capacity Data bytes (rounded up to a power of two)
+     * @return false with errno set on failure
+     */
+    bool create(const std::string& path, size_t capacity) {
+        close();
+        capacity = roundUpPow2(capacity);
+        const size_t size = DATA_OFFSET + capacity;
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+
+        if (static_cast<size_t>(st.st_size) >= DATA_OFFSET) {
+            if (!map(fd, static_cast<size_t>(st.st_size))) { ::close(fd); return false; }
+            if (header_->magic == MAGIC && header_->capacity == capacity
+                && static_cast<size_t>(st.st_size) == size) {
+                ::close(fd);
+                return openWake(path, true);
+            }
+            // Different ring: retire it for attached writers, start a new file
+            if (header_->magic == MAGIC) {
+                header_->closed.store(1, std::memory_order_release);
+            }
+            unmap();
+            ::close(fd);
+            ::unlink(path.c_str());
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0) return false;
+        }
+
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(fd, size)) {
+            ::close(fd);
+            return false;
+        }
+        ::close(fd);
+        header_->capacity = capacity;
+        header_->tail.store(0, std::memory_order_relaxed);
+        header_->head.store(0, std::memory_order_relaxed);
+        header_->readerWaiting.store(0, std::memory_order_relaxed);
+        header_->closed.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = MAGIC;
+        return openWake(path, true);
+    }
+
+    /**
+     * @brief Attach to a ring created by the reader (writer side)
+     * @return false if the ring does not exist or is not initialised
+     */
+    bool attach(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDWR);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = ::fstat(fd, &st) == 0
+               && static_cast<size_t>(st.st_size) > DATA_OFFSET
+               && map(fd, static_cast<size_t>(st.st_size));
+        ::close(fd);
+        if (!ok) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->magic != MAGIC || header_->closed.load(std::memory_order_acquire)
+            || DATA_OFFSET + header_->capacity != size_) {
+            unmap();
+            return false;
+        }
+        cachedHead_ = header_->head.load(std::memory_order_acquire);
+        return openWake(path, false);
+    }
+
+    void close() {
+        if (wakeFd_ >= 0) {
+            ::close(wakeFd_);
+            wakeFd_ = -1;
+        }
+        unmap();
+    }
+
+    bool isOpen() const { return header_ != nullptr; }
+
+    /// Reader replaced the ring (writer should reattach)
+    bool closed() const { return header_->closed.load(std::memory_order_relaxed) != 0; }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /// Bytes in use (approximate from either side)
+    size_t used() const {
+        return header_->tail.load(std::memory_order_acquire)
+             - header_->head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Append one message (writer only)
+     * @return false if there is not enough free space (nothing written)
+     */
+    bool tryWrite(const void* payload, size_t len) {
+        const uint64_t need = RECORD_HEADER + align8(len);
+        if (need > capacity() / 2) return false;
+
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        uint64_t pos = tail & mask_;
+        const uint64_t contiguous = capacity() - pos;
+        const uint64_t total = need <= contiguous ? need : contiguous + need;
+
+        if (tail + total - cachedHead_ > capacity()) {
+            cachedHead_ = header_->head.load(std::memory_order_acquire);
+            if (tail + total - cachedHead_ > capacity()) {
+                return false;
+            }
+        }
+
+        if (need > contiguous) {
+            std::memcpy(data_ + pos, &WRAP, sizeof(WRAP));
+            tail += contiguous;
+            pos = 0;
+        }
+        const uint32_t len32 = static_cast<uint32_t>(len);
+        std::memcpy(data_ + pos, &len32, sizeof(len32));
+        std::memcpy(data_ + pos + RECORD_HEADER, payload, len);
+        header_->tail.store(tail + need, std::memory_order_release);
+
+        // Pairs with the reader's fence in prepareWait()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->readerWaiting.load(std::memory_order_relaxed)
+            && header_->readerWaiting.exchange(0, std::memory_order_acq_rel)) {
+            wake();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Pass up to maxMessages messages to onMessage(const uint8_t*, size_t) (reader only)
+     * @return Messages read
+     */
+    template<typename F>
+    size_t drain(F&& onMessage, size_t maxMessages) {
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (head != tail && n < maxMessages) {
+            const uint64_t pos = head & mask_;
+            uint32_t len;
+            std::memcpy(&len, data_ + pos, sizeof(len));
+            if (len == WRAP) {
+                head += capacity() - pos;
+                continue;
+            }
+            onMessage(data_ + pos + RECORD_HEADER, static_cast<size_t>(len));
+            head += RECORD_HEADER + align8(len);
+            ++n;
+        }
+        header_->head.store(head, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief Ask to be woken through the FIFO (reader only, before sleeping)
+     * @return false if messages arrived meanwhile (drain again instead)
+     */
+    bool prepareWait() {
+        header_->readerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->head.load(std::memory_order_relaxed)
+            != header_->tail.load(std::memory_order_acquire)) {
+            header_->readerWaiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /// FIFO readable when a writer wakes the reader (reader side)
+    int wakeFd() const { return wakeFd_; }
+
+    /// Consume pending wake-up bytes (reader only)
+    void clearWake() {
+        char buf[64];
+        while (::read(wakeFd_, buf, sizeof(buf)) > 0) {}
+    }
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint64_t capacity;
+        std::atomic<uint32_t> closed;
+        alignas(CACHE_LINE) std::atomic<uint64_t> tail;
+        alignas(CACHE_LINE) std::atomic<uint64_t> head;
+        alignas(CACHE_LINE) std::atomic<uint32_t> readerWaiting;
+    };
+    static_assert(sizeof(Header) <= DATA_OFFSET, "ring header exceeds data offset");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 4096;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static uint64_t align8(size_t n) { return (static_cast<uint64_t>(n) + 7) & ~uint64_t{7}; }
+
+    bool map(int fd, size_t size) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<uint8_t*>(p);
+        size_ = size;
+        header_ = reinterpret_cast<Header*>(base_);
+        data_ = base_ + DATA_OFFSET;
+        mask_ = size > DATA_OFFSET ? size - DATA_OFFSET - 1 : 0;
+        return true;
+    }
+
+    void unmap() {
+        if (base_) {
+            ::munmap(base_, size_);
+        }
+        base_ = nullptr;
+        header_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+        mask_ = 0;
+    }
+
+    /// Reader: create and open the FIFO; writer: open lazily in wake()
+    bool openWake(const std::string& path, bool reader) {
+        wakePath_ = path + ".wake";
+        if (!reader) return true;
+        if (::mkfifo(wakePath_.c_str(), 0600) != 0 && errno != EEXIST) return false;
+        // O_RDWR keeps the FIFO open for writing, so it never reports EOF
+        wakeFd_ = ::open(wakePath_.c_str(), O_RDWR | O_NONBLOCK);
+        return wakeFd_ >= 0;
+    }
+
+    void wake() {
+        if (wakeFd_ < 0) {
+            wakeFd_ = ::open(wakePath_.c_str(), O_WRONLY | O_NONBLOCK);
+            if (wakeFd_ < 0) return;  // Reader not running: it drains on start
+        }
+        const char b = 1;
+        if (::write(wakeFd_, &b, 1) < 0 && errno != EAGAIN) {
+            ::close(wakeFd_);
+            wakeFd_ = -1;
+        }
+    }
+
+    uint8_t* base_{nullptr};
+    Header* header_{nullptr};
+    uint8_t* data_{nullptr};
+    size_t size_{0};
+    uint64_t mask_{0};
+
+    uint64_t cachedHead_{0};    // Writer's copy of the reader's position
+
+    std::string wakePath_;
+    int wakeFd_{-1};
+};
+
+#endif // SHM_RING_HPP
@@ -0,0 +1,115 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer
+ *
+ * Used to hand preparsed records from a network reader thread to a
+ * publisher thread without locks or per-message allocation.
+ *
+ * Design:
+ *   - Capacity rounded up to a power of two (index = seq & mask)
+ *   - Free-running head/tail counters (size = tail - head)
+ *   - Producer and consumer indices on separate cache lines
+ *   - Each side caches the other side's index to avoid cross-core
+ *     traffic on every operation
+ *   - Storage allocated once at construction
+ *
+ * Thread safety:
+ *   - Exactly one thread may call tryPush()
+ *   - Exactly one thread may call tryPop()
+ *   - size() may be called from any thread (approximate)
+ */
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @brief Construct ring with at least the given capacity
+     * @param capacity Minimum number of slots (rounded up to power of two)
+     */
+    explicit SpscRing(size_t capacity)
+        : slots_(roundUpPow2(capacity))
+        , mask_(slots_.size() - 1)
+    {
+    }
+
+    // Non-copyable
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Append an item (producer thread only)
+     * @return false if the ring is full (item not stored)
+     */
+    bool tryPush(const T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item (consumer thread only)
+     * @return false if the ring is empty
+     */
+    bool tryPop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Approximate number of queued items (any thread)
+     */
+    size_t size() const {
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /// Number of slots
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    // Consumer side: read position + cached copy of producer's position
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};
+    size_t cachedTail_{0};
+
+    // Producer side: write position + cached copy of consumer's position
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};
+    size_t cachedHead_{0};
+};
+
+#endif // SPSC_RING_HPP
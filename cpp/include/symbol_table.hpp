@@ -0,0 +1,108 @@
+/**
+ * @file symbol_table.hpp
+ * @brief Startup-built symbol -> index table keyed on raw bytes
+ *
+ * The handlers' symbol sets are fixed at startup, so they are placed once
+ * into a flat open-addressed slot array (linear probing, at most half
+ * full). A lookup is one hash of the JSON string bytes and a short probe
+ * from the home slot, each step one slot load and one length+memcmp
+ * check; there is no std::string construction and no allocation. The
+ * probe is bounded by the longest displacement seen at build time, so an
+ * unknown symbol stops after as many steps as the worst known one, or at
+ * the first empty slot.
+ *
+ *   find("ETHUSDT", 7):  slot = hash(bytes) & mask
+ *                        slots_[slot] = 4  ->  names_[4] == "ETHUSDT"? no
+ *                        slots_[slot+1] = 1  ->  names_[1] == "ETHUSDT" ? 1 : ...
+ *
+ * Slots are at least 2x the symbol count (power of two), which keeps the
+ * expected probe under two steps for any set size.
+ *
+ * Immutable after construction: lookups are safe from any thread.
+ *
+ * @see kdb_symbols.hpp for the interned kdb+ symbols of the same set
+ */
+
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class SymbolTable {
+public:
+    SymbolTable() = default;
+
+    /**
+     * @param names Symbols, indexed as given (a repeated name maps to its
+     *        first index)
+     */
+    explicit SymbolTable(std::vector<std::string> names)
+        : names_(std::move(names))
+    {
+        build();
+    }
+
+    /// Index of the symbol with these bytes (-1 if unknown)
+    int find(const char* s, size_t len) const {
+        if (slots_.empty()) return -1;
+        size_t slot = hash(s, len) & mask_;
+        for (size_t probe = 0; probe <= maxProbe_; ++probe, slot = (slot + 1) & mask_) {
+            const int idx = slots_[slot];
+            if (idx < 0) return -1;
+            const std::string& n = names_[idx];
+            if (n.size() == len && std::memcmp(n.data(), s, len) == 0) return idx;
+        }
+        return -1;
+    }
+
+    int find(const std::string& s) const { return find(s.data(), s.size()); }
+
+    const std::string& name(int idx) const { return names_[idx]; }
+    const std::vector<std::string>& names() const { return names_; }
+    int size() const { return static_cast<int>(names_.size()); }
+
+private:
+    /// FNV-1a over the bytes, with a final mix for the low bits
+    static uint64_t hash(const char* s, size_t len) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < len; ++i) {
+            h = (h ^ static_cast<unsigned char>(s[i])) * 0x100000001b3ULL;
+        }
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        return h ^ (h >> 32);
+    }
+
+    /// Place every symbol at the first free slot from its home slot
+    void build() {
+        size_t size = 8;
+        while (size < 2 * names_.size()) size <<= 1;
+        slots_.assign(size, -1);
+        mask_ = size - 1;
+        maxProbe_ = 0;
+
+        for (size_t i = 0; i < names_.size(); ++i) {
+            const std::string& n = names_[i];
+            if (find(n) >= 0) continue;  // Repeated name keeps its first index
+            size_t slot = hash(n.data(), n.size()) & mask_;
+            size_t probe = 0;
+            while (slots_[slot] >= 0) {
+                slot = (slot + 1) & mask_;
+                ++probe;
+            }
+            slots_[slot] = static_cast<int>(i);
+            if (probe > maxProbe_) maxProbe_ = probe;
+        }
+    }
+
+    std::vector<std::string> names_;
+    std::vector<int> slots_;
+    size_t mask_{0};
+    size_t maxProbe_{0};     // Longest displacement from a home slot
+};
+
+#endif // SYMBOL_TABLE_HPP
@@ -0,0 +1,410 @@
+/**
+ * @file tp_outbound.hpp
+ * @brief TP connection with a bounded outbound backlog and background reconnect
+ *
+ * Owns the kdb+ handle to the tickerplant. While the TP is reachable and
+ * nothing is queued, send() is the plain async `.u.upd` call. When a send
+ * fails the handle is closed, a reconnector thread starts retrying khpu()
+ * with backoff, and every update from then on is serialised (b9) into the
+ * backlog instead of blocking the caller:
+ *
+ *   send() ──► [memory queue, queueMb] ──► [spill file, spillMaxMb] ──► dropped
+ *
+ * The failed update is the first entry, so nothing in flight is lost.
+ * Once the memory queue is full, updates go to the spill file (optional),
+ * and stay there until the spill has been replayed, so the backlog keeps
+ * arrival order. With both full (or no spill) newer updates are dropped;
+ * fhSeqNo is assigned before the backlog, so a drop shows as a gap and
+ * replayed updates keep their original numbers.
+ *
+ * poll() (called by send() and the caller's housekeeping tick) adopts a
+ * handle the reconnector opened and replays up to REPLAY_SLICE queued
+ * updates per call, oldest first, so a long backlog drains without
+ * stalling the loop. New updates queue behind it until it is empty.
+ *
+ * Thread safety: owned by the publishing thread. The reconnector thread
+ * only calls khpu() and hands the handle over through an atomic; all K
+ * objects (and their non-atomic reference counts) stay on the owner.
+ */
+
+#ifndef TP_OUTBOUND_HPP
+#define TP_OUTBOUND_HPP
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.hpp"
+#include "kdb_symbols.hpp"
+
+extern "C" {
+#include "k.h"
+}
+
+class TpOutbound {
+public:
+    /// Queued updates replayed per poll() once reconnected
+    static constexpr int REPLAY_SLICE = 256;
+
+    /// Reconnect backoff (milliseconds)
+    static constexpr int INITIAL_BACKOFF_MS = 1000;
+    static constexpr int MAX_BACKOFF_MS = 8000;
+
+    /// Stop-check period of the backoff waits (milliseconds)
+    static constexpr int STOP_CHECK_MS = 100;
+
+    /**
+     * @param host Tickerplant hostname
+     * @param port Tickerplant port
+     * @param cfg Backlog bounds and spill file
+     * @param running Owner's run flag (ends connect and reconnect waits)
+     */
+    TpOutbound(std::string host, int port, const OutboundConfig& cfg,
+               const std::atomic<bool>& running)
+        : host_(std::move(host))
+        , port_(port)
+        , cfg_(cfg)
+        , running_(running)
+    {
+    }
+
+    ~TpOutbound() {
+        stopReconnector();
+        for (K bytes : memQueue_) r0(bytes);
+        if (handle_ > 0) kclose(handle_);
+        if (spillFd_ >= 0) ::close(spillFd_);
+    }
+
+    // Non-copyable (owns the handle, spill file and reconnector thread)
+    TpOutbound(const TpOutbound&) = delete;
+    TpOutbound& operator=(const TpOutbound&) = delete;
+
+    /**
+     * @brief Connect with retry (blocking; startup only)
+     * @return false if stopped before the TP accepted the connection
+     */
+    bool connect() {
+        int attempt = 0;
+        while (running_) {
+            spdlog::info("Connecting to TP on {}:{}...", host_, port_);
+            const int h = khpu((S)host_.c_str(), port_, (S)"");
+            if (h > 0) {
+                handle_ = h;
+                open_ = true;
+                spdlog::info("Connected to TP (handle {})", h);
+                return true;
+            }
+            spdlog::error("Failed to connect to TP");
+            if (!waitBackoff(attempt++)) break;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Send .u.upd[table; data], or queue it while the TP is away
+     *
+     * Takes ownership of data; never blocks on a reconnect.
+     * @return true if sent now, false if queued or dropped
+     */
+    bool send(SymAtom& table, K data) {
+        poll();
+        if (handle_ > 0 && backlog() == 0) {
+            // k() consumes its arguments; keep a reference to queue on failure
+            r1(data);
+            if (k(-handle_, (S)".u.upd", table.get(), data, (K)0) != nullptr) {
+                r0(data);
+                return true;
+            }
+            lost();
+        }
+        enqueue(table, data);
+        return false;
+    }
+
+    /**
+     * @brief Adopt a reconnected handle and replay a slice of the backlog
+     */
+    void poll() {
+        if (handle_ <= 0) {
+            if (pending_.load(std::memory_order_relaxed) <= 0) return;
+            const int h = pending_.exchange(-1, std::memory_order_acquire);
+            if (h <= 0) return;
+            stopReconnector();
+            handle_ = h;
+            spdlog::info("Reconnected to TP (handle {}), replaying {} queued updates", h, backlog());
+        }
+        for (int i = 0; i < REPLAY_SLICE && backlog() > 0; ++i) {
+            if (!replayOne()) return;
+        }
+    }
+
+    /**
+     * @brief Replay what can still be sent, then close (shutdown)
+     */
+    void close() {
+        poll();
+        while (handle_ > 0 && backlog() > 0 && replayOne()) {}
+        if (backlog() > 0) {
+            spdlog::warn("TP closed with {} updates undelivered", backlog());
+        }
+        stopReconnector();
+        if (handle_ > 0) {
+            kclose(handle_);
+            handle_ = -1;
+            spdlog::info("TP connection closed");
+        }
+        open_ = false;
+    }
+
+    /// Initial connection made (sends are delivered or queued)
+    bool isOpen() const { return open_; }
+
+    /// Live handle and nothing waiting to be replayed
+    bool connected() const { return handle_ > 0 && backlog() == 0; }
+
+    /// TP socket (-1 while reconnecting)
+    int handle() const { return handle_; }
+
+    /// Updates waiting for the TP (memory and spill file)
+    long long backlog() const { return static_cast<long long>(memQueue_.size()) + spillCount_; }
+
+    /// Updates written to the spill file (total)
+    long long spilled() const { return spilled_; }
+
+    /// Updates dropped because the backlog was full (total)
+    long long dropped() const { return dropped_; }
+
+private:
+    // ========================================================================
+    // RECONNECT
+    // ========================================================================
+
+    void lost() {
+        spdlog::error("TP connection lost, queueing updates while reconnecting");
+        kclose(handle_);
+        handle_ = -1;
+        if (!reconnector_.joinable()) {
+            quit_ = false;
+            reconnector_ = std::thread(&TpOutbound::reconnectLoop, this);
+        }
+    }
+
+    /// Reconnector thread: khpu() only, the owner adopts the handle in poll()
+    void reconnectLoop() {
+        int attempt = 0;
+        while (running_ && !quit_) {
+            if (!waitBackoff(attempt++)) return;
+            const int h = khpu((S)host_.c_str(), port_, (S)"");
+            if (h > 0) {
+                pending_.store(h, std::memory_order_release);
+                return;
+            }
+            spdlog::error("Failed to reconnect to TP");
+        }
+    }
+
+    void stopReconnector() {
+        quit_ = true;
+        if (reconnector_.joinable()) reconnector_.join();
+        const int h = pending_.exchange(-1);
+        if (h > 0) kclose(h);  // Opened after the owner gave up
+    }
+
+    bool waitBackoff(int attempt) {
+        int delay = INITIAL_BACKOFF_MS;
+        for (int i = 0; i < attempt && delay < MAX_BACKOFF_MS; ++i) {
+            delay *= 2;
+        }
+        delay = std::min(delay, MAX_BACKOFF_MS);
+        spdlog::info("Waiting {}ms before TP reconnect...", delay);
+        for (int slept = 0; slept < delay && running_ && !quit_; slept += STOP_CHECK_MS) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(STOP_CHECK_MS));
+        }
+        return running_ && !quit_;
+    }
+
+    // ========================================================================
+    // BACKLOG
+    // ========================================================================
+
+    /// Serialise `(.u.upd; table; data) into the backlog (consumes data)
+    void enqueue(SymAtom& table, K data) {
+        K msg = knk(3, upd_.get(), table.get(), data);
+        K bytes = b9(3, msg);
+        r0(msg);
+        if (!bytes || bytes->t == -128) {
+            if (bytes) r0(bytes);
+            drop();
+            return;
+        }
+        const size_t n = static_cast<size_t>(bytes->n);
+
+        // Memory first; once spilling, stay on the spill file until it drains
+        if (spillCount_ == 0 && memBytes_ + n <= (static_cast<size_t>(cfg_.queueMb) << 20)) {
+            memQueue_.push_back(bytes);
+            memBytes_ += n;
+            return;
+        }
+        if (spillWrite(kG(bytes), n)) {
+            ++spilled_;
+            ++spillCount_;
+        } else {
+            drop();
+        }
+        r0(bytes);
+    }
+
+    /// Send the oldest queued update; false (and reconnect) on failure
+    bool replayOne() {
+        K bytes;
+        uint32_t spillLen = 0;
+        if (!memQueue_.empty()) {
+            bytes = memQueue_.front();
+            r1(bytes);
+        } else {
+            bytes = spillRead(spillLen);
+            if (!bytes) {
+                // Unreadable spill: nothing behind it can be trusted
+                spdlog::error("TP spill file {} unreadable, dropping {} updates", cfg_.spillPath, spillCount_);
+                dropped_ += spillCount_;
+                spillReset();
+                return true;
+            }
+        }
+
+        K msg = d9(bytes);
+        r0(bytes);
+        bool sent = true;
+        if (msg && msg->t == 0 && msg->n == 3) {
+            sent = k(-handle_, (S)".u.upd", r1(kK(msg)[1]), r1(kK(msg)[2]), (K)0) != nullptr;
+        } else {
+            ++dropped_;  // Not an update we wrote: skip it
+        }
+        if (msg) r0(msg);
+        if (!sent) {
+            lost();
+            return false;
+        }
+
+        if (!memQueue_.empty()) {
+            memBytes_ -= static_cast<size_t>(memQueue_.front()->n);
+            r0(memQueue_.front());
+            memQueue_.pop_front();
+        } else {
+            spillReadOff_ += sizeof(uint32_t) + spillLen;
+            if (--spillCount_ == 0) spillReset();
+        }
+        return true;
+    }
+
+    void drop() {
+        const long long n = ++dropped_;
+        if ((n & (n - 1)) == 0) {  // Log at powers of two to avoid spam
+            spdlog::warn("TP backlog full, dropped {} updates so far", n);
+        }
+    }
+
+    // ========================================================================
+    // SPILL FILE ([uint32 length][b9 bytes] records, appended and read in order)
+    // ========================================================================
+
+    bool spillWrite(const void* data, size_t len) {
+        if (!cfg_.spillEnabled || spillFailed_) return false;
+        if (spillWriteOff_ + sizeof(uint32_t) + len > (static_cast<size_t>(cfg_.spillMaxMb) << 20)) {
+            return false;
+        }
+        if (spillFd_ < 0 && !spillOpen()) return false;
+        const uint32_t n = static_cast<uint32_t>(len);
+        if (::pwrite(spillFd_, &n, sizeof(n), static_cast<off_t>(spillWriteOff_)) != sizeof(n) ||
+            ::pwrite(spillFd_, data, len, static_cast<off_t>(spillWriteOff_ + sizeof(n))) != static_cast<ssize_t>(len)) {
+            spdlog::error("TP spill write to {} failed: {}", cfg_.spillPath, std::strerror(errno));
+            spillFailed_ = true;
+            return false;
+        }
+        if (spillWriteOff_ == 0) {
+            spdlog::warn("TP backlog over {} MB, spilling to {}", cfg_.queueMb, cfg_.spillPath);
+        }
+        spillWriteOff_ += sizeof(n) + len;
+        return true;
+    }
+
+    /// Next record as a byte vector (nullptr on a short read)
+    K spillRead(uint32_t& len) {
+        if (::pread(spillFd_, &len, sizeof(len), static_cast<off_t>(spillReadOff_)) != sizeof(len)) {
+            return nullptr;
+        }
+        K bytes = ktn(KG, len);
+        if (::pread(spillFd_, kG(bytes), len, static_cast<off_t>(spillReadOff_ + sizeof(len))) != static_cast<ssize_t>(len)) {
+            r0(bytes);
+            return nullptr;
+        }
+        return bytes;
+    }
+
+    /// Create (truncate) the spill file and its parent directory
+    bool spillOpen() {
+        const size_t slash = cfg_.spillPath.rfind('/');
+        if (slash != std::string::npos && slash > 0) {
+            ::mkdir(cfg_.spillPath.substr(0, slash).c_str(), 0755);  // EEXIST is fine
+        }
+        spillFd_ = ::open(cfg_.spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (spillFd_ < 0) {
+            spdlog::error("Cannot open TP spill file {}: {}", cfg_.spillPath, std::strerror(errno));
+            spillFailed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    /// Spill fully replayed: start the file over
+    void spillReset() {
+        spillCount_ = 0;
+        spillReadOff_ = spillWriteOff_ = 0;
+        if (spillFd_ >= 0 && ::ftruncate(spillFd_, 0) != 0) {}
+    }
+
+    // ========================================================================
+    // MEMBERS
+    // ========================================================================
+
+    std::string host_;
+    int port_;
+    OutboundConfig cfg_;
+    const std::atomic<bool>& running_;
+
+    int handle_{-1};
+    bool open_{false};
+    SymAtom upd_{".u.upd"};
+
+    /// Reconnector thread and the handle it opened (-1 = none yet)
+    std::thread reconnector_;
+    std::atomic<int> pending_{-1};
+    std::atomic<bool> quit_{false};
+
+    /// In-memory backlog: serialised updates, oldest first
+    std::deque<K> memQueue_;
+    size_t memBytes_{0};
+
+    /// Spill file (opened on first use) and its unreplayed records
+    int spillFd_{-1};
+    bool spillFailed_{false};
+    size_t spillReadOff_{0};
+    size_t spillWriteOff_{0};
+    long long spillCount_{0};
+
+    long long spilled_{0};
+    long long dropped_{0};
+};
+
+#endif // TP_OUTBOUND_HPP
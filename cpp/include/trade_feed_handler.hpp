@@ -25,19 +25,54 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "analytics_engine.hpp"
+#include "binance_stream.hpp"
+#include "capture_file.hpp"
+#include "config.hpp"
+#include "json_parser.hpp"
+#include "kdb_batch.hpp"
+#include "kdb_symbols.hpp"
+#include "latency_histogram.hpp"
+#include "shm_publisher.hpp"
+#include "spsc_ring.hpp"
+#include "symbol_table.hpp"
+#include "tp_outbound.hpp"
 
 // kdb+ C API
 extern "C" {
 #include "k.h"
 }
 
-namespace beast = boost::beast;
-namespace websocket = beast::websocket;
-namespace net = boost::asio;
-namespace ssl = net::ssl;
-using tcp = net::ip::tcp;
+/**
+ * @brief Preparsed trade handed from reader to publisher
+ *
+ * Plain value type so it can be copied into the SPSC ring without
+ * allocation. The symbol is copied out of the JSON document because the
+ * document does not outlive processMessage().
+ */
+struct TradeRecord {
+    static constexpr size_t SYM_LEN = 16;
+    
+    char sym[SYM_LEN] = {0};
+    int symIdx = -1;            // Index into the handler's symbols (-1 = unknown)
+    long long tradeId = 0;
+    double price = 0.0;
+    double qty = 0.0;
+    bool buyerIsMaker = false;
+    long long exchEventTimeMs = 0;
+    long long exchTradeTimeMs = 0;
+    long long fhRecvTimeUtcNs = 0;
+    long long fhParseNs = 0;
+    long long fhSeqNo = 0;
+    
+    /// Monotonic parse-end time (ns) - start of the fhSendUs interval
+    long long parseEndSteadyNs = 0;
+};
 
 /**
  * @class TradeFeedHandler
@@ -47,16 +82,54 @@ using tcp = net::ip::tcp;
  *   - WebSocket connection management (TLS) with auto-reconnect
  *   - JSON parsing and normalization
  *   - Timestamp capture (wall-clock and monotonic)
- *   - Latency instrumentation (parse time, send time)
+ *   - Latency instrumentation (parse time in ns, send time in µs)
  *   - Sequence numbering for gap detection
- *   - IPC publication to tickerplant with reconnect
+ *   - IPC publication to tickerplant, queued while it reconnects
  *   - Graceful shutdown on signal
  * 
  * Design decisions:
- *   - Tick-by-tick publishing (no batching) for latency measurement clarity
+ *   - Tick-by-tick publishing by default for latency measurement clarity;
+ *     optional columnar batching (see BatchConfig) for throughput
  *   - Async IPC (neg handle) to minimize blocking
  *   - Combined stream subscription for multi-symbol support
- *   - Reconnect with exponential backoff on disconnect
+ *   - Reconnect with exponential backoff on disconnect (Binance on the
+ *     reader thread; TP in the background, see tp_outbound.hpp)
+ *   - One io_context on the reader thread (BinanceStream, see
+ *     binance_stream.hpp): async connect and read plus drift-free timers
+ *     for batch delay, health and the stop check, so partial batches and
+ *     health rows go out on time when the stream is quiet or down
+ * 
+ * Pipeline mode (optional, see PipelineConfig):
+ *   WebSocket -> [reader thread] -> SpscRing<TradeRecord> -> [publisher thread] -> TP
+ *   - Reader never waits on IPC
+ *   - Ring full => record dropped, counted in queueOverflows (fhSeqNo gap)
+ *   - Publisher thread owns the TP handle and publishes health
+ * 
+ * Stage latency histograms (see latency_histogram.hpp): parse, publish
+ * and send per symbol, exported every HEALTH_INTERVAL_SEC as
+ * telemetry_fh_hist rows alongside the health row.
+ * 
+ * In-process analytics (optional, see AnalyticsConfig): rolling VWAP per
+ * window is updated as each trade is published (publishing thread) and
+ * sent to analytics_binance, batched like trade_binance.
+ * 
+ * Shared-memory transport (optional, see ShmConfig): trade and analytics
+ * updates go through the TP's shared-memory ring, TCP otherwise.
+ * 
+ * TP outages (see OutboundConfig): updates sent while the TP is away are
+ * queued in memory, then a spill file, and replayed in order once the
+ * background reconnect succeeds; backlog, spills and drops are reported
+ * in the health row.
+ * 
+ * Capture and replay (optional, see CaptureConfig / ReplayOptions): raw
+ * frames are appended to a capture file as received; --replay feeds one
+ * back through processMessage() with the recorded receive times.
+ * 
+ * Unified mode (feed_handler, see attach()): the handler runs on a
+ * worker's shared connection next to the quote handler, publishing
+ * through the worker's TP connection. The handler's own Binance and TP
+ * connections are only created by run(), so an attached handler holds no
+ * transport state.
  */
 class TradeFeedHandler {
 public:
@@ -64,23 +137,11 @@ public:
     // CONFIGURATION CONSTANTS
     // ========================================================================
     
-    /// Binance WebSocket host
-    static constexpr const char* BINANCE_HOST = "stream.binance.com";
-    
-    /// Binance WebSocket port (TLS)
-    static constexpr const char* BINANCE_PORT = "9443";
-    
     /// Nanoseconds between Unix epoch (1970) and kdb+ epoch (2000)
     static constexpr long long KDB_EPOCH_OFFSET_NS = 946684800000000000LL;
     
-    /// Initial reconnection backoff (milliseconds)
-    static constexpr int INITIAL_BACKOFF_MS = 1000;
-    
-    /// Maximum reconnection backoff (milliseconds)
-    static constexpr int MAX_BACKOFF_MS = 8000;
-    
-    /// Backoff multiplier for exponential backoff
-    static constexpr int BACKOFF_MULTIPLIER = 2;
+    /// Shortest housekeeping tick (microseconds; bounds tiny batch delays)
+    static constexpr int MIN_TICK_US = 100;
 
     // ========================================================================
     // CONSTRUCTION
@@ -91,10 +152,22 @@ public:
      * @param symbols List of symbols to subscribe to (lowercase, e.g., "btcusdt")
      * @param tpHost Tickerplant hostname
      * @param tpPort Tickerplant port
+     * @param pipeline Reader/publisher pipeline settings
+     * @param batching Columnar batch publishing settings
+     * @param analytics In-process analytics settings
+     * @param shm Shared-memory TP transport settings
+     * @param capture Raw input capture settings
+     * @param outbound TP backlog bounds while reconnecting
      */
     TradeFeedHandler(const std::vector<std::string>& symbols,
                      const std::string& tpHost = "localhost",
-                     int tpPort = 5010);
+                     int tpPort = 5010,
+                     const PipelineConfig& pipeline = PipelineConfig(),
+                     const BatchConfig& batching = BatchConfig(),
+                     const AnalyticsConfig& analytics = AnalyticsConfig(),
+                     const ShmConfig& shm = ShmConfig(),
+                     const CaptureConfig& capture = CaptureConfig(),
+                     const OutboundConfig& outbound = OutboundConfig());
     
     /// Destructor - ensures cleanup
     ~TradeFeedHandler();
@@ -123,6 +196,14 @@ public:
      */
     void stop();
     
+    /**
+     * @brief Replay a capture file instead of connecting to Binance
+     * 
+     * Call before run(). run() then processes the file once and returns;
+     * without useTp nothing is sent (updates are built and dropped).
+     */
+    void setReplay(const ReplayOptions& replay) { replay_ = replay; }
+    
     /**
      * @brief Check if handler is running
      * @return true if running, false if stopped or stopping
@@ -134,6 +215,34 @@ public:
      * @return Number of trades published to TP
      */
     long long messageCount() const { return fhSeqNo_; }
+    
+    // ========================================================================
+    // UNIFIED MODE (feed_handler)
+    // ========================================================================
+    
+    /**
+     * @brief Run on a shared connection instead of run()
+     * 
+     * Registers this handler's @trade streams, frame route and batch timer
+     * on stream, and sends through tp (opened by the caller, used on the
+     * stream's thread only) instead of its own TP connection. No pipeline
+     * thread and no health row: the caller publishes one per connection
+     * from the accessors below. Call detach() once stream.run() returns.
+     */
+    void attach(BinanceStream& stream, TpOutbound& tp);
+    
+    /// Flush pending batches and close the capture (after the stream stopped)
+    void detach();
+    
+    // Health accessors (thread-safe)
+    long long msgsReceived() const { return msgsReceived_.load(std::memory_order_relaxed); }
+    long long msgsPublished() const { return msgsPublished_.load(std::memory_order_relaxed); }
+    std::chrono::system_clock::time_point lastMsgTime() const { return lastMsgTime_.load(std::memory_order_relaxed); }
+    std::chrono::system_clock::time_point lastPubTime() const { return lastPubTime_.load(std::memory_order_relaxed); }
+    int symbolCount() const { return static_cast<int>(symbols_.size()); }
+    
+    /// Stage latency histograms (exported by whoever publishes health)
+    LatencyStats& latencyStats() { return *latency_; }
 
 private:
     // ========================================================================
@@ -141,8 +250,9 @@ private:
     // ========================================================================
     
     std::vector<std::string> symbols_;
-    std::string tpHost_;
-    int tpPort_;
+    PipelineConfig pipeline_;
+    BatchConfig batching_;
+    CaptureConfig captureCfg_;
     
     // ========================================================================
     // STATE
@@ -154,14 +264,69 @@ private:
     /// FH sequence number (monotonically increasing per instance)
     long long fhSeqNo_{0};
     
-    /// Last tradeId per symbol (for gap detection)
-    std::unordered_map<std::string, long long> lastTradeId_;
+    /// Uppercase symbols, looked up by the JSON string bytes
+    SymbolTable symbolTable_;
+    
+    /// Last tradeId per symbol index (for gap detection, -1 = none yet)
+    std::vector<long long> lastTradeIds_;
+    
+    /// kdb+ symbols and table atoms (publishing thread only)
+    InternedSymbols interned_;
+    SymAtom tradeTable_{"trade_binance"};
+    SymAtom healthTable_{"health_feed_handler"};
+    SymAtom histTable_{"telemetry_fh_hist"};
     
-    /// Tickerplant connection handle
-    int tpHandle_{-1};
+    /// Stage latency histograms (per symbol and handler-level)
+    std::unique_ptr<LatencyStats> latency_;
     
-    /// Binance reconnection attempt counter
-    int binanceReconnectAttempt_{0};
+    /// Tickerplant connection and outage backlog (publishing thread only):
+    /// this handler's own, created by run(), or the worker's in unified mode
+    std::string tpHost_;
+    int tpPort_;
+    OutboundConfig outboundCfg_;
+    std::unique_ptr<TpOutbound> ownTp_;
+    TpOutbound* tp_{nullptr};
+    
+    /// Reused in-situ JSON parser (reader thread only)
+    JsonParser parser_;
+    
+    // ========================================================================
+    // PIPELINE (reader -> publisher)
+    // ========================================================================
+    
+    /// Preparsed trades awaiting publish (pipeline mode only)
+    std::unique_ptr<SpscRing<TradeRecord>> queue_;
+    
+    /// Publisher thread (pipeline mode only)
+    std::thread publisherThread_;
+    
+    /// Set once the reader has exited so the publisher can drain and stop
+    std::atomic<bool> readerDone_{false};
+    
+    /// Records dropped because the ring was full
+    std::atomic<long long> queueOverflows_{0};
+    
+    /// Columnar trade batch (batching mode only; owned by the publishing thread)
+    std::unique_ptr<ColumnBatch> batch_;
+    
+    /// Rolling VWAP stage (analytics enabled only; owned by the publishing thread)
+    std::unique_ptr<AnalyticsEngine> analytics_;
+    
+    /// Shared-memory TP transport (shm enabled only; owned by the publishing thread)
+    std::unique_ptr<ShmPublisher> shm_;
+    
+    // ========================================================================
+    // CAPTURE / REPLAY
+    // ========================================================================
+    
+    /// Raw frame capture (capture enabled only; reader thread)
+    std::unique_ptr<capture::Writer> capture_;
+    
+    /// Replay source (empty path = live)
+    ReplayOptions replay_;
+    
+    /// Replay without a TP: updates are built and dropped
+    bool dryRun_{false};
     
     // ========================================================================
     // HEALTH TRACKING
@@ -170,67 +335,137 @@ private:
     /// Handler start time (for uptime calculation)
     std::chrono::system_clock::time_point startTime_;
     
+    // Counters are atomic: in pipeline mode the reader updates the receive
+    // side and the publisher thread updates the publish side and reads all.
+    
     /// Total messages received from Binance
-    long long msgsReceived_{0};
+    std::atomic<long long> msgsReceived_{0};
     
     /// Total messages published to TP
-    long long msgsPublished_{0};
+    std::atomic<long long> msgsPublished_{0};
     
     /// Time of last message received
-    std::chrono::system_clock::time_point lastMsgTime_;
+    std::atomic<std::chrono::system_clock::time_point> lastMsgTime_{};
     
     /// Time of last publish to TP
-    std::chrono::system_clock::time_point lastPubTime_;
+    std::atomic<std::chrono::system_clock::time_point> lastPubTime_{};
     
-    /// Current connection state
-    std::string connState_{"disconnected"};
+    /// Current connection state (static string literal)
+    std::atomic<const char*> connState_{"disconnected"};
     
     /// Health publish interval in seconds
     static constexpr int HEALTH_INTERVAL_SEC = 5;
+    
+    /// Running on a shared connection (attach())
+    bool attached_{false};
 
     // ========================================================================
     // PRIVATE METHODS
     // ========================================================================
     
     /**
-     * @brief Build Binance combined stream path
-     * @return Stream path (e.g., "/stream?streams=btcusdt@trade/ethusdt@trade")
+     * @brief Register streams, frame route and timers on a connection
+     * 
+     * Subscribes to <symbol>@trade for every symbol. Called by run() for
+     * the handler's own connection and by attach() for a shared one.
      */
-    std::string buildStreamPath() const;
+    void registerOn(BinanceStream& stream);
+    
+    /// Housekeeping tick: stop-check period, or the batch delay if finer
+    std::chrono::microseconds timerTick() const;
     
     /**
-     * @brief Connect to tickerplant with retry
-     * @return true if connected, false if shutdown requested
+     * @brief Validate tradeId sequence and log anomalies
+     * @param symIdx Symbol index (unknown symbols are not checked)
+     * @param sym Symbol name (for logging)
+     * @param tradeId Current trade ID
      */
-    bool connectToTP();
+    void validateTradeId(int symIdx, const char* sym, long long tradeId);
     
     /**
-     * @brief Sleep with exponential backoff
-     * @param attempt Current attempt number (0-based)
-     * @return true if should continue, false if shutdown requested
+     * @brief Process a single WebSocket message
+     * 
+     * Parses the trade and either publishes it inline or, in pipeline
+     * mode, enqueues it for the publisher thread.
+     * 
+     * @param msg Raw JSON message from Binance (mutable, NUL-terminated;
+     *            parsed in place)
+     * @param fhRecvTimeUtcNs Wall-clock receive time (recorded time on replay)
      */
-    bool sleepWithBackoff(int attempt);
+    void processMessage(char* msg, long long fhRecvTimeUtcNs);
     
     /**
-     * @brief Validate tradeId sequence and log anomalies
-     * @param sym Symbol name
-     * @param tradeId Current trade ID
+     * @brief Parse a trade message into a record (in situ, no allocation)
+     * @param msg Raw JSON message from Binance (modified in place)
+     * @param rec Output record (fhSeqNo not assigned)
+     * @param fhRecvTimeUtcNs Wall-clock receive time
+     * @return true if the message was a trade
      */
-    void validateTradeId(const std::string& sym, long long tradeId);
+    bool parseTrade(char* msg, TradeRecord& rec, long long fhRecvTimeUtcNs);
     
     /**
-     * @brief Process a single WebSocket message
-     * @param msg Raw JSON message from Binance
+     * @brief Build kdb+ row for a trade and send to TP
+     * 
+     * Queued if the TP connection is down (see TpOutbound). Called on the
+     * reader thread in direct mode and on the publisher thread in
+     * pipeline mode.
      */
-    void processMessage(const std::string& msg);
+    void publishTrade(const TradeRecord& rec);
+    
+    /**
+     * @brief Send pending batch to TP if full or past its delay
+     * @param force Flush regardless of size/age (shutdown)
+     */
+    void flushBatch(bool force = false);
+    
+    /**
+     * @brief Send pending analytics rows to TP if full or past their delay
+     * @param force Flush regardless of size/age (shutdown)
+     */
+    void flushAnalytics(bool force = false);
+    
+    /**
+     * @brief Send `.u.upd[table; data]` to TP (shm ring first, if enabled)
+     * 
+     * Takes ownership of data. On a dead connection the update is queued
+     * and replayed after the background reconnect; never blocks on it.
+     * 
+     * @return true if sent now
+     */
+    bool sendToTP(SymAtom& table, K data);
+    
+    /// TP opened (sends are delivered or queued), or replaying without one (dropped)
+    bool tpReady() const { return tp_->isOpen() || dryRun_; }
+    
+    /**
+     * @brief Publisher thread body (pipeline mode)
+     * 
+     * Drains the ring, publishes trades and health until the reader has
+     * exited and the ring is empty.
+     */
+    void runPublisherLoop();
+    
+    /**
+     * @brief Handle one @trade frame from the connection
+     * 
+     * Updates receive health, captures the raw frame and processes it.
+     * 
+     * @param msg Frame (mutable, NUL-terminated; parsed in place)
+     * @param len Frame length (without the NUL)
+     * @param fhRecvTimeUtcNs Wall-clock receive time
+     */
+    void onFrame(char* msg, size_t len, long long fhRecvTimeUtcNs);
+    
+    /// Open the capture file (live mode, capture enabled)
+    void openCapture();
     
     /**
-     * @brief Run the WebSocket connection loop
+     * @brief Feed the replay file through processMessage() (replay mode)
      * 
-     * Connects to Binance and processes messages until disconnected or stopped.
-     * Called by run() inside the reconnection loop.
+     * Paces frames to their recorded spacing divided by the replay speed
+     * (none at max), then logs throughput and stage latency percentiles.
      */
-    void runWebSocketLoop();
+    void runReplay();
     
     /**
      * @brief Publish health metrics to TP
@@ -0,0 +1,392 @@
+/**
+ * @file feed_handler.cpp
+ * @brief Unified feed handler: trade and depth streams in one process
+ *
+ * Runs the trade and quote handlers together instead of as two
+ * processes. The process is split into worker threads (config "workers"),
+ * each with:
+ *   - one Binance connection subscribed to its symbols' @trade and/or
+ *     @depth@100ms streams, frames routed by stream name to the trade or
+ *     quote handler (BinanceStream's dispatch table)
+ *   - one io_context running the read loop and both handlers' timers
+ *   - one TP connection and backlog (TpOutbound) both handlers send through
+ *   - one health_feed_handler row (fh, or fh_w<i> with several workers)
+ *     plus telemetry_fh_hist rows per handler (<name>_trade, <name>_quote)
+ *
+ * Everything a worker builds is created, used and freed on its own
+ * thread, so the kdb+ objects never cross threads (r1/r0 are not atomic).
+ * Scaling is by workers (cores), not processes. Capture files get a
+ * .trade / .quote suffix (and .w<i> per worker) and are replayed with
+ * the per-stream handlers; checkpoint and spill files get .w<i>.
+ */
+
+#include "trade_feed_handler.hpp"
+#include "quote_feed_handler.hpp"
+#include "binance_stream.hpp"
+#include "config.hpp"
+#include "cpu_affinity.hpp"
+#include "logger.hpp"
+#include "tp_outbound.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const std::string DEFAULT_CONFIG_PATH = "config/feed_handler.json";
+
+/// Nanoseconds between Unix epoch (1970) and kdb+ epoch (2000)
+static constexpr long long KDB_EPOCH_OFFSET_NS = 946684800000000000LL;
+
+/// Health publish interval in seconds
+static constexpr int HEALTH_INTERVAL_SEC = 5;
+
+// ============================================================================
+// SIGNAL HANDLING
+// ============================================================================
+
+// Run flag of every worker (connections, TP connects and reconnects)
+static std::atomic<bool> g_running{true};
+
+static void signalHandler(int signum) {
+    const char* sigName = (signum == SIGINT) ? "SIGINT" :
+                          (signum == SIGTERM) ? "SIGTERM" : "UNKNOWN";
+    spdlog::info("Received {} ({})", sigName, signum);
+
+    g_running = false;
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+/// Worker's own spill file (<spill_path><suffix>)
+static OutboundConfig workerOutbound(const OutboundConfig& cfg, const std::string& fileSuffix) {
+    OutboundConfig out = cfg;
+    out.spillPath += fileSuffix;
+    return out;
+}
+
+/**
+ * @class FeedWorker
+ * @brief One worker thread: shared connection, loop, TP connection and health
+ *
+ * Construct, run and destroy on the worker's thread.
+ *
+ * @tparam Depth Price levels per side of the quote books
+ */
+template<int Depth>
+class FeedWorker {
+public:
+    /**
+     * @param name Health handler name (fh, fh_w<i>)
+     * @param config Process config (TP, batching, analytics, conflation, ...)
+     * @param worker This worker's streams
+     * @param symbols This worker's symbols (lowercase)
+     * @param rest REST settings for this worker's quote handler
+     * @param restLimiter Weight budget shared by all workers (same IP)
+     * @param fileSuffix Appended to capture, checkpoint and spill paths
+     */
+    FeedWorker(std::string name, const FeedHandlerConfig& config, const WorkerConfig& worker,
+               std::vector<std::string> symbols, const RestConfig& rest,
+               std::shared_ptr<WeightLimiter> restLimiter, const std::string& fileSuffix)
+        : name_(std::move(name))
+        , symbols_(std::move(symbols))
+        , stream_(g_running, connState_)
+        , tp_(config.tpHost, config.tpPort, workerOutbound(config.outbound, fileSuffix), g_running)
+        , tradeHistName_(name_ + "_trade")
+        , quoteHistName_(name_ + "_quote")
+        , startTime_(std::chrono::system_clock::now())
+    {
+        // Shared memory is per handler process: TCP only here
+        if (worker.hasStream("trade")) {
+            CaptureConfig capture = config.capture;
+            capture.path += ".trade" + fileSuffix;
+            trade_ = std::make_unique<TradeFeedHandler>(symbols_, config.tpHost, config.tpPort,
+                PipelineConfig(), config.batching, config.analytics, ShmConfig(), capture,
+                config.outbound);
+        }
+        if (worker.hasStream("depth")) {
+            CaptureConfig capture = config.capture;
+            capture.path += ".quote" + fileSuffix;
+            CheckpointConfig checkpoint = config.checkpoint;
+            checkpoint.path += fileSuffix;
+            quote_ = std::make_unique<QuoteFeedHandler<Depth>>(symbols_, config.tpHost, config.tpPort,
+                config.batching, rest, config.quoteTable, std::move(restLimiter), config.analytics,
+                ShmConfig(), config.conflation, capture, config.outbound, checkpoint);
+        }
+    }
+
+    // Non-copyable (handlers are registered on the stream)
+    FeedWorker(const FeedWorker&) = delete;
+    FeedWorker& operator=(const FeedWorker&) = delete;
+
+    /// Connect to TP, attach the handlers and read until stopped (blocking)
+    void run() {
+        spdlog::info("Worker {}: {} symbols, streams:{}{}", name_, symbols_.size(),
+            trade_ ? " trade" : "", quote_ ? " depth" : "");
+
+        if (!tp_.connect()) {
+            spdlog::warn("Shutdown before TP connection established");
+            return;
+        }
+
+        if (trade_) trade_->attach(stream_, tp_);
+        if (quote_) quote_->attach(stream_, tp_);
+
+        stream_.addTimer(std::chrono::seconds(HEALTH_INTERVAL_SEC), [this] {
+            publishHealth();
+            return true;
+        });
+
+        stream_.run();
+
+        if (quote_) quote_->detach();
+        if (trade_) trade_->detach();
+        if (stream_.unrouted() > 0) {
+            spdlog::warn("Worker {}: {} frames matched no stream route", name_, stream_.unrouted());
+        }
+        tp_.close();  // Replays what it can of any backlog first
+        spdlog::info("Worker {} stopped", name_);
+    }
+
+private:
+    /// One health row for the connection (both handlers summed)
+    void publishHealth() {
+        if (!tp_.isOpen()) return;
+
+        auto now = std::chrono::system_clock::now();
+
+        // Calculate uptime
+        long long uptimeSec = std::chrono::duration_cast<std::chrono::seconds>(
+            now - startTime_).count();
+
+        // Convert timestamps to kdb+ format
+        auto toKdbTs = [](std::chrono::system_clock::time_point tp) -> long long {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                tp.time_since_epoch()).count() - KDB_EPOCH_OFFSET_NS;
+        };
+
+        long long received = 0;
+        long long published = 0;
+        long long conflated = 0;
+        std::chrono::system_clock::time_point lastMsg{};
+        std::chrono::system_clock::time_point lastPub{};
+        if (trade_) {
+            received += trade_->msgsReceived();
+            published += trade_->msgsPublished();
+            lastMsg = std::max(lastMsg, trade_->lastMsgTime());
+            lastPub = std::max(lastPub, trade_->lastPubTime());
+        }
+        if (quote_) {
+            received += quote_->msgsReceived();
+            published += quote_->msgsPublished();
+            lastMsg = std::max(lastMsg, quote_->lastMsgTime());
+            lastPub = std::max(lastPub, quote_->lastPubTime());
+            conflated = quote_->conflated();
+        }
+        const char* state = connState_.load();
+
+        // Build health row (16 fields)
+        K row = knk(16,
+            ktj(-KP, toKdbTs(now)),                    // time
+            ks((S)name_.c_str()),                       // handler
+            ktj(-KP, toKdbTs(startTime_)),             // startTimeUtc
+            kj(uptimeSec),                              // uptimeSec
+            kj(received),                               // msgsReceived
+            kj(published),                              // msgsPublished
+            ktj(-KP, toKdbTs(lastMsg)),                // lastMsgTimeUtc
+            ktj(-KP, toKdbTs(lastPub)),                // lastPubTimeUtc
+            ks((S)state),                               // connState
+            ki(static_cast<int>(symbols_.size())),      // symbolCount
+            kj(0LL),                                    // queueDepth (no pipeline)
+            kj(0LL),                                    // queueOverflows
+            kj(conflated),                              // conflated
+            kj(tp_.backlog()),                          // tpBacklog
+            kj(tp_.spilled()),                          // tpSpilled
+            kj(tp_.dropped())                           // tpDropped
+        );
+
+        // Publish to TP (queued behind any backlog, like data)
+        tp_.send(healthTable_, row);
+
+        // Stage latency histograms per handler for the interval
+        if (trade_) {
+            K hist = trade_->latencyStats().takeInterval(tradeHistName_.c_str(), toKdbTs(now));
+            if (hist) tp_.send(histTable_, hist);
+        }
+        if (quote_) {
+            K hist = quote_->latencyStats().takeInterval(quoteHistName_.c_str(), toKdbTs(now));
+            if (hist) tp_.send(histTable_, hist);
+        }
+
+        spdlog::debug("Health published: {} uptime={}s msgs={}/{} state={} tpBacklog={}",
+            name_, uptimeSec, received, published, state, tp_.backlog());
+    }
+
+    std::string name_;
+    std::vector<std::string> symbols_;
+
+    /// Binance connection state (static string literal)
+    std::atomic<const char*> connState_{"disconnected"};
+
+    /// The worker's connection (both handlers' streams) and TP connection
+    BinanceStream stream_;
+    TpOutbound tp_;
+
+    /// Handlers of the configured streams (nullptr = stream not assigned)
+    std::unique_ptr<TradeFeedHandler> trade_;
+    std::unique_ptr<QuoteFeedHandler<Depth>> quote_;
+
+    SymAtom healthTable_{"health_feed_handler"};
+    SymAtom histTable_{"telemetry_fh_hist"};
+    std::string tradeHistName_;
+    std::string quoteHistName_;
+    std::chrono::system_clock::time_point startTime_;
+};
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+/**
+ * @brief Check the worker assignment before anything connects
+ * @return false (after logging why) if a worker cannot run
+ */
+static bool validateWorkers(const FeedHandlerConfig& config, const std::vector<WorkerConfig>& workers) {
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const WorkerConfig& w = workers[i];
+        for (const auto& s : w.streams) {
+            if (s != "trade" && s != "depth") {
+                spdlog::warn("Worker {}: unknown stream \"{}\" ignored (expected trade or depth)", i, s);
+            }
+        }
+        const int kinds = (w.hasStream("trade") ? 1 : 0) + (w.hasStream("depth") ? 1 : 0);
+        if (kinds == 0) {
+            spdlog::error("Worker {} has no trade or depth stream", i);
+            return false;
+        }
+        const size_t symbols = w.symbols.empty() ? config.symbols.size() : w.symbols.size();
+        if (symbols * kinds > static_cast<size_t>(BinanceStream::MAX_STREAMS)) {
+            spdlog::error("Worker {}: {} streams exceed the {} per connection, split its symbols across workers",
+                i, symbols * kinds, BinanceStream::MAX_STREAMS);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Run every worker on its own thread until stopped
+ *
+ * REST workers are divided between the workers and all of them share one
+ * request weight budget (same IP).
+ */
+template<int Depth>
+static void runWorkers(const FeedHandlerConfig& config, const std::vector<WorkerConfig>& workers) {
+    const int numWorkers = static_cast<int>(workers.size());
+
+    RestConfig rest = config.rest;
+    if (rest.workers > 0) {
+        rest.workers = std::max(1, rest.workers / numWorkers);
+    }
+    auto limiter = std::make_shared<WeightLimiter>(config.rest.maxWeightPerMinute);
+
+    // Workers intern symbols concurrently: make ss() take a lock
+    if (numWorkers > 1) {
+        setm(1);
+    }
+
+    spdlog::info("{} symbols across {} workers, L{} books -> {}",
+        config.symbols.size(), numWorkers, Depth, config.quoteTable);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numWorkers; ++i) {
+        const std::string name = numWorkers > 1 ? "fh_w" + std::to_string(i) : "fh";
+        const std::string fileSuffix = numWorkers > 1 ? ".w" + std::to_string(i) : "";
+        threads.emplace_back([&config, &workers, &rest, &limiter, i, name, fileSuffix] {
+            const WorkerConfig& w = workers[i];
+            if (!pinCurrentThread(w.cpu)) {
+                spdlog::warn("Failed to pin worker {} to CPU {}", i, w.cpu);
+            }
+            FeedWorker<Depth> worker(name, config, w, w.symbols.empty() ? config.symbols : w.symbols,
+                                     rest, limiter, fileSuffix);
+            worker.run();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "=== Binance Feed Handler ===" << std::endl;
+
+    // Config path (first plain argument or default)
+    std::string configPath = DEFAULT_CONFIG_PATH;
+    ReplayOptions replay;
+    if (!ReplayOptions::parse(argc, argv, configPath, replay)) {
+        return 1;
+    }
+    if (replay.enabled()) {
+        std::cerr << "--replay is not supported here: replay .trade captures with trade_feed_handler"
+                  << " and .quote captures with quote_feed_handler\n";
+        return 1;
+    }
+
+    // Load configuration
+    FeedHandlerConfig config;
+    if (!config.load(configPath)) {
+        std::cerr << "Failed to load config, exiting\n";
+        return 1;
+    }
+
+    if (config.symbols.empty()) {
+        std::cerr << "No symbols configured, exiting\n";
+        return 1;
+    }
+
+    // Initialize logger
+    initLogger("FH", config.logLevel, config.logFile);
+
+    // No "workers" block: one worker, both streams, all symbols
+    std::vector<WorkerConfig> workers = config.workers;
+    if (workers.empty()) {
+        workers.push_back(WorkerConfig());
+    }
+    if (!validateWorkers(config, workers)) {
+        shutdownLogger();
+        return 1;
+    }
+    if (config.shm.enabled) {
+        spdlog::warn("Shared-memory transport is not supported by feed_handler, publishing over TCP");
+    }
+
+    // Install signal handlers
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    spdlog::info("Signal handlers installed (Ctrl+C to shutdown)");
+
+    // Run the workers for the configured book depth
+    switch (config.bookDepth) {
+        case 1:  runWorkers<1>(config, workers); break;
+        case 5:  runWorkers<5>(config, workers); break;
+        case 10: runWorkers<10>(config, workers); break;
+        case 20: runWorkers<20>(config, workers); break;
+        default:
+            spdlog::error("Unsupported book depth {} (expected 1, 5, 10 or 20)", config.bookDepth);
+            shutdownLogger();
+            return 1;
+    }
+
+    spdlog::info("Exiting");
+    shutdownLogger();
+    return 0;
+}
@@ -1,32 +1,58 @@
 /**
  * @file quote_feed_handler.cpp
- * @brief Implementation of QuoteFeedHandler class (L5 version)
+ * @brief Implementation of QuoteFeedHandler<Depth>
  * 
  * Uses OrderBookManager for efficient multi-symbol book management.
- * Publishes L5 quotes (22 price/qty fields) to kdb+.
+ * Publishes depth-N quotes (4*N price/qty fields) to kdb+.
+ * Instantiated for depths 1, 5, 10 and 20 (see end of file).
  */
 
 #include "quote_feed_handler.hpp"
+#include "quote_shard_publisher.hpp"
+#include "decimal_parser.hpp"
 
-#include <rapidjson/document.h>
 #include <spdlog/spdlog.h>
 
-#include <iostream>
 #include <chrono>
 #include <thread>
-#include <csignal>
+#include <cerrno>
+#include <cstring>
 #include <algorithm>
 #include <cctype>
+#include <functional>
+#include <iterator>
+#include <sstream>
+
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 
 // ============================================================================
 // CONSTRUCTION / DESTRUCTION
 // ============================================================================
 
-QuoteFeedHandler::QuoteFeedHandler(const std::vector<std::string>& symbols,
+template<int Depth>
+QuoteFeedHandler<Depth>::QuoteFeedHandler(const std::vector<std::string>& symbols,
                                    const std::string& tpHost,
-                                   int tpPort)
-    : tpHost_(tpHost)
+                                   int tpPort,
+                                   const BatchConfig& batching,
+                                   const RestConfig& rest,
+                                   const std::string& quoteTable,
+                                   std::shared_ptr<WeightLimiter> restLimiter,
+                                   const AnalyticsConfig& analytics,
+                                   const ShmConfig& shm,
+                                   const ConflationConfig& conflation,
+                                   const CaptureConfig& capture,
+                                   const OutboundConfig& outbound,
+                                   const CheckpointConfig& checkpoint)
+    : batching_(batching)
+    , quoteTable_(quoteTable)
+    , tpHost_(tpHost)
     , tpPort_(tpPort)
+    , outboundCfg_(outbound)
+    , restClient_(rest.workers, rest.maxWeightPerMinute, std::move(restLimiter))
+    , conflation_(conflation)
+    , captureCfg_(capture)
+    , checkpointCfg_(checkpoint)
     , startTime_(std::chrono::system_clock::now())
 {
     // Store lowercase (for WebSocket) and uppercase (for internal use)
@@ -39,206 +65,298 @@ QuoteFeedHandler::QuoteFeedHandler(const std::vector<std::string>& symbols,
     }
     
     // Create book manager with uppercase symbols
-    bookMgr_ = std::make_unique<OrderBookManager>(symbolsUpper_);
-}
-
-QuoteFeedHandler::~QuoteFeedHandler() {
-    if (tpHandle_ > 0) {
-        kclose(tpHandle_);
-        spdlog::debug("TP connection closed in destructor");
+    bookMgr_ = std::make_unique<QuoteBook>(symbolsUpper_);
+    interned_ = std::make_unique<InternedSymbols>(symbolsUpper_);
+    latency_ = std::make_unique<LatencyStats>(symbolsUpper_);
+    
+    if (batching_.enabled) {
+        batch_ = std::make_unique<ColumnBatch>(quoteTable_.name(), batchColumnTypes(),
+            batching_.maxRows, batching_.maxDelayUs);
     }
+    
+    if (analytics.enabled) {
+        analytics_ = std::make_unique<AnalyticsEngine>(symbolsUpper_, analytics, batching_);
+    }
+    
+    if (shm.enabled) {
+        shm_ = std::make_unique<ShmPublisher>(shm);
+    }
+    
+    // Latency-critical symbols bypass conflation
+    critical_.assign(symbolsLower_.size(), 0);
+    for (size_t i = 0; i < symbolsLower_.size(); ++i) {
+        for (const auto& c : conflation_.criticalSymbols) {
+            if (c == symbolsLower_[i]) critical_[i] = 1;
+        }
+    }
+    
+    // At most every symbol is due at once: no growth on the hot path
+    timeoutSymbols_.reserve(symbolsUpper_.size());
+    warm_.assign(symbolsUpper_.size(), 0);
+    
+    // Wake the WebSocket loop as soon as a snapshot completes
+    restClient_.setCompletionNotifier([this] {
+        std::lock_guard<std::mutex> lock(loopMutex_);
+        if (loopIoc_) {
+            net::post(*loopIoc_, [this] {
+                loopNow_ = std::chrono::steady_clock::now();
+                processSnapshotCompletions();
+            });
+        }
+    });
 }
 
+template<int Depth>
+QuoteFeedHandler<Depth>::~QuoteFeedHandler() = default;
+
 // ============================================================================
 // PUBLIC INTERFACE
 // ============================================================================
 
-void QuoteFeedHandler::run() {
-    spdlog::info("Starting L5 Quote Feed Handler...");
+template<int Depth>
+void QuoteFeedHandler<Depth>::run() {
+    if (shardPublisher_) {
+        spdlog::info("Starting L{} Quote Feed Handler shard {} -> {}", Depth, shardId_, quoteTable_.name());
+    } else {
+        spdlog::info("Starting L{} Quote Feed Handler -> {}", Depth, quoteTable_.name());
+    }
     spdlog::info("Symbols: {}", fmt::join(symbolsLower_, " "));
     
-    // Connect to tickerplant
-    if (!connectToTP()) {
+    // Own TP connection (attached handlers use the worker's instead)
+    ownTp_ = std::make_unique<TpOutbound>(tpHost_, tpPort_, outboundCfg_, running_);
+    tp_ = ownTp_.get();
+    
+    // Replay without TP: k objects are still built, so set up the k memory
+    // manager that khpu() would otherwise initialise
+    if (replay_.enabled() && !replay_.useTp) {
+        dryRun_ = true;
+        khp((S)"", -1);
+        spdlog::info("Replay without TP: updates are built and dropped");
+    } else if (!shardPublisher_ && !tp_->connect()) {
+        // Connect to tickerplant (shard mode: the shared publisher owns it)
         spdlog::warn("Shutdown before TP connection established");
         return;
     }
     
-    // Main loop with reconnection
-    while (running_) {
-        try {
-            runWebSocketLoop();
-        } catch (const std::exception& e) {
-            if (!running_) {
-                spdlog::info("Connection closed during shutdown");
-            } else {
-                spdlog::error("Binance error: {}", e.what());
-                spdlog::info("Will reconnect...");
-                if (!sleepWithBackoff(binanceReconnectAttempt_++)) {
-                    break;
-                }
-            }
-        }
+    if (replay_.enabled()) {
+        // One pass over the file (scales and snapshots come from it too)
+        runReplay();
+    } else {
+        // Capture first so the scales below are recorded
+        openCapture();
+        prepareBooks();
+        
+        // Live: read Binance, reconnecting with backoff, until stopped
+        BinanceStream stream{running_, connState_};
+        registerOn(stream);
+        stream.run();
     }
     
     // Cleanup
     spdlog::info("Cleaning up...");
-    if (tpHandle_ > 0) {
-        kclose(tpHandle_);
-        tpHandle_ = -1;
-        spdlog::info("TP connection closed");
+    finishBooks();
+    if (tp_->isOpen()) {
+        tp_->close();  // Replays what it can of any backlog first
+    }
+    if (capture_) {
+        spdlog::info("Capture closed: {} records, {} bytes", capture_->records(), capture_->bytes());
+        capture_->close();
     }
     
     spdlog::info("Shutdown complete (processed {} messages)", fhSeqNo_);
 }
 
-void QuoteFeedHandler::stop() {
+template<int Depth>
+void QuoteFeedHandler<Depth>::stop() {
     spdlog::info("Stop requested");
     running_ = false;
 }
 
-// ============================================================================
-// CONNECTION MANAGEMENT
-// ============================================================================
+template<int Depth>
+void QuoteFeedHandler<Depth>::attach(BinanceStream& stream, TpOutbound& tp) {
+    spdlog::info("L{} quote symbols -> {}: {}", Depth, quoteTable_.name(), fmt::join(symbolsLower_, " "));
+    attached_ = true;
+    tp_ = &tp;
+    
+    // Capture first so the scales are recorded
+    openCapture();
+    prepareBooks();
+    registerOn(stream);
+}
 
-std::string QuoteFeedHandler::buildDepthStreamPath() const {
-    // Use @depth@100ms for 10 updates/second (faster than @depth which is 1/sec)
-    std::string path = "/stream?streams=";
-    for (size_t i = 0; i < symbolsLower_.size(); ++i) {
-        if (i > 0) path += "/";
-        path += symbolsLower_[i] + "@depth@100ms";
+template<int Depth>
+void QuoteFeedHandler<Depth>::detach() {
+    finishBooks();
+    if (capture_) {
+        spdlog::info("Quote capture closed: {} records, {} bytes", capture_->records(), capture_->bytes());
+        capture_->close();
     }
-    return path;
+    spdlog::info("Quote streams stopped (processed {} messages)", fhSeqNo_);
 }
 
-bool QuoteFeedHandler::connectToTP() {
-    int attempt = 0;
-    while (running_) {
-        spdlog::info("Connecting to TP on {}:{}...", tpHost_, tpPort_);
-        
-        int h = khpu((S)tpHost_.c_str(), tpPort_, (S)"");
-        
-        if (h > 0) {
-            tpHandle_ = h;
-            spdlog::info("Connected to TP (handle {})", h);
-            return true;
-        }
-        
-        spdlog::error("Failed to connect to TP");
-        if (!sleepWithBackoff(attempt++)) {
-            return false;
-        }
-    }
-    return false;
+template<int Depth>
+void QuoteFeedHandler<Depth>::prepareBooks() {
+    // Tick/lot sizes for the book representation
+    loadInstrumentScales();
+    
+    // Warm start: books from the last run's checkpoint (same scales only)
+    restoreCheckpoint();
+    openCheckpoint();
 }
 
-bool QuoteFeedHandler::sleepWithBackoff(int attempt) {
-    int delay = INITIAL_BACKOFF_MS;
-    for (int i = 0; i < attempt && delay < MAX_BACKOFF_MS; ++i) {
-        delay *= BACKOFF_MULTIPLIER;
+template<int Depth>
+void QuoteFeedHandler<Depth>::finishBooks() {
+    if (tpReady() || shardPublisher_) {
+        flushConflated();
     }
-    delay = std::min(delay, MAX_BACKOFF_MS);
-    
-    spdlog::info("Waiting {}ms before reconnect...", delay);
-    
-    const int checkIntervalMs = 100;
-    int slept = 0;
-    while (slept < delay && running_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(checkIntervalMs));
-        slept += checkIntervalMs;
+    if (tpReady()) {
+        flushBatch(true);
     }
-    
-    return running_;
+    if (checkpoint_) {
+        saveCheckpoint();
+        spdlog::info("Checkpoint saved to {} ({} saves)", checkpointPath(), checkpoint_->saves());
+        checkpoint_->close();
+    }
+}
+
+// ============================================================================
+// CONNECTION MANAGEMENT
+// ============================================================================
+
+template<int Depth>
+std::chrono::microseconds QuoteFeedHandler<Depth>::timerTick() const {
+    // A fifth of the publish timeout keeps heartbeats within 20% of it
+    long long us = PUBLISH_TIMEOUT_MS * 1000LL / 5;
+    if (batching_.enabled) {
+        us = std::min<long long>(us, batching_.maxDelayUs);
+    }
+    return std::chrono::microseconds(std::max<long long>(us, MIN_TICK_US));
 }
 
 // ============================================================================
 // WEBSOCKET LOOP
 // ============================================================================
 
-void QuoteFeedHandler::runWebSocketLoop() {
-    std::string target = buildDepthStreamPath();
-    spdlog::info("Connecting to Binance: {}{}", BINANCE_HOST, target);
-    
-    connState_ = "connecting";
+template<int Depth>
+void QuoteFeedHandler<Depth>::registerOn(BinanceStream& stream) {
+    // @depth@100ms: 10 updates/second (faster than @depth which is 1/sec)
+    for (const auto& sym : symbolsLower_) {
+        stream.addStream(sym + "@depth@100ms");
+    }
+    stream.addRoute("@depth@100ms", [this](char* msg, size_t len, long long fhRecvTimeUtcNs) {
+        onFrame(msg, len, fhRecvTimeUtcNs);
+    });
+    stream.onConnecting([this] { resetBooks(); });
     
-    // Reset all books on reconnect
-    bookMgr_->resetAll();
+    // REST workers post completions to the loop while it runs
+    stream.onLoop([this](net::io_context* ioc) { setLoop(ioc); });
     
-    // Initialize ASIO and SSL
-    net::io_context ioc;
-    ssl::context ctx{ssl::context::tlsv12_client};
-    ctx.set_default_verify_paths();
+    // Capture file growth ahead of the frames
+    if (capture_) {
+        stream.addTimer(std::chrono::milliseconds(capture::RESERVE_CHECK_MS), [this] {
+            return capture_->reserveAhead();
+        });
+    }
     
-    // Resolve and connect
-    tcp::resolver resolver{ioc};
-    websocket::stream<beast::ssl_stream<tcp::socket>> ws{ioc, ctx};
+    // Publish timeouts and batch delay, on a fixed cadence whether or not
+    // frames arrive
+    stream.addTimer(timerTick(), [this] {
+        loopNow_ = std::chrono::steady_clock::now();
+        processSnapshotCompletions();
+        auto now = std::chrono::system_clock::now();
+        checkPublishTimeouts(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now.time_since_epoch()).count());
+        flushBatch();
+        tp_->poll();
+        return true;
+    });
     
-    auto const results = resolver.resolve(BINANCE_HOST, BINANCE_PORT);
-    net::connect(ws.next_layer().next_layer(), results.begin(), results.end());
+    // Unified mode: the worker publishes one health row per connection
+    if (!attached_) {
+        stream.addTimer(std::chrono::seconds(HEALTH_INTERVAL_SEC), [this] {
+            publishHealth();
+            return true;
+        });
+    }
     
-    // TLS handshake
-    ws.next_layer().handshake(ssl::stream_base::client);
+    // Conflation cadence: latest state of each dirty symbol
+    if (conflation_.enabled) {
+        stream.addTimer(std::chrono::microseconds(std::max<long long>(
+            conflation_.intervalUs, MIN_TICK_US)), [this] {
+            loopNow_ = std::chrono::steady_clock::now();
+            flushConflated();
+            return true;
+        });
+    }
     
-    // WebSocket handshake
-    ws.handshake(BINANCE_HOST, target);
+    // Book checkpoint cadence (warm restarts)
+    if (checkpoint_) {
+        stream.addTimer(std::chrono::milliseconds(std::max(checkpointCfg_.intervalMs, 1)), [this] {
+            saveCheckpoint();
+            return true;
+        });
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::resetBooks() {
+    // Reset all books on reconnect (first connect after a warm start:
+    // keep the restored books, the first delta of each validates it)
+    if (keepBooksOnConnect_) {
+        keepBooksOnConnect_ = false;
+        return;
+    }
+    bookMgr_->resetAll();
+    std::fill(warm_.begin(), warm_.end(), 0);
+    warmPending_ = 0;
+    if (capture_) {
+        capture_->append(capture::REC_RESET, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count(), "", 0);
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::onFrame(char* msg, size_t len, long long fhRecvTimeUtcNs) {
+    stageMarkNs_ = latency::nowNs();
+    loopNow_ = std::chrono::steady_clock::now();
     
-    spdlog::info("Connected to Binance ({} symbols)", symbolsLower_.size());
-    connState_ = "connected";
+    // Update health: message received
+    lastMsgTime_.store(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(fhRecvTimeUtcNs))), std::memory_order_relaxed);
+    msgsReceived_.fetch_add(1, std::memory_order_relaxed);
     
-    // Reset backoff
-    binanceReconnectAttempt_ = 0;
+    // Raw frame as received, before the in-situ parser rewrites it
+    if (capture_) {
+        capture_->append(capture::REC_FRAME, fhRecvTimeUtcNs, msg, len);
+    }
     
-    // Health publish timer
-    auto lastHealthPub = std::chrono::steady_clock::now();
+    processMessage(msg, fhRecvTimeUtcNs);
     
-    // Message loop
-    while (running_) {
-        beast::flat_buffer buffer;
-        ws.read(buffer);
-        
-        if (!running_) break;
-        
-        auto recvTime = std::chrono::system_clock::now();
-        long long fhRecvTimeUtcNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            recvTime.time_since_epoch()).count();
-        
-        // Update health: message received
-        lastMsgTime_ = recvTime;
-        ++msgsReceived_;
-        
-        std::string msg = beast::buffers_to_string(buffer.data());
-        processMessage(msg, fhRecvTimeUtcNs);
-        
-        // Check publish timeouts
-        checkPublishTimeouts(fhRecvTimeUtcNs);
-        
-        // Publish health every HEALTH_INTERVAL_SEC seconds
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - lastHealthPub).count() >= HEALTH_INTERVAL_SEC) {
-            publishHealth();
-            lastHealthPub = now;
-        }
-    }
+    // Apply snapshots fetched by the REST workers
+    processSnapshotCompletions();
     
-    connState_ = "disconnected";
+    // Check publish timeouts
+    checkPublishTimeouts(fhRecvTimeUtcNs);
     
-    // Graceful close
-    if (!running_) {
-        try {
-            ws.close(websocket::close_code::normal);
-            spdlog::info("WebSocket closed gracefully");
-        } catch (...) {
-            // Ignore errors during shutdown
-        }
+    // Conflation: publish early once downstream has caught up
+    if (conflation_.flushOnIdle && bookMgr_->dirtyCount() > 0 && downstreamIdle()) {
+        flushConflated();
     }
+    
+    // Send a partial batch if it has waited max_delay_us (full batches are
+    // sent as they fill)
+    flushBatch();
 }
 
 // ============================================================================
 // MESSAGE PROCESSING
 // ============================================================================
 
-void QuoteFeedHandler::processMessage(const std::string& msg, long long fhRecvTimeUtcNs) {
-    rapidjson::Document doc;
-    doc.Parse(msg.c_str());
+template<int Depth>
+void QuoteFeedHandler<Depth>::processMessage(char* msg, long long fhRecvTimeUtcNs) {
+    // Parse JSON in place (pooled allocator, strings point into msg)
+    auto& doc = parser_.parseInsitu(msg);
     if (!doc.IsObject()) return;
     
     // Combined stream format: {"stream":"btcusdt@depth@100ms","data":{...}}
@@ -246,73 +364,163 @@ void QuoteFeedHandler::processMessage(const std::string& msg, long long fhRecvTi
     const auto& d = doc["data"];
     if (!d.IsObject()) return;
     
-    // Extract symbol (uppercase)
+    // Extract symbol (uppercase), looked up by its bytes in the document
     if (!d.HasMember("s")) return;
-    std::string sym = d["s"].GetString();
+    const auto& s = d["s"];
     
-    int symIdx = bookMgr_->getSymbolIndex(sym);
+    int symIdx = bookMgr_->getSymbolIndex(s.GetString(), s.GetStringLength());
     if (symIdx < 0) return;  // Unknown symbol
     
     // Parse delta fields
     // U = first update ID, u = final update ID, E = event time
     if (!d.HasMember("U") || !d.HasMember("u")) return;
     
-    BufferedDelta delta;
-    delta.firstUpdateId = d["U"].GetInt64();
-    delta.finalUpdateId = d["u"].GetInt64();
-    delta.eventTimeMs = d.HasMember("E") ? d["E"].GetInt64() : 0;
+    const long long firstUpdateId = d["U"].GetInt64();
+    const long long finalUpdateId = d["u"].GetInt64();
+    const long long eventTimeMs = d.HasMember("E") ? d["E"].GetInt64() : 0;
     
-    // Parse bid updates
-    if (d.HasMember("b") && d["b"].IsArray()) {
-        for (const auto& lvl : d["b"].GetArray()) {
+    // Bid / ask update arrays (nullptr if absent)
+    const JsonParser::Value* bids = (d.HasMember("b") && d["b"].IsArray()) ? &d["b"] : nullptr;
+    const JsonParser::Value* asks = (d.HasMember("a") && d["a"].IsArray()) ? &d["a"] : nullptr;
+    const size_t maxBids = bids ? bids->Size() : 0;
+    const size_t maxAsks = asks ? asks->Size() : 0;
+    
+    // Decode one side's ["price","qty"] pairs into the book representation
+    // (out has room for the whole array); returns the number decoded
+    bool offGrid = false;
+    auto parseLevels = [this, symIdx, &offGrid](const JsonParser::Value* arr, Level* out) -> int {
+        int n = 0;
+        if (!arr) return n;
+        for (const auto& lvl : arr->GetArray()) {
             if (lvl.IsArray() && lvl.Size() >= 2) {
-                PriceLevel pl;
-                pl.price = std::stod(lvl[0].GetString());
-                pl.qty = std::stod(lvl[1].GetString());
-                delta.bids.push_back(pl);
+                if (!bookMgr_->parseLevel(symIdx,
+                        lvl[0].GetString(), lvl[0].GetStringLength(),
+                        lvl[1].GetString(), lvl[1].GetStringLength(), out[n++])) {
+                    offGrid = true;
+                }
             }
         }
-    }
+        return n;
+    };
     
-    // Parse ask updates
-    if (d.HasMember("a") && d["a"].IsArray()) {
-        for (const auto& lvl : d["a"].GetArray()) {
-            if (lvl.IsArray() && lvl.Size() >= 2) {
-                PriceLevel pl;
-                pl.price = std::stod(lvl[0].GetString());
-                pl.qty = std::stod(lvl[1].GetString());
-                delta.asks.push_back(pl);
-            }
+    // INIT: decode straight into the preallocated delta buffer
+    if (bookMgr_->getState(symIdx) == BookState::INIT) {
+        auto* rec = bookMgr_->beginBufferedDelta(symIdx, firstUpdateId, finalUpdateId,
+                                                 eventTimeMs, maxBids + maxAsks);
+        if (!rec) {
+            // Snapshot is not keeping up: drop the buffer (and any in-flight
+            // snapshot, via the generation) and start over from this delta
+            spdlog::warn("{} delta buffer full ({} buffered), forcing re-snapshot ({} overflows)",
+                bookMgr_->getSymbol(symIdx), bookMgr_->bufferedDeltaCount(symIdx),
+                bookMgr_->deltaOverflows(symIdx));
+            bookMgr_->reset(symIdx);
+            rec = bookMgr_->beginBufferedDelta(symIdx, firstUpdateId, finalUpdateId,
+                                               eventTimeMs, maxBids + maxAsks);
+            if (!rec) return;  // Single delta larger than the buffer storage
+        }
+        rec->numBids = parseLevels(bids, rec->levels);
+        rec->numAsks = parseLevels(asks, rec->levels + rec->numBids);
+        if (offGrid) {
+            resyncOffGrid(symIdx, fhRecvTimeUtcNs);  // Record not committed
+            return;
+        }
+        bookMgr_->commitBufferedDelta(symIdx, *rec);
+        recordStage(latency::STAGE_PARSE, symIdx);
+        
+        if (bookMgr_->needsSnapshot(symIdx)) {
+            requestSnapshot(symIdx);
         }
+        return;
+    }
+    
+    // Live delta: decode into the reused scratch delta (resize() within
+    // capacity does not allocate)
+    Delta& delta = scratchDelta_;
+    delta.firstUpdateId = firstUpdateId;
+    delta.finalUpdateId = finalUpdateId;
+    delta.eventTimeMs = eventTimeMs;
+    delta.bids.resize(maxBids);
+    delta.bids.resize(parseLevels(bids, delta.bids.data()));
+    delta.asks.resize(maxAsks);
+    delta.asks.resize(parseLevels(asks, delta.asks.data()));
+    recordStage(latency::STAGE_PARSE, symIdx);
+    if (offGrid) {
+        resyncOffGrid(symIdx, fhRecvTimeUtcNs);
+        return;
     }
     
     // Handle delta based on book state
     handleDelta(symIdx, delta, fhRecvTimeUtcNs);
 }
 
-void QuoteFeedHandler::handleDelta(int symIdx, const BufferedDelta& delta, long long fhRecvTimeUtcNs) {
+template<int Depth>
+void QuoteFeedHandler<Depth>::resyncOffGrid(int symIdx, long long fhRecvTimeUtcNs) {
+    const InstrumentScale& sc = bookMgr_->getScale(symIdx);
+    if (sc == InstrumentScale{}) {
+        // Already in atoms: only a value with more than 8 decimals gets
+        // here, which no resync would represent either
+        spdlog::warn("{} level finer than 1e-8, kept rounded ({} off-grid levels)",
+            bookMgr_->getSymbol(symIdx), bookMgr_->offGridLevels(symIdx));
+        return;
+    }
+    
+    // The exchange's tick/lot sizes no longer match: rebuild the book in
+    // atoms, which represent every Binance value exactly
+    spdlog::warn("{} price/qty off its grid (tick {} lot {} atoms, {} off-grid levels), "
+        "resyncing in 1e-8 units", bookMgr_->getSymbol(symIdx), sc.tickAtoms, sc.lotAtoms,
+        bookMgr_->offGridLevels(symIdx));
+    if (bookMgr_->isValid(symIdx)) {
+        publishInvalid(symIdx, fhRecvTimeUtcNs);
+    }
+    if (warm_[symIdx]) {
+        resolveWarm(symIdx, false);
+    }
+    bookMgr_->setScale(symIdx, InstrumentScale{});  // Resets the book
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::handleDelta(int symIdx, const Delta& delta, long long fhRecvTimeUtcNs) {
     BookState state = bookMgr_->getState(symIdx);
     
     switch (state) {
         case BookState::INIT:
-            // Buffer delta and request snapshot
-            bookMgr_->getDeltaBuffer(symIdx).push_back(delta);
-            
-            if (bookMgr_->needsSnapshot(symIdx)) {
-                requestSnapshot(symIdx);
-            }
+            // Buffered by processMessage (decoded straight into the arena)
             break;
             
         case BookState::SYNCING:
             // Apply delta (may transition to VALID)
-            if (!bookMgr_->applyDelta(symIdx, delta.firstUpdateId, delta.finalUpdateId,
-                                      delta.bids, delta.asks, delta.eventTimeMs)) {
-                spdlog::warn("{} failed to apply delta in SYNCING state", 
-                    bookMgr_->getSymbol(symIdx));
+            if (!bookMgr_->applyDelta(symIdx, delta)) {
+                if (!warm_[symIdx]) {
+                    spdlog::warn("{} failed to apply delta in SYNCING state",
+                        bookMgr_->getSymbol(symIdx));
+                    publishInvalid(symIdx, fhRecvTimeUtcNs);
+                    bookMgr_->reset(symIdx);
+                    break;
+                }
+
+                // Checkpoint is behind the stream: rebuild from REST, with
+                // this delta as the first one buffered for the snapshot
+                spdlog::info("{} checkpoint does not line up (U={}), resyncing via REST",
+                    bookMgr_->getSymbol(symIdx), delta.firstUpdateId);
+                resolveWarm(symIdx, false);
                 publishInvalid(symIdx, fhRecvTimeUtcNs);
                 bookMgr_->reset(symIdx);
+                if (auto* rec = bookMgr_->beginBufferedDelta(symIdx, delta.firstUpdateId, delta.finalUpdateId,
+                        delta.eventTimeMs, delta.bids.size() + delta.asks.size())) {
+                    std::copy(delta.bids.begin(), delta.bids.end(), rec->levels);
+                    std::copy(delta.asks.begin(), delta.asks.end(), rec->levels + delta.bids.size());
+                    rec->numBids = static_cast<int>(delta.bids.size());
+                    rec->numAsks = static_cast<int>(delta.asks.size());
+                    bookMgr_->commitBufferedDelta(symIdx, *rec);
+                    requestSnapshot(symIdx);
+                }
             } else {
+                recordStage(latency::STAGE_APPLY, symIdx);
                 if (bookMgr_->isValid(symIdx)) {
+                    if (warm_[symIdx]) {
+                        spdlog::info("{} is now VALID (from checkpoint)", bookMgr_->getSymbol(symIdx));
+                        resolveWarm(symIdx, true);
+                    }
                     maybePublish(symIdx, fhRecvTimeUtcNs);
                 }
             }
@@ -320,12 +528,12 @@ void QuoteFeedHandler::handleDelta(int symIdx, const BufferedDelta& delta, long
             
         case BookState::VALID:
             // Apply delta directly
-            if (!bookMgr_->applyDelta(symIdx, delta.firstUpdateId, delta.finalUpdateId,
-                                      delta.bids, delta.asks, delta.eventTimeMs)) {
+            if (!bookMgr_->applyDelta(symIdx, delta)) {
                 spdlog::warn("{} sequence gap detected", bookMgr_->getSymbol(symIdx));
                 publishInvalid(symIdx, fhRecvTimeUtcNs);
                 bookMgr_->reset(symIdx);
             } else {
+                recordStage(latency::STAGE_APPLY, symIdx);
                 maybePublish(symIdx, fhRecvTimeUtcNs);
             }
             break;
@@ -341,14 +549,75 @@ void QuoteFeedHandler::handleDelta(int symIdx, const BufferedDelta& delta, long
 // SNAPSHOT HANDLING
 // ============================================================================
 
-void QuoteFeedHandler::requestSnapshot(int symIdx) {
+template<int Depth>
+void QuoteFeedHandler<Depth>::loadInstrumentScales() {
+    spdlog::info("Book price representation: {}", QuotePriceRep::NAME);
+    
+    ExchangeInfoData info = restClient_.fetchExchangeInfo(symbolsUpper_);
+    if (!info.success) {
+        // 1e-8 units: still exact, just wider integers
+        spdlog::warn("exchangeInfo failed ({}), using 1e-8 price/qty units", info.error);
+        return;
+    }
+    
+    for (const auto& f : info.symbols) {
+        int symIdx = bookMgr_->getSymbolIndex(f.symbol);
+        if (symIdx < 0) continue;
+        
+        InstrumentScale sc = InstrumentScale::fromStrings(f.tickSize, f.stepSize);
+        bookMgr_->setScale(symIdx, sc);
+        spdlog::info("{} tickSize={} stepSize={}", f.symbol, f.tickSize, f.stepSize);
+        
+        if (capture_) {
+            const std::string text = f.symbol + ' ' + f.tickSize + ' ' + f.stepSize;
+            capture_->append(capture::REC_SCALE, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count(), text.data(), text.size());
+        }
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::requestSnapshot(int symIdx) {
     const std::string& sym = bookMgr_->getSymbol(symIdx);
     spdlog::info("Requesting snapshot for {}", sym);
     
     bookMgr_->setSnapshotRequested(symIdx, true);
     
-    // Fetch snapshot (blocking)
-    SnapshotData snapshot = restClient_.fetchSnapshot(sym, SNAPSHOT_DEPTH);
+    // Replay: the snapshot applied live follows in the capture file
+    if (replay_.enabled()) return;
+    
+    // Fetch on a REST worker; deltas keep buffering until it completes
+    restClient_.fetchSnapshotAsync(symIdx, bookMgr_->generation(symIdx), sym, SNAPSHOT_DEPTH);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::processSnapshotCompletions() {
+    snapshotResults_.clear();
+    if (restClient_.pollCompletions(snapshotResults_) == 0) return;
+    
+    for (auto& result : snapshotResults_) {
+        applySnapshotResult(result);
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::applySnapshotResult(SnapshotResult& result) {
+    const int symIdx = result.symIdx;
+    const std::string& sym = bookMgr_->getSymbol(symIdx);
+    SnapshotData& snapshot = result.data;
+    
+    // Book was reset (gap, reconnect) after the request was made
+    if (result.generation != bookMgr_->generation(symIdx) ||
+        bookMgr_->getState(symIdx) != BookState::INIT ||
+        !bookMgr_->snapshotRequested(symIdx)) {
+        spdlog::debug("{} discarding stale snapshot lastUpdateId={}", sym, snapshot.lastUpdateId);
+        return;
+    }
+    
+    // Recorded where it is applied, so replay sees it at the same point
+    if (capture_) {
+        captureSnapshot(result);
+    }
     
     if (!snapshot.success) {
         spdlog::error("Snapshot failed for {}: {}", sym, snapshot.error);
@@ -356,27 +625,42 @@ void QuoteFeedHandler::requestSnapshot(int symIdx) {
         return;
     }
     
-    // Apply snapshot
-    bookMgr_->applySnapshot(symIdx, snapshot.lastUpdateId, snapshot.bids, snapshot.asks);
+    // Decode levels with the symbol's scale, then apply snapshot
+    bool offGrid = false;
+    auto decode = [this, symIdx, &offGrid](const std::vector<DecimalLevel>& in, std::vector<Level>& out) {
+        out.clear();
+        for (const auto& lvl : in) {
+            out.emplace_back();
+            if (!bookMgr_->parseLevel(symIdx,
+                    lvl.price.data(), lvl.price.size(), lvl.qty.data(), lvl.qty.size(), out.back())) {
+                offGrid = true;
+            }
+        }
+    };
+    decode(snapshot.bids, snapshotBids_);
+    decode(snapshot.asks, snapshotAsks_);
+    if (offGrid) {
+        resyncOffGrid(symIdx, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        return;
+    }
+    bookMgr_->applySnapshot(symIdx, snapshot.lastUpdateId, snapshotBids_, snapshotAsks_);
     
     spdlog::debug("{} snapshot applied, lastUpdateId={}", sym, snapshot.lastUpdateId);
     
     // Apply buffered deltas
-    auto& buffer = bookMgr_->getDeltaBuffer(symIdx);
-    spdlog::debug("Applying {} buffered deltas for {}", buffer.size(), sym);
+    const size_t buffered = bookMgr_->bufferedDeltaCount(symIdx);
+    spdlog::debug("Applying {} buffered deltas for {}", buffered, sym);
     
-    while (!buffer.empty()) {
-        const auto& delta = buffer.front();
-        if (!bookMgr_->applyDelta(symIdx, delta.firstUpdateId, delta.finalUpdateId,
-                                  delta.bids, delta.asks, delta.eventTimeMs)) {
+    for (size_t i = 0; i < buffered; ++i) {
+        if (!bookMgr_->applyDelta(symIdx, bookMgr_->bufferedDelta(symIdx, i))) {
             spdlog::warn("{} failed during buffered delta replay", sym);
             break;
         }
-        buffer.pop_front();
     }
     
-    // Clear remaining buffer
-    buffer.clear();
+    // Clear buffer (including any deltas not replayed)
+    bookMgr_->clearBufferedDeltas(symIdx);
     
     if (bookMgr_->isValid(symIdx)) {
         spdlog::info("{} is now VALID", sym);
@@ -387,109 +671,215 @@ void QuoteFeedHandler::requestSnapshot(int symIdx) {
 // PUBLISHING
 // ============================================================================
 
-void QuoteFeedHandler::maybePublish(int symIdx, long long fhRecvTimeUtcNs) {
+template<int Depth>
+void QuoteFeedHandler<Depth>::maybePublish(int symIdx, long long fhRecvTimeUtcNs) {
+    if (conflation_.enabled && !critical_[symIdx]) {
+        // Keep only the latest state; published by flushConflated()
+        if (bookMgr_->shouldPublish(symIdx, bookMgr_->isValid(symIdx), loopNow_)
+            && !bookMgr_->markDirty(symIdx, fhRecvTimeUtcNs)) {
+            conflated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    
     ++fhSeqNo_;
-    L5Quote quote = bookMgr_->getL5(symIdx, fhRecvTimeUtcNs, fhSeqNo_);
+    Quote quote = bookMgr_->getQuote(symIdx, fhRecvTimeUtcNs, fhSeqNo_);
+    
+    if (bookMgr_->shouldPublish(symIdx, quote, loopNow_)) {
+        publishQuote(symIdx, quote);
+        bookMgr_->recordPublish(symIdx, quote, loopNow_);
+        recordStage(latency::STAGE_PUBLISH, symIdx);
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::flushConflated() {
+    if (bookMgr_->dirtyCount() == 0) return;
     
-    if (bookMgr_->shouldPublish(symIdx, quote)) {
-        publishL5(quote);
-        bookMgr_->recordPublish(symIdx, quote);
+    bookMgr_->takeDirty([this](int symIdx, long long fhRecvTimeUtcNs) {
+        // The book may have returned to its published state meanwhile
+        if (!bookMgr_->shouldPublish(symIdx, bookMgr_->isValid(symIdx), loopNow_)) return;
+        ++fhSeqNo_;
+        Quote quote = bookMgr_->getQuote(symIdx, fhRecvTimeUtcNs, fhSeqNo_);
+        publishQuote(symIdx, quote);
+        bookMgr_->recordPublish(symIdx, quote, loopNow_);
+    });
+}
+
+template<int Depth>
+bool QuoteFeedHandler<Depth>::downstreamIdle() const {
+    if (dryRun_) {
+        return true;
+    }
+    if (shardPublisher_) {
+        return shardPublisher_->queued(shardId_) == 0;
     }
+    if (shm_ && shm_->attached()) {
+        return shm_->pendingBytes() == 0;
+    }
+#ifdef SIOCOUTQ
+    // The kdb+ handle is the socket: unsent bytes in its send queue
+    int unsent = 0;
+    return tp_->connected() && ::ioctl(tp_->handle(), SIOCOUTQ, &unsent) == 0 && unsent == 0;
+#else
+    return true;
+#endif
 }
 
-void QuoteFeedHandler::publishInvalid(int symIdx, long long fhRecvTimeUtcNs) {
+template<int Depth>
+void QuoteFeedHandler<Depth>::publishInvalid(int symIdx, long long fhRecvTimeUtcNs) {
     ++fhSeqNo_;
-    L5Quote quote;
-    quote.sym = bookMgr_->getSymbol(symIdx);
+    Quote quote;
+    quote.sym = bookMgr_->getSymbol(symIdx).c_str();
     quote.isValid = false;
     quote.fhRecvTimeUtcNs = fhRecvTimeUtcNs;
     quote.fhSeqNo = fhSeqNo_;
     // All price/qty fields default to 0.0
     
-    publishL5(quote);
-    bookMgr_->recordPublish(symIdx, quote);
+    publishQuote(symIdx, quote);
+    bookMgr_->recordPublish(symIdx, quote, loopNow_);
     
     spdlog::warn("Published INVALID for {}", quote.sym);
 }
 
-void QuoteFeedHandler::publishL5(const L5Quote& quote) {
-    // Build kdb+ row matching quote_binance L5 schema
-    // FH sends 26 fields, TP adds tpRecvTimeUtcNs (27th)
-    // Schema: time, sym, bidPrice1..5, bidQty1..5, askPrice1..5, askQty1..5, 
+template<int Depth>
+std::vector<int> QuoteFeedHandler<Depth>::batchColumnTypes() {
+    std::vector<int> types{KP, KS};
+    types.insert(types.end(), 4 * Depth, KF);
+    types.insert(types.end(), {KB, KJ, KJ, KJ});
+    return types;
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::appendToBatch(ColumnBatch& batch, const Quote& quote, S sym) {
+    // Price/qty fields in schema order: bidPrice1..N, bidQty1..N, askPrice1..N, askQty1..N
+    const std::array<const std::array<double, Depth>*, 4> sides{
+        &quote.bidPrices, &quote.bidQtys, &quote.askPrices, &quote.askQtys};
+    constexpr int META_COL = 2 + 4 * Depth;
+    
+    int r = batch.beginRow();
+    batch.setTimestamp(0, r, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+    batch.setInterned(1, r, sym);
+    for (int f = 0; f < 4; ++f) {
+        for (int i = 0; i < Depth; ++i) {
+            batch.setFloat(2 + f * Depth + i, r, (*sides[f])[i]);
+        }
+    }
+    batch.setBool(META_COL, r, quote.isValid);
+    batch.setLong(META_COL + 1, r, quote.exchEventTimeMs);
+    batch.setLong(META_COL + 2, r, quote.fhRecvTimeUtcNs);
+    batch.setLong(META_COL + 3, r, quote.fhSeqNo);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::publishQuote(int symIdx, const Quote& quote) {
+    // Shard mode: hand off to the shared publisher (batches and sequences)
+    if (shardPublisher_) {
+        shardPublisher_->push(shardId_, quote);
+        lastPubTime_.store(std::chrono::system_clock::now(), std::memory_order_relaxed);
+        msgsPublished_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    // Analytics stage: imbalance/microprice/spread, send once its batch is full
+    if (analytics_) {
+        analytics_->onQuote(symIdx, quote.bidPrices, quote.bidQtys, quote.askPrices,
+                            quote.askQtys, quote.isValid, quote.fhRecvTimeUtcNs);
+        if (analytics_->batch().full()) {
+            flushAnalytics(true);
+        }
+    }
+    
+    // Batching mode: append to columnar batch, send when full
+    if (batch_) {
+        appendToBatch(*batch_, quote, interned_->sym(symIdx));
+        if (batch_->full()) {
+            flushBatch(true);
+        }
+        return;
+    }
+    
+    // Build kdb+ row matching the generated depth-N quote schema
+    // FH sends 4*Depth+6 fields, TP adds tpRecvTimeUtcNs
+    // Schema: time, sym, bidPrice1..N, bidQty1..N, askPrice1..N, askQty1..N,
     //         isValid, exchEventTimeMs, fhRecvTimeUtcNs, fhSeqNo
+    const std::array<const std::array<double, Depth>*, 4> sides{
+        &quote.bidPrices, &quote.bidQtys, &quote.askPrices, &quote.askQtys};
+    constexpr int META_COL = 2 + 4 * Depth;
     
-    K row = knk(26,
-        // time, sym
-        ktj(-KP, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS),
-        ks((S)quote.sym.c_str()),
-        // Bid prices (5)
-        kf(quote.bidPrice1),
-        kf(quote.bidPrice2),
-        kf(quote.bidPrice3),
-        kf(quote.bidPrice4),
-        kf(quote.bidPrice5),
-        // Bid quantities (5)
-        kf(quote.bidQty1),
-        kf(quote.bidQty2),
-        kf(quote.bidQty3),
-        kf(quote.bidQty4),
-        kf(quote.bidQty5),
-        // Ask prices (5)
-        kf(quote.askPrice1),
-        kf(quote.askPrice2),
-        kf(quote.askPrice3),
-        kf(quote.askPrice4),
-        kf(quote.askPrice5),
-        // Ask quantities (5)
-        kf(quote.askQty1),
-        kf(quote.askQty2),
-        kf(quote.askQty3),
-        kf(quote.askQty4),
-        kf(quote.askQty5),
-        // Metadata
-        kb(quote.isValid),
-        kj(quote.exchEventTimeMs),
-        kj(quote.fhRecvTimeUtcNs),
-        kj(quote.fhSeqNo)
-    );
+    K row = ktn(0, Quote::NUM_FIELDS);
+    kK(row)[0] = ktj(-KP, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+    kK(row)[1] = interned_->atom(symIdx);
+    for (int f = 0; f < 4; ++f) {
+        for (int i = 0; i < Depth; ++i) {
+            kK(row)[2 + f * Depth + i] = kf((*sides[f])[i]);
+        }
+    }
+    kK(row)[META_COL] = kb(quote.isValid);
+    kK(row)[META_COL + 1] = kj(quote.exchEventTimeMs);
+    kK(row)[META_COL + 2] = kj(quote.fhRecvTimeUtcNs);
+    kK(row)[META_COL + 3] = kj(quote.fhSeqNo);
     
-    K result = k(-tpHandle_, (S)".u.upd", ks((S)"quote_binance"), row, (K)0);
+    sendToTP(quoteTable_, row);
     
     // Update health: message published
-    lastPubTime_ = std::chrono::system_clock::now();
-    ++msgsPublished_;
-    
-    // Check if TP connection died
-    if (result == nullptr) {
-        spdlog::error("TP connection lost, reconnecting...");
-        connState_ = "reconnecting";
-        kclose(tpHandle_);
-        tpHandle_ = -1;
-        if (connectToTP()) {
-            // Resend to new connection
-            K row2 = knk(26,
-                ktj(-KP, quote.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS),
-                ks((S)quote.sym.c_str()),
-                kf(quote.bidPrice1), kf(quote.bidPrice2), kf(quote.bidPrice3),
-                kf(quote.bidPrice4), kf(quote.bidPrice5),
-                kf(quote.bidQty1), kf(quote.bidQty2), kf(quote.bidQty3),
-                kf(quote.bidQty4), kf(quote.bidQty5),
-                kf(quote.askPrice1), kf(quote.askPrice2), kf(quote.askPrice3),
-                kf(quote.askPrice4), kf(quote.askPrice5),
-                kf(quote.askQty1), kf(quote.askQty2), kf(quote.askQty3),
-                kf(quote.askQty4), kf(quote.askQty5),
-                kb(quote.isValid),
-                kj(quote.exchEventTimeMs),
-                kj(quote.fhRecvTimeUtcNs),
-                kj(quote.fhSeqNo)
-            );
-            k(-tpHandle_, (S)".u.upd", ks((S)"quote_binance"), row2, (K)0);
-        }
+    lastPubTime_.store(std::chrono::system_clock::now(), std::memory_order_relaxed);
+    msgsPublished_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::flushBatch(bool force) {
+    flushAnalytics(force);
+    if (!batch_ || batch_->empty()) return;
+    if (!force && !batch_->full() && !batch_->due(std::chrono::steady_clock::now())) return;
+    
+    int rows = batch_->rows();
+    K data = batch_->take();
+    
+    spdlog::debug("Quote batch: rows={}", rows);
+    
+    sendToTP(quoteTable_, data);
+    
+    // Update health: rows published
+    lastPubTime_.store(std::chrono::system_clock::now(), std::memory_order_relaxed);
+    msgsPublished_.fetch_add(rows, std::memory_order_relaxed);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::flushAnalytics(bool force) {
+    if (!analytics_) return;
+    ColumnBatch& batch = analytics_->batch();
+    if (batch.empty()) return;
+    if (!force && !batch.full() && !batch.due(std::chrono::steady_clock::now())) return;
+    
+    spdlog::debug("Analytics batch: rows={}", batch.rows());
+    sendToTP(analytics_->tableAtom(), batch.take());
+}
+
+template<int Depth>
+bool QuoteFeedHandler<Depth>::sendToTP(SymAtom& table, K data) {
+    if (dryRun_) {
+        r0(data);
+        return true;
+    }
+    
+    long long sendStartNs = latency::nowNs();
+    if (shm_ && shm_->publish(table, data)) {
+        latency_->record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+        r0(data);
+        return true;
     }
+    
+    // Queued (not blocked on) while the TP reconnects
+    const bool sent = tp_->send(table, data);
+    latency_->record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+    return sent;
 }
 
-void QuoteFeedHandler::publishHealth() {
-    if (tpHandle_ <= 0) return;
+template<int Depth>
+void QuoteFeedHandler<Depth>::publishHealth() {
+    // Shard mode: the shared publisher reports health for every shard
+    if (shardPublisher_ || !tp_->isOpen()) return;
     
     auto now = std::chrono::system_clock::now();
     
@@ -503,98 +893,396 @@ void QuoteFeedHandler::publishHealth() {
             tp.time_since_epoch()).count() - KDB_EPOCH_OFFSET_NS;
     };
     
-    // Build health row (10 fields)
-    K row = knk(10,
+    // Build health row (16 fields)
+    K row = knk(16,
         ktj(-KP, toKdbTs(now)),                    // time
         ks((S)"quote_fh"),                          // handler
         ktj(-KP, toKdbTs(startTime_)),             // startTimeUtc
         kj(uptimeSec),                              // uptimeSec
-        kj(msgsReceived_),                          // msgsReceived
-        kj(msgsPublished_),                         // msgsPublished
-        ktj(-KP, toKdbTs(lastMsgTime_)),           // lastMsgTimeUtc
-        ktj(-KP, toKdbTs(lastPubTime_)),           // lastPubTimeUtc
-        ks((S)connState_.c_str()),                  // connState
-        ki(static_cast<int>(symbolsLower_.size()))  // symbolCount
+        kj(msgsReceived()),                         // msgsReceived
+        kj(msgsPublished()),                        // msgsPublished
+        ktj(-KP, toKdbTs(lastMsgTime())),          // lastMsgTimeUtc
+        ktj(-KP, toKdbTs(lastPubTime())),          // lastPubTimeUtc
+        ks((S)connState()),                         // connState
+        ki(static_cast<int>(symbolsLower_.size())), // symbolCount
+        kj(0LL),                                    // queueDepth (no pipeline)
+        kj(0LL),                                    // queueOverflows
+        kj(conflated()),                            // conflated
+        kj(tp_->backlog()),                          // tpBacklog
+        kj(tp_->spilled()),                          // tpSpilled
+        kj(tp_->dropped())                           // tpDropped
     );
     
-    // Publish to TP (fire and forget)
-    k(-tpHandle_, (S)".u.upd", ks((S)"health_feed_handler"), row, (K)0);
+    // Publish to TP (queued behind any backlog, like data)
+    tp_->send(healthTable_, row);
+    
+    // Stage latency histograms for the interval since the last health row
+    K hist = latency_->takeInterval("quote_fh", toKdbTs(now));
+    if (hist) {
+        tp_->send(histTable_, hist);
+    }
     
-    spdlog::debug("Health published: uptime={}s msgs={}/{} state={}", 
-        uptimeSec, msgsReceived_, msgsPublished_, connState_);
+    spdlog::debug("Health published: uptime={}s msgs={}/{} state={} tpBacklog={}", 
+        uptimeSec, msgsReceived(), msgsPublished(), connState(), tp_->backlog());
 }
 
-void QuoteFeedHandler::checkPublishTimeouts(long long fhRecvTimeUtcNs) {
-    // Get symbols that need timeout publish
-    std::vector<int> needsPublish = bookMgr_->getTimeoutPublishNeeded();
+template<int Depth>
+void QuoteFeedHandler<Depth>::checkPublishTimeouts(long long fhRecvTimeUtcNs) {
+    // Due heartbeats only (no scan over all symbols)
+    bookMgr_->getTimeoutPublishNeeded(timeoutSymbols_, loopNow_);
     
-    for (int symIdx : needsPublish) {
+    for (int symIdx : timeoutSymbols_) {
         ++fhSeqNo_;
-        L5Quote quote = bookMgr_->getL5(symIdx, fhRecvTimeUtcNs, fhSeqNo_);
-        publishL5(quote);
-        bookMgr_->recordPublish(symIdx, quote);
+        Quote quote = bookMgr_->getQuote(symIdx, fhRecvTimeUtcNs, fhSeqNo_);
+        publishQuote(symIdx, quote);
+        bookMgr_->recordPublish(symIdx, quote, loopNow_);
     }
 }
 
 // ============================================================================
-// CONFIGURATION AND MAIN
+// CHECKPOINT (warm start)
 // ============================================================================
 
-#include "config.hpp"
-#include "logger.hpp"
+template<int Depth>
+std::string QuoteFeedHandler<Depth>::checkpointPath() const {
+    std::string path = checkpointCfg_.path;
+    if (shardPublisher_) {
+        path += ".s" + std::to_string(shardId_);
+    }
+    return path;
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::restoreCheckpoint() {
+    if (!checkpointCfg_.enabled) return;
+    
+    const std::string path = checkpointPath();
+    checkpoint::Reader reader;
+    if (!reader.open(path)) {
+        spdlog::info("No book checkpoint at {}, cold start", path);
+        return;
+    }
+    using BookImage = typename QuoteBook::BookImage;
+    if (!reader.matches(Depth, QuotePriceRep::NAME, sizeof(BookImage))) {
+        spdlog::warn("Checkpoint {} has another book depth or price representation, cold start", path);
+        return;
+    }
+    const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const long long ageMs = (nowNs - reader.savedAtUtcNs()) / 1000000;
+    if (ageMs > checkpointCfg_.maxAgeMs) {
+        spdlog::info("Checkpoint {} is {}ms old (max {}ms), cold start", path, ageMs, checkpointCfg_.maxAgeMs);
+        return;
+    }
+    
+    std::string sym;
+    const uint8_t* data = nullptr;
+    BookImage img;
+    int restored = 0;
+    for (int i = 0; i < reader.numRecords(); ++i) {
+        if (!reader.record(i, sym, data)) continue;
+        const int symIdx = bookMgr_->getSymbolIndex(sym);
+        if (symIdx < 0) continue;
+        std::memcpy(&img, data, sizeof(img));
+        if (!bookMgr_->restoreBook(symIdx, img)) {
+            spdlog::info("{} checkpoint has other tick/lot sizes, not restored", sym);
+            continue;
+        }
+        warm_[symIdx] = 1;
+        ++warmPending_;
+        ++restored;
+        if (capture_) {
+            captureCheckpoint(symIdx);
+        }
+    }
+    keepBooksOnConnect_ = restored > 0;
+    spdlog::info("Restored {} of {} books from checkpoint {} ({}ms old)",
+        restored, bookMgr_->numSymbols(), path, ageMs);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::openCheckpoint() {
+    if (!checkpointCfg_.enabled) return;
+    
+    const std::string path = checkpointPath();
+    checkpoint_ = std::make_unique<checkpoint::Writer>();
+    if (checkpoint_->open(path, Depth, QuotePriceRep::NAME, sizeof(typename QuoteBook::BookImage),
+                          symbolsUpper_)) {
+        spdlog::info("Saving book checkpoint to {} every {}ms{}", path, checkpointCfg_.intervalMs,
+            checkpoint_->reused() ? " (last save kept until the next one)" : "");
+    } else {
+        spdlog::error("Cannot open checkpoint file {}: {}", path, std::strerror(errno));
+        checkpoint_.reset();
+    }
+}
 
-static const std::string DEFAULT_CONFIG_PATH = "config/quote_feed_handler.json";
+template<int Depth>
+void QuoteFeedHandler<Depth>::saveCheckpoint() {
+    if (!checkpoint_) return;
+    
+    const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    checkpoint_->save(nowNs, [this](int symIdx, uint8_t* image) {
+        typename QuoteBook::BookImage img;
+        if (!bookMgr_->exportBook(symIdx, img)) return false;
+        std::memcpy(image, &img, sizeof(img));
+        return true;
+    });
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::resolveWarm(int symIdx, bool hit) {
+    warm_[symIdx] = 0;
+    ++(hit ? warmHits_ : warmMisses_);
+    if (--warmPending_ == 0) {
+        spdlog::info("Warm start done: {} books valid from checkpoint, {} resynced via REST",
+            warmHits_, warmMisses_);
+    }
+}
 
-// Global pointer for signal handler access
-static QuoteFeedHandler* g_handler = nullptr;
+// ============================================================================
+// CAPTURE / REPLAY
+// ============================================================================
 
-static void signalHandler(int signum) {
-    const char* sigName = (signum == SIGINT) ? "SIGINT" : 
-                          (signum == SIGTERM) ? "SIGTERM" : "UNKNOWN";
-    spdlog::info("Received {} ({})", sigName, signum);
+template<int Depth>
+void QuoteFeedHandler<Depth>::openCapture() {
+    if (!captureCfg_.enabled) return;
     
-    if (g_handler) {
-        g_handler->stop();
+    std::string path = captureCfg_.path;
+    if (shardPublisher_) {
+        path += ".s" + std::to_string(shardId_);
+    }
+    capture_ = std::make_unique<capture::Writer>();
+    if (capture_->open(path, static_cast<size_t>(captureCfg_.chunkMb) << 20)) {
+        spdlog::info("Capturing raw input to {}", path);
+    } else {
+        spdlog::error("Cannot open capture file {}: {}", path, std::strerror(errno));
+        capture_.reset();
     }
 }
 
-int main(int argc, char* argv[]) {
-    std::cout << "=== Binance L5 Quote Feed Handler ===" << std::endl;
+template<int Depth>
+void QuoteFeedHandler<Depth>::captureSnapshot(const SnapshotResult& result) {
+    const SnapshotData& snapshot = result.data;
+    captureText_ = bookMgr_->getSymbol(result.symIdx);
+    captureText_ += ' ' + std::to_string(snapshot.lastUpdateId);
+    captureText_ += snapshot.success ? " 1 " : " 0 ";
+    captureText_ += std::to_string(snapshot.bids.size()) + ' ' + std::to_string(snapshot.asks.size()) + '\n';
+    for (const auto* side : {&snapshot.bids, &snapshot.asks}) {
+        for (const auto& lvl : *side) {
+            captureText_ += lvl.price;
+            captureText_ += ' ';
+            captureText_ += lvl.qty;
+            captureText_ += '\n';
+        }
+    }
+    capture_->append(capture::REC_SNAPSHOT, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count(),
+        captureText_.data(), captureText_.size());
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::captureCheckpoint(int symIdx) {
+    typename QuoteBook::BookImage img;
+    bookMgr_->exportBook(symIdx, img);
+    
+    // Same text as a snapshot, so replay decodes it with its own representation
+    const InstrumentScale& sc = bookMgr_->getScale(symIdx);
+    auto levels = [](const auto& prices, const auto& qtys) {
+        int n = 0;
+        while (n < Depth && (prices[n] != 0 || qtys[n] != 0)) ++n;
+        return n;
+    };
+    const int numBids = levels(img.bidPrices, img.bidQtys);
+    const int numAsks = levels(img.askPrices, img.askQtys);
+    captureText_ = fmt::format("{} {} {} {} {}\n", bookMgr_->getSymbol(symIdx),
+        img.lastUpdateId, img.exchEventTimeMs, numBids, numAsks);
+    auto appendSide = [this, &sc](const auto& prices, const auto& qtys, int n) {
+        for (int i = 0; i < n; ++i) {
+            fmt::format_to(std::back_inserter(captureText_), "{:.8f} {:.8f}\n",
+                QuotePriceRep::toPrice(prices[i], sc), QuotePriceRep::toQty(qtys[i], sc));
+        }
+    };
+    appendSide(img.bidPrices, img.bidQtys, numBids);
+    appendSide(img.askPrices, img.askQtys, numAsks);
+    capture_->append(capture::REC_CHECKPOINT, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count(),
+        captureText_.data(), captureText_.size());
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::applyCapturedScale(const capture::Reader::Record& rec) {
+    std::istringstream in(std::string(reinterpret_cast<const char*>(rec.data), rec.length));
+    std::string sym, tickSize, stepSize;
+    if (!(in >> sym >> tickSize >> stepSize)) return;
     
-    // Determine config path (from argument or default)
-    std::string configPath = DEFAULT_CONFIG_PATH;
-    if (argc > 1) {
-        configPath = argv[1];
+    int symIdx = bookMgr_->getSymbolIndex(sym);
+    if (symIdx < 0) return;
+    bookMgr_->setScale(symIdx, InstrumentScale::fromStrings(tickSize, stepSize));
+    spdlog::info("{} tickSize={} stepSize={} (from capture)", sym, tickSize, stepSize);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::applyCapturedSnapshot(const capture::Reader::Record& rec) {
+    std::istringstream in(std::string(reinterpret_cast<const char*>(rec.data), rec.length));
+    std::string sym;
+    int ok = 0;
+    size_t numBids = 0, numAsks = 0;
+    SnapshotResult result;
+    if (!(in >> sym >> result.data.lastUpdateId >> ok >> numBids >> numAsks)) {
+        spdlog::warn("Malformed snapshot record in capture, skipped");
+        return;
     }
     
-    // Load configuration
-    FeedHandlerConfig config;
-    if (!config.load(configPath)) {
-        std::cerr << "Failed to load config, exiting\n";
-        return 1;
+    result.symIdx = bookMgr_->getSymbolIndex(sym);
+    if (result.symIdx < 0) return;
+    result.generation = bookMgr_->generation(result.symIdx);
+    result.data.success = ok != 0;
+    if (!result.data.success) {
+        result.data.error = "failed when captured";
     }
+    result.data.bids.resize(numBids);
+    for (auto& lvl : result.data.bids) in >> lvl.price >> lvl.qty;
+    result.data.asks.resize(numAsks);
+    for (auto& lvl : result.data.asks) in >> lvl.price >> lvl.qty;
     
-    if (config.symbols.empty()) {
-        std::cerr << "No symbols configured, exiting\n";
-        return 1;
+    applySnapshotResult(result);
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::applyCapturedCheckpoint(const capture::Reader::Record& rec) {
+    std::istringstream in(std::string(reinterpret_cast<const char*>(rec.data), rec.length));
+    std::string sym;
+    typename QuoteBook::BookImage img;
+    int numBids = 0, numAsks = 0;
+    if (!(in >> sym >> img.lastUpdateId >> img.exchEventTimeMs >> numBids >> numAsks)) {
+        spdlog::warn("Malformed checkpoint record in capture, skipped");
+        return;
     }
     
-    // Initialize logger
-    initLogger("Quote FH", config.logLevel, config.logFile);
+    const int symIdx = bookMgr_->getSymbolIndex(sym);
+    if (symIdx < 0) return;
+    img.scale = bookMgr_->getScale(symIdx);
+    bool offGrid = false;
+    auto readSide = [&](auto& prices, auto& qtys, int n) {
+        std::string price, qty;
+        for (int i = 0; i < n && in >> price >> qty; ++i) {
+            if (i >= Depth) continue;
+            Level lvl;
+            if (!bookMgr_->parseLevel(symIdx, price.data(), price.size(), qty.data(), qty.size(), lvl)) {
+                offGrid = true;
+            }
+            prices[i] = lvl.price;
+            qtys[i] = lvl.qty;
+        }
+    };
+    readSide(img.bidPrices, img.bidQtys, numBids);
+    readSide(img.askPrices, img.askQtys, numAsks);
+    if (offGrid) {
+        spdlog::warn("{} checkpoint record in capture is off its tick/lot grid, skipped", sym);
+        return;
+    }
     
-    // Install signal handlers
-    std::signal(SIGINT, signalHandler);
-    std::signal(SIGTERM, signalHandler);
-    spdlog::info("Signal handlers installed (Ctrl+C to shutdown)");
+    if (bookMgr_->restoreBook(symIdx, img)) {
+        warm_[symIdx] = 1;
+        ++warmPending_;
+        spdlog::info("{} restored from checkpoint, lastUpdateId={} (from capture)", sym, img.lastUpdateId);
+    }
+}
+
+template<int Depth>
+void QuoteFeedHandler<Depth>::runReplay() {
+    capture::Reader reader;
+    if (!reader.open(replay_.path)) {
+        spdlog::error("Cannot open capture file {}", replay_.path);
+        return;
+    }
+    if (replay_.speed > 0) {
+        spdlog::info("Replaying {} ({} bytes) at {}x", replay_.path, reader.bytes(), replay_.speed);
+    } else {
+        spdlog::info("Replaying {} ({} bytes) at max speed", replay_.path, reader.bytes());
+    }
+    spdlog::info("Book price representation: {}", QuotePriceRep::NAME);
+    connState_ = "replay";
     
-    // Create and run handler
-    QuoteFeedHandler handler(config.symbols, config.tpHost, config.tpPort);
-    g_handler = &handler;
+    capture::Pacer pacer(replay_.speed);
+    capture::Reader::Record rec;
+    std::vector<char> frame;    // Parsed in place, so copied out of the read-only mapping
+    long long frames = 0;
+    long long frameBytes = 0;
+    const long long conflateNs = std::max<long long>(conflation_.intervalUs, MIN_TICK_US) * 1000;
+    long long nextConflateNs = 0;
+    const auto start = std::chrono::steady_clock::now();
     
-    handler.run();
+    while (running_ && reader.next(rec)) {
+        pacer.wait(rec.fhRecvTimeUtcNs);
+        
+        // The recorded clock drives publish decisions and heartbeats, so
+        // the output does not depend on the replay speed
+        loopNow_ = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(rec.fhRecvTimeUtcNs)));
+        
+        switch (rec.type) {
+            case capture::REC_SCALE:
+                applyCapturedScale(rec);
+                break;
+            case capture::REC_SNAPSHOT:
+                applyCapturedSnapshot(rec);
+                break;
+            case capture::REC_CHECKPOINT:
+                applyCapturedCheckpoint(rec);
+                break;
+            case capture::REC_RESET:
+                bookMgr_->resetAll();
+                std::fill(warm_.begin(), warm_.end(), 0);
+                warmPending_ = 0;
+                break;
+            case capture::REC_FRAME:
+                stageMarkNs_ = latency::nowNs();
+                lastMsgTime_.store(std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::nanoseconds(rec.fhRecvTimeUtcNs))), std::memory_order_relaxed);
+                msgsReceived_.fetch_add(1, std::memory_order_relaxed);
+                
+                frame.assign(rec.data, rec.data + rec.length);
+                frame.push_back('\0');
+                processMessage(frame.data(), rec.fhRecvTimeUtcNs);
+                ++frames;
+                frameBytes += static_cast<long long>(rec.length);
+                break;
+        }
+        
+        // As the live loop, with timers checked per record on the recorded clock
+        checkPublishTimeouts(rec.fhRecvTimeUtcNs);
+        if (conflation_.enabled) {
+            if (rec.fhRecvTimeUtcNs >= nextConflateNs) {
+                flushConflated();
+                nextConflateNs = rec.fhRecvTimeUtcNs + conflateNs;
+            } else if (conflation_.flushOnIdle && bookMgr_->dirtyCount() > 0 && downstreamIdle()) {
+                flushConflated();
+            }
+        }
+        flushBatch();
+    }
     
-    g_handler = nullptr;
-    spdlog::info("Exiting");
-    shutdownLogger();
-    return 0;
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Replay done: {} frames, {} quotes in {:.3f}s ({:.0f} msgs/s, {:.1f} MB/s)",
+        frames, fhSeqNo_, sec, sec > 0 ? frames / sec : 0.0, sec > 0 ? frameBytes / sec / 1e6 : 0.0);
+    const std::pair<const char*, latency::Stage> stages[] = {
+        {"parse", latency::STAGE_PARSE}, {"apply", latency::STAGE_APPLY}, {"publish", latency::STAGE_PUBLISH}};
+    for (const auto& st : stages) {
+        const LatencyStats::Summary sm = latency_->summary(st.second);
+        spdlog::info("Replay {} ns: p50={} p99={} p99.9={} max={} (n={})",
+            st.first, sm.p50, sm.p99, sm.p999, sm.max, sm.cnt);
+    }
 }
+
+// ============================================================================
+// EXPLICIT INSTANTIATIONS (supported book depths)
+// ============================================================================
+
+template class QuoteFeedHandler<1>;
+template class QuoteFeedHandler<5>;
+template class QuoteFeedHandler<10>;
+template class QuoteFeedHandler<20>;
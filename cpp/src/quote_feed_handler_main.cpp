@@ -0,0 +1,186 @@
+/**
+ * @file quote_feed_handler_main.cpp
+ * @brief Entry point of the quote_feed_handler process
+ * 
+ * Picks the book depth and shard count from the config. The handler
+ * itself is in quote_feed_handler.cpp (instantiated for depths 1, 5, 10
+ * and 20), which the unified feed_handler links as well.
+ */
+
+#include "quote_feed_handler.hpp"
+#include "quote_shard_publisher.hpp"
+#include "config.hpp"
+#include "cpu_affinity.hpp"
+#include "logger.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <iostream>
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <thread>
+
+// ============================================================================
+// CONFIGURATION AND MAIN
+// ============================================================================
+
+static const std::string DEFAULT_CONFIG_PATH = "config/quote_feed_handler.json";
+
+// Stop callback for signal handler access (handler type depends on depth)
+static std::function<void()> g_stopHandler;
+
+static void signalHandler(int signum) {
+    const char* sigName = (signum == SIGINT) ? "SIGINT" : 
+                          (signum == SIGTERM) ? "SIGTERM" : "UNKNOWN";
+    spdlog::info("Received {} ({})", sigName, signum);
+    
+    if (g_stopHandler) {
+        g_stopHandler();
+    }
+}
+
+/**
+ * @brief Create and run a handler for one book depth
+ */
+template<int Depth>
+static void runHandler(const FeedHandlerConfig& config, const ReplayOptions& replay) {
+    QuoteFeedHandler<Depth> handler(config.symbols, config.tpHost, config.tpPort,
+                                    config.batching, config.rest, config.quoteTable,
+                                    nullptr, config.analytics, config.shm, config.conflation,
+                                    config.capture, config.outbound, config.checkpoint);
+    handler.setReplay(replay);
+    g_stopHandler = [&handler] { handler.stop(); };
+    
+    handler.run();
+    
+    g_stopHandler = nullptr;
+}
+
+/**
+ * @brief Create and run K shard handlers and their shared publisher
+ * 
+ * Symbols are assigned round-robin. REST workers are divided between
+ * shards and all shards share one request weight budget (same IP).
+ */
+template<int Depth>
+static void runSharded(const FeedHandlerConfig& config, int numShards) {
+    std::vector<std::vector<std::string>> shardSymbols(numShards);
+    for (size_t i = 0; i < config.symbols.size(); ++i) {
+        shardSymbols[i % numShards].push_back(config.symbols[i]);
+    }
+    
+    RestConfig shardRest = config.rest;
+    if (shardRest.workers > 0) {
+        shardRest.workers = std::max(1, shardRest.workers / numShards);
+    }
+    auto limiter = std::make_shared<WeightLimiter>(config.rest.maxWeightPerMinute);
+    
+    QuoteShardPublisher<Depth> publisher(config.tpHost, config.tpPort, config.quoteTable,
+                                         config.batching, config.sharding, numShards,
+                                         config.analytics, config.symbols, config.shm,
+                                         config.outbound);
+    std::vector<std::unique_ptr<QuoteFeedHandler<Depth>>> handlers;
+    for (int i = 0; i < numShards; ++i) {
+        handlers.push_back(std::make_unique<QuoteFeedHandler<Depth>>(
+            shardSymbols[i], config.tpHost, config.tpPort, config.batching,
+            shardRest, config.quoteTable, limiter, AnalyticsConfig(), ShmConfig(),
+            config.conflation, config.capture, OutboundConfig(), config.checkpoint));
+        publisher.attach(i, *handlers[i]);
+    }
+    
+    g_stopHandler = [&handlers, &publisher] {
+        for (auto& h : handlers) h->stop();
+        publisher.stop();
+    };
+    
+    spdlog::info("Shard mode: {} symbols across {} shards", config.symbols.size(), numShards);
+    
+    if (publisher.start()) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numShards; ++i) {
+            const int cpu = i < static_cast<int>(config.sharding.cpus.size()) ? config.sharding.cpus[i] : -1;
+            threads.emplace_back([&handlers, i, cpu] {
+                if (!pinCurrentThread(cpu)) {
+                    spdlog::warn("Failed to pin shard {} to CPU {}", i, cpu);
+                }
+                handlers[i]->run();
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    } else {
+        spdlog::warn("Shutdown before TP connection established");
+    }
+    
+    // Shards have exited: drain what they queued, then stop publishing
+    publisher.finish();
+    
+    g_stopHandler = nullptr;
+}
+
+/**
+ * @brief Run unsharded or sharded for one book depth (replay: always unsharded)
+ */
+template<int Depth>
+static void runForDepth(const FeedHandlerConfig& config, const ReplayOptions& replay) {
+    // Enough shards that no connection exceeds the per-connection stream limit
+    const int numSymbols = static_cast<int>(config.symbols.size());
+    const int perConn = QuoteFeedHandler<Depth>::MAX_STREAMS_PER_CONNECTION;
+    int numShards = std::max(config.sharding.shards, (numSymbols + perConn - 1) / perConn);
+    numShards = std::min(numShards, numSymbols);
+    
+    if (numShards > 1 && !replay.enabled()) {
+        runSharded<Depth>(config, numShards);
+    } else {
+        runHandler<Depth>(config, replay);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "=== Binance Quote Feed Handler ===" << std::endl;
+    
+    // Config path (first plain argument or default) and replay options
+    std::string configPath = DEFAULT_CONFIG_PATH;
+    ReplayOptions replay;
+    if (!ReplayOptions::parse(argc, argv, configPath, replay)) {
+        return 1;
+    }
+    
+    // Load configuration
+    FeedHandlerConfig config;
+    if (!config.load(configPath)) {
+        std::cerr << "Failed to load config, exiting\n";
+        return 1;
+    }
+    
+    if (config.symbols.empty()) {
+        std::cerr << "No symbols configured, exiting\n";
+        return 1;
+    }
+    
+    // Initialize logger
+    initLogger("Quote FH", config.logLevel, config.logFile);
+    
+    // Install signal handlers
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    spdlog::info("Signal handlers installed (Ctrl+C to shutdown)");
+    
+    // Create and run handler for the configured depth
+    switch (config.bookDepth) {
+        case 1:  runForDepth<1>(config, replay); break;
+        case 5:  runForDepth<5>(config, replay); break;
+        case 10: runForDepth<10>(config, replay); break;
+        case 20: runForDepth<20>(config, replay); break;
+        default:
+            spdlog::error("Unsupported book depth {} (expected 1, 5, 10 or 20)", config.bookDepth);
+            shutdownLogger();
+            return 1;
+    }
+    
+    spdlog::info("Exiting");
+    shutdownLogger();
+    return 0;
+}
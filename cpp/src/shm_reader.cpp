@@ -0,0 +1,179 @@
+/**
+ * @file shm_reader.cpp
+ * @brief kdb+ extension: TP side of the shared-memory FH transport
+ *
+ * Built as libfh_shm.so and loaded by tp.q with 2:. Each ring is created
+ * under the given path (ShmRing::create) and its wake FIFO registered
+ * with the q main loop via sd1, so the TP drains on the loop's own
+ * select() - no timer, no extra thread. When woken, the callback drains
+ * messages until the ring is empty, then re-arms (prepareWait) and
+ * returns.
+ *
+ * Each message is a serialised (`.u.upd; table; data) from ShmPublisher;
+ * it is deserialised (d9) and the function applied in the main thread,
+ * exactly as a TCP .z.ps message would be (.z.w is 0).
+ *
+ * q API (see tp.q):
+ *   .tp.shm.open  :`:build/libfh_shm 2:(`fhshm_open;2)   / [path; capacity] -> ring id
+ *   .tp.shm.stats :`:build/libfh_shm 2:(`fhshm_stats;1)  / [id] -> dict
+ *   .tp.shm.close :`:build/libfh_shm 2:(`fhshm_close;1)  / [id]
+ *
+ * Build: cmake -DFH_BUILD_SHM_EXTENSION=ON ... (linked against q, not c.o)
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shm_ring.hpp"
+
+extern "C" {
+#include "k.h"
+}
+
+namespace {
+
+/// Messages applied per callback before yielding to other q handles
+constexpr size_t MAX_DRAIN_PER_WAKE = 4096;
+
+struct Reader {
+    std::string path;
+    ShmRing ring;
+    long long messages = 0;
+    long long errors = 0;
+    long long wakes = 0;
+};
+
+std::vector<std::unique_ptr<Reader>> g_readers;
+
+/// Apply one (`fn; table; data) message
+void apply(Reader& r, const uint8_t* bytes, size_t len) {
+    K buf = ktn(KG, static_cast<J>(len));
+    std::memcpy(kG(buf), bytes, len);
+    K msg = d9(buf);
+    r0(buf);
+    ++r.messages;
+
+    if (!msg || msg->t == -128 || msg->t != 0 || msg->n != 3 || kK(msg)[0]->t != -KS) {
+        if (++r.errors == 1 || (r.errors & (r.errors - 1)) == 0) {
+            std::fprintf(stderr, "shm %s: malformed message (%lld so far)\n", r.path.c_str(), r.errors);
+        }
+        if (msg) r0(msg);
+        return;
+    }
+
+    K res = k(0, kK(msg)[0]->s, r1(kK(msg)[1]), r1(kK(msg)[2]), (K)0);
+    if (res && res->t == -128) {
+        if (++r.errors == 1 || (r.errors & (r.errors - 1)) == 0) {
+            std::fprintf(stderr, "shm %s: %s error: %s (%lld so far)\n",
+                         r.path.c_str(), kK(msg)[0]->s, res->s, r.errors);
+        }
+    }
+    if (res) r0(res);
+    r0(msg);
+}
+
+/// sd1 callback: the ring's wake FIFO is readable
+K onWake(I fd) {
+    for (auto& r : g_readers) {
+        if (!r || r->ring.wakeFd() != fd) continue;
+        ++r->wakes;
+        r->ring.clearWake();
+
+        size_t total = 0;
+        auto fn = [&r](const uint8_t* bytes, size_t len) { apply(*r, bytes, len); };
+        while (total < MAX_DRAIN_PER_WAKE) {
+            const size_t n = r->ring.drain(fn, MAX_DRAIN_PER_WAKE - total);
+            total += n;
+            if (n == 0 && r->ring.prepareWait()) {
+                return (K)0;
+            }
+        }
+        // Budget used up: wake ourselves so other handles get a turn first
+        const char b = 1;
+        if (::write(fd, &b, 1) < 0) {}
+        return (K)0;
+    }
+    return (K)0;
+}
+
+Reader* readerAt(K id) {
+    if (id->t != -KI && id->t != -KJ) return nullptr;
+    const long long i = id->t == -KI ? id->i : id->j;
+    if (i < 0 || i >= static_cast<long long>(g_readers.size())) return nullptr;
+    return g_readers[i].get();
+}
+
+}  // namespace
+
+extern "C" {
+
+/**
+ * @brief Create (or reuse) a ring and start draining it from the main loop
+ * @param path Ring file (symbol or string, e.g. "/dev/shm/trade_fh.ring")
+ * @param capacity Data bytes (long; rounded up to a power of two)
+ * @return Ring id (long)
+ */
+K fhshm_open(K path, K capacity) {
+    std::string p;
+    if (path->t == -KS) p = path->s;
+    else if (path->t == KC) p.assign(reinterpret_cast<const char*>(kC(path)), path->n);
+    else return krr((S)"type");
+    if (!p.empty() && p[0] == ':') p.erase(0, 1);
+    if (capacity->t != -KJ && capacity->t != -KI) return krr((S)"type");
+    const long long cap = capacity->t == -KJ ? capacity->j : capacity->i;
+    if (cap <= 0) return krr((S)"domain");
+
+    auto r = std::make_unique<Reader>();
+    r->path = p;
+    if (!r->ring.create(p, static_cast<size_t>(cap))) {
+        return orr((S)"shm open");
+    }
+    const int fd = r->ring.wakeFd();
+    g_readers.push_back(std::move(r));
+    sd1(fd, onWake);
+
+    // Messages left from before a TP restart: drain on the first loop pass
+    const char b = 1;
+    if (::write(fd, &b, 1) < 0) {}
+    return kj(static_cast<J>(g_readers.size() - 1));
+}
+
+/// Ring statistics: path, capacity, used bytes, messages, errors, wakes
+K fhshm_stats(K id) {
+    Reader* r = readerAt(id);
+    if (!r) return krr((S)"id");
+    K keys = ktn(KS, 6);
+    kS(keys)[0] = ss((S)"path");
+    kS(keys)[1] = ss((S)"capacity");
+    kS(keys)[2] = ss((S)"used");
+    kS(keys)[3] = ss((S)"messages");
+    kS(keys)[4] = ss((S)"errors");
+    kS(keys)[5] = ss((S)"wakes");
+    K vals = knk(6,
+        ks((S)r->path.c_str()),
+        kj(static_cast<J>(r->ring.capacity())),
+        kj(static_cast<J>(r->ring.used())),
+        kj(r->messages),
+        kj(r->errors),
+        kj(r->wakes));
+    return xD(keys, vals);
+}
+
+/// Stop draining a ring (the file is kept, so writers keep buffering)
+K fhshm_close(K id) {
+    Reader* r = readerAt(id);
+    if (!r) return krr((S)"id");
+    const long long i = id->t == -KI ? id->i : id->j;
+    sd0x(r->ring.wakeFd(), 0);
+    g_readers[i].reset();
+    K nil = ka(101);
+    nil->g = 0;
+    return nil;
+}
+
+}  // extern "C"
@@ -4,33 +4,83 @@
  */
 
 #include "trade_feed_handler.hpp"
+#include "cpu_affinity.hpp"
+#include "decimal_parser.hpp"
 
-#include <rapidjson/document.h>
 #include <spdlog/spdlog.h>
 
-#include <iostream>
 #include <chrono>
 #include <thread>
-#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <functional>
 
 // ============================================================================
 // CONSTRUCTION / DESTRUCTION
 // ============================================================================
 
+/// Config symbols (lowercase stream names) as they appear in trade messages
+static std::vector<std::string> upperSymbols(const std::vector<std::string>& symbols) {
+    std::vector<std::string> upper;
+    for (std::string u : symbols) {
+        std::transform(u.begin(), u.end(), u.begin(), ::toupper);
+        upper.push_back(u);
+    }
+    return upper;
+}
+
 TradeFeedHandler::TradeFeedHandler(const std::vector<std::string>& symbols,
                                    const std::string& tpHost,
-                                   int tpPort)
+                                   int tpPort,
+                                   const PipelineConfig& pipeline,
+                                   const BatchConfig& batching,
+                                   const AnalyticsConfig& analytics,
+                                   const ShmConfig& shm,
+                                   const CaptureConfig& capture,
+                                   const OutboundConfig& outbound)
     : symbols_(symbols)
+    , pipeline_(pipeline)
+    , batching_(batching)
+    , captureCfg_(capture)
+    , symbolTable_(upperSymbols(symbols))
+    , lastTradeIds_(symbols.size(), -1)
+    , interned_(symbolTable_.names())
     , tpHost_(tpHost)
     , tpPort_(tpPort)
+    , outboundCfg_(outbound)
     , startTime_(std::chrono::system_clock::now())
 {
+    const std::vector<std::string>& upper = symbolTable_.names();
+    latency_ = std::make_unique<LatencyStats>(upper);
+    
+    if (pipeline_.enabled) {
+        queue_ = std::make_unique<SpscRing<TradeRecord>>(
+            static_cast<size_t>(std::max(pipeline_.queueCapacity, 2)));
+    }
+    
+    if (batching_.enabled) {
+        // trade_binance columns as sent by the FH (TP appends tpRecvTimeUtcNs)
+        batch_ = std::make_unique<ColumnBatch>("trade_binance",
+            std::vector<int>{KP, KS, KJ, KF, KF, KB, KJ, KJ, KJ, KJ, KJ, KJ},
+            batching_.maxRows, batching_.maxDelayUs);
+        batch_->setSendTimeColumn(10);  // fhSendUs
+    }
+    
+    if (analytics.enabled) {
+        analytics_ = std::make_unique<AnalyticsEngine>(upper, analytics, batching_);
+    }
+    
+    if (shm.enabled) {
+        shm_ = std::make_unique<ShmPublisher>(shm);
+    }
 }
 
 TradeFeedHandler::~TradeFeedHandler() {
-    if (tpHandle_ > 0) {
-        kclose(tpHandle_);
-        spdlog::debug("TP connection closed in destructor");
+    if (publisherThread_.joinable()) {
+        readerDone_ = true;
+        publisherThread_.join();
     }
 }
 
@@ -42,35 +92,62 @@ void TradeFeedHandler::run() {
     spdlog::info("Starting...");
     spdlog::info("Symbols: {}", fmt::join(symbols_, " "));
     
-    // Connect to tickerplant (retries until success or shutdown)
-    if (!connectToTP()) {
+    // Own TP connection (attached handlers use the worker's instead)
+    ownTp_ = std::make_unique<TpOutbound>(tpHost_, tpPort_, outboundCfg_, running_);
+    tp_ = ownTp_.get();
+    
+    // Replay without TP: k objects are still built, so set up the k memory
+    // manager that khpu() would otherwise initialise
+    if (replay_.enabled() && !replay_.useTp) {
+        dryRun_ = true;
+        khp((S)"", -1);
+        spdlog::info("Replay without TP: updates are built and dropped");
+    } else if (!tp_->connect()) {
+        // Connect to tickerplant (retries until success or shutdown)
         spdlog::warn("Shutdown before TP connection established");
         return;
     }
     
-    // Main loop with reconnection
-    while (running_) {
-        try {
-            runWebSocketLoop();
-        } catch (const std::exception& e) {
-            if (!running_) {
-                spdlog::info("Connection closed during shutdown");
-            } else {
-                spdlog::error("Binance error: {}", e.what());
-                spdlog::info("Will reconnect...");
-                if (!sleepWithBackoff(binanceReconnectAttempt_++)) {
-                    break;  // Shutdown requested during backoff
-                }
-            }
+    // Capture live input only (never overwrite a file being replayed)
+    if (!replay_.enabled()) {
+        openCapture();
+    }
+    
+    // Pipeline mode: publisher thread owns the TP handle from here on
+    if (pipeline_.enabled) {
+        if (!pinCurrentThread(pipeline_.readerCpu)) {
+            spdlog::warn("Failed to pin reader thread to CPU {}", pipeline_.readerCpu);
         }
+        spdlog::info("Pipeline mode: queue capacity {} (reader cpu {}, publisher cpu {})",
+            queue_->capacity(), pipeline_.readerCpu, pipeline_.publisherCpu);
+        publisherThread_ = std::thread(&TradeFeedHandler::runPublisherLoop, this);
+    }
+    
+    if (replay_.enabled()) {
+        // Replay: one pass over the file
+        runReplay();
+    } else {
+        // Live: read Binance, reconnecting with backoff, until stopped
+        BinanceStream stream{running_, connState_};
+        registerOn(stream);
+        stream.run();
     }
     
     // Cleanup
     spdlog::info("Cleaning up...");
-    if (tpHandle_ > 0) {
-        kclose(tpHandle_);
-        tpHandle_ = -1;
-        spdlog::info("TP connection closed");
+    if (publisherThread_.joinable()) {
+        readerDone_ = true;
+        publisherThread_.join();
+        spdlog::info("Publisher thread stopped (overflows={})", queueOverflows_.load());
+    } else if (tpReady()) {
+        flushBatch(true);  // Publisher thread flushes its own batch on exit
+    }
+    if (tp_->isOpen()) {
+        tp_->close();  // Replays what it can of any backlog first
+    }
+    if (capture_) {
+        spdlog::info("Capture closed: {} frames, {} bytes", capture_->records(), capture_->bytes());
+        capture_->close();
     }
     
     spdlog::info("Shutdown complete (processed {} messages)", fhSeqNo_);
@@ -81,66 +158,82 @@ void TradeFeedHandler::stop() {
     running_ = false;
 }
 
+void TradeFeedHandler::attach(BinanceStream& stream, TpOutbound& tp) {
+    spdlog::info("Trade symbols: {}", fmt::join(symbols_, " "));
+    attached_ = true;
+    
+    // One thread per connection: publish inline, through the worker's TP
+    pipeline_.enabled = false;
+    queue_.reset();
+    tp_ = &tp;
+    
+    openCapture();
+    registerOn(stream);
+}
+
+void TradeFeedHandler::detach() {
+    if (tpReady()) {
+        flushBatch(true);
+    }
+    if (capture_) {
+        spdlog::info("Trade capture closed: {} frames, {} bytes", capture_->records(), capture_->bytes());
+        capture_->close();
+    }
+    spdlog::info("Trade streams stopped (processed {} messages)", fhSeqNo_);
+}
+
 // ============================================================================
 // PRIVATE METHODS
 // ============================================================================
 
-std::string TradeFeedHandler::buildStreamPath() const {
-    std::string path = "/stream?streams=";
-    for (size_t i = 0; i < symbols_.size(); ++i) {
-        if (i > 0) path += "/";
-        path += symbols_[i] + "@trade";
+void TradeFeedHandler::registerOn(BinanceStream& stream) {
+    for (const auto& sym : symbols_) {
+        stream.addStream(sym + "@trade");
     }
-    return path;
-}
-
-bool TradeFeedHandler::connectToTP() {
-    int attempt = 0;
-    while (running_) {
-        spdlog::info("Connecting to TP on {}:{}...", tpHost_, tpPort_);
-        
-        int h = khpu((S)tpHost_.c_str(), tpPort_, (S)"");
-        
-        if (h > 0) {
-            tpHandle_ = h;
-            spdlog::info("Connected to TP (handle {})", h);
+    stream.addRoute("@trade", [this](char* msg, size_t len, long long fhRecvTimeUtcNs) {
+        onFrame(msg, len, fhRecvTimeUtcNs);
+    });
+    
+    // Capture file growth ahead of the frames
+    if (capture_) {
+        stream.addTimer(std::chrono::milliseconds(capture::RESERVE_CHECK_MS), [this] {
+            return capture_->reserveAhead();
+        });
+    }
+    
+    // Pipeline mode: the publisher thread flushes, replays and publishes health
+    if (pipeline_.enabled) return;
+    
+    // Batch (and analytics) delay and TP backlog replay, on a fixed
+    // cadence whether or not frames arrive
+    stream.addTimer(timerTick(), [this] {
+        flushBatch();
+        tp_->poll();
+        return true;
+    });
+    
+    // Unified mode: the worker publishes one health row per connection
+    if (!attached_) {
+        stream.addTimer(std::chrono::seconds(HEALTH_INTERVAL_SEC), [this] {
+            publishHealth();
             return true;
-        }
-        
-        spdlog::error("Failed to connect to TP");
-        if (!sleepWithBackoff(attempt++)) {
-            return false;  // Shutdown requested
-        }
+        });
     }
-    return false;  // Shutdown requested
 }
 
-bool TradeFeedHandler::sleepWithBackoff(int attempt) {
-    int delay = INITIAL_BACKOFF_MS;
-    for (int i = 0; i < attempt && delay < MAX_BACKOFF_MS; ++i) {
-        delay *= BACKOFF_MULTIPLIER;
-    }
-    delay = std::min(delay, MAX_BACKOFF_MS);
-    
-    spdlog::info("Waiting {}ms before reconnect...", delay);
-    
-    // Sleep in small increments to allow quick shutdown response
-    const int checkIntervalMs = 100;
-    int slept = 0;
-    while (slept < delay && running_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(checkIntervalMs));
-        slept += checkIntervalMs;
+std::chrono::microseconds TradeFeedHandler::timerTick() const {
+    long long us = BinanceStream::STOP_CHECK_MS * 1000LL;
+    if (batching_.enabled) {
+        us = std::min<long long>(us, batching_.maxDelayUs);
     }
-    
-    return running_;
+    return std::chrono::microseconds(std::max<long long>(us, MIN_TICK_US));
 }
 
-void TradeFeedHandler::validateTradeId(const std::string& sym, long long tradeId) {
-    auto it = lastTradeId_.find(sym);
+void TradeFeedHandler::validateTradeId(int symIdx, const char* sym, long long tradeId) {
+    if (symIdx < 0) return;
+    const long long last = lastTradeIds_[symIdx];
     
-    if (it != lastTradeId_.end()) {
-        long long last = it->second;
-        
+    if (last >= 0) {
         if (tradeId < last) {
             spdlog::warn("OUT OF ORDER: {} last={} got={}", sym, last, tradeId);
         } else if (tradeId == last) {
@@ -151,145 +244,232 @@ void TradeFeedHandler::validateTradeId(const std::string& sym, long long tradeId
         }
     }
     
-    lastTradeId_[sym] = tradeId;
+    lastTradeIds_[symIdx] = tradeId;
 }
 
-void TradeFeedHandler::processMessage(const std::string& msg) {
-    // Capture wall-clock receive time (for cross-process correlation)
-    auto recvWall = std::chrono::system_clock::now();
-    long long fhRecvTimeUtcNs =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(
-            recvWall.time_since_epoch()).count();
+void TradeFeedHandler::processMessage(char* msg, long long fhRecvTimeUtcNs) {
+    TradeRecord rec;
+    if (!parseTrade(msg, rec, fhRecvTimeUtcNs)) return;
     
-    // Update health: message received
-    lastMsgTime_ = recvWall;
-    ++msgsReceived_;
+    // Increment sequence number
+    rec.fhSeqNo = ++fhSeqNo_;
+    
+    if (!pipeline_.enabled) {
+        publishTrade(rec);
+        flushBatch();
+        return;
+    }
+    
+    // Pipeline mode: never wait on the publisher. A dropped record leaves
+    // a gap in fhSeqNo so downstream gap detection still sees it.
+    if (!queue_->tryPush(rec)) {
+        long long n = ++queueOverflows_;
+        if ((n & (n - 1)) == 0) {  // Log at powers of two to avoid spam
+            spdlog::warn("Publish queue full, dropped {} trades so far", n);
+        }
+    }
+}
+
+bool TradeFeedHandler::parseTrade(char* msg, TradeRecord& rec, long long fhRecvTimeUtcNs) {
+    rec.fhRecvTimeUtcNs = fhRecvTimeUtcNs;
     
     // Start monotonic timer for parse latency
     auto parseStart = std::chrono::steady_clock::now();
     
-    // Parse JSON
-    rapidjson::Document doc;
-    doc.Parse(msg.c_str());
-    if (!doc.IsObject()) return;
+    // Parse JSON in place (pooled allocator, strings point into msg)
+    auto& doc = parser_.parseInsitu(msg);
+    if (!doc.IsObject()) return false;
     
     // Combined stream format: {"stream":"btcusdt@trade","data":{...}}
-    if (!doc.HasMember("data")) return;
-    const rapidjson::Value& d = doc["data"];
+    if (!doc.HasMember("data")) return false;
+    const JsonParser::Value& d = doc["data"];
     
-    if (!d.IsObject()) return;
-    if (!d.HasMember("s")) return;
+    if (!d.IsObject()) return false;
+    if (!d.HasMember("s")) return false;
     
     // Extract trade fields
-    const char* sym = d["s"].GetString();
-    long long tradeId = d["t"].GetInt64();
-    double price = std::stod(d["p"].GetString());
-    double qty = std::stod(d["q"].GetString());
-    bool buyerIsMaker = d["m"].GetBool();
-    long long exchEventTimeMs = d["E"].GetInt64();
-    long long exchTradeTimeMs = d["T"].GetInt64();
+    const auto& s = d["s"];
+    std::strncpy(rec.sym, s.GetString(), TradeRecord::SYM_LEN - 1);
+    rec.symIdx = symbolTable_.find(s.GetString(), s.GetStringLength());
+    rec.tradeId = d["t"].GetInt64();
+    const auto& p = d["p"];
+    const auto& q = d["q"];
+    rec.price = decimal::parseDouble(p.GetString(), p.GetStringLength());
+    rec.qty = decimal::parseDouble(q.GetString(), q.GetStringLength());
+    rec.buyerIsMaker = d["m"].GetBool();
+    rec.exchEventTimeMs = d["E"].GetInt64();
+    rec.exchTradeTimeMs = d["T"].GetInt64();
     
     // Validate sequence
-    validateTradeId(sym, tradeId);
+    validateTradeId(rec.symIdx, rec.sym, rec.tradeId);
     
     // End parse timer
     auto parseEnd = std::chrono::steady_clock::now();
-    long long fhParseUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    rec.fhParseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
         parseEnd - parseStart).count();
+    rec.parseEndSteadyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        parseEnd.time_since_epoch()).count();
+    latency_->record(latency::STAGE_PARSE, rec.symIdx, rec.fhParseNs);
     
-    // Increment sequence number
-    ++fhSeqNo_;
+    return true;
+}
+
+void TradeFeedHandler::publishTrade(const TradeRecord& rec) {
+    // Analytics stage: update rolling VWAP, send once its batch is full
+    if (analytics_) {
+        analytics_->onTrade(rec.symIdx, rec.exchTradeTimeMs * 1000000LL,
+                            rec.price, rec.qty, rec.fhRecvTimeUtcNs);
+        if (analytics_->batch().full()) {
+            flushAnalytics(true);
+        }
+    }
+    
+    // Batching mode: append to columnar batch, send when full
+    if (batch_) {
+        int r = batch_->beginRow();
+        batch_->setTimestamp(0, r, rec.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS);
+        if (rec.symIdx >= 0) {
+            batch_->setInterned(1, r, interned_.sym(rec.symIdx));
+        } else {
+            batch_->setSymbol(1, r, rec.sym);
+        }
+        batch_->setLong(2, r, rec.tradeId);
+        batch_->setFloat(3, r, rec.price);
+        batch_->setFloat(4, r, rec.qty);
+        batch_->setBool(5, r, rec.buyerIsMaker);
+        batch_->setLong(6, r, rec.exchEventTimeMs);
+        batch_->setLong(7, r, rec.exchTradeTimeMs);
+        batch_->setLong(8, r, rec.fhRecvTimeUtcNs);
+        batch_->setLong(9, r, rec.fhParseNs);
+        batch_->setLong(11, r, rec.fhSeqNo);
+        batch_->setRowStart(r, rec.parseEndSteadyNs);  // fhSendUs filled at flush
+        latency_->record(latency::STAGE_PUBLISH, rec.symIdx, latency::nowNs() - rec.parseEndSteadyNs);
+        
+        if (batch_->full()) {
+            flushBatch(true);
+        }
+        return;
+    }
     
     // Build kdb+ row
     K row = knk(12,
-        ktj(-KP, fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS),
-        ks((S)sym),
-        kj(tradeId),
-        kf(price),
-        kf(qty),
-        kb(buyerIsMaker),
-        kj(exchEventTimeMs),
-        kj(exchTradeTimeMs),
-        kj(fhRecvTimeUtcNs),
-        kj(fhParseUs),
+        ktj(-KP, rec.fhRecvTimeUtcNs - KDB_EPOCH_OFFSET_NS),
+        rec.symIdx >= 0 ? interned_.atom(rec.symIdx) : ks((S)rec.sym),
+        kj(rec.tradeId),
+        kf(rec.price),
+        kf(rec.qty),
+        kb(rec.buyerIsMaker),
+        kj(rec.exchEventTimeMs),
+        kj(rec.exchTradeTimeMs),
+        kj(rec.fhRecvTimeUtcNs),
+        kj(rec.fhParseNs),
         kj(0LL),  // fhSendUs placeholder
-        kj(fhSeqNo_)
+        kj(rec.fhSeqNo)
     );
     
-    // Capture send time
-    auto sendEnd = std::chrono::steady_clock::now();
-    long long fhSendUs = std::chrono::duration_cast<std::chrono::microseconds>(
-        sendEnd - parseEnd).count();
+    // Capture send time (in pipeline mode this includes time spent queued)
+    long long sendEndNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long fhSendUs = (sendEndNs - rec.parseEndSteadyNs) / 1000;
     kK(row)[10]->j = fhSendUs;
+    latency_->record(latency::STAGE_PUBLISH, rec.symIdx, sendEndNs - rec.parseEndSteadyNs);
     
     // Debug output (only shown at debug level)
-    spdlog::debug("Trade: sym={} tradeId={} price={:.2f} qty={:.4f} fhParseUs={} fhSendUs={} fhSeqNo={}",
-        sym, tradeId, price, qty, fhParseUs, fhSendUs, fhSeqNo_);
+    spdlog::debug("Trade: sym={} tradeId={} price={:.2f} qty={:.4f} fhParseNs={} fhSendUs={} fhSeqNo={}",
+        rec.sym, rec.tradeId, rec.price, rec.qty, rec.fhParseNs, fhSendUs, rec.fhSeqNo);
     
     // Publish to TP
-    K result = k(-tpHandle_, (S)".u.upd", ks((S)"trade_binance"), row, (K)0);
+    sendToTP(tradeTable_, row);
     
     // Update health: message published
-    lastPubTime_ = std::chrono::system_clock::now();
-    ++msgsPublished_;
-    
-    // Check if TP connection died
-    if (result == nullptr) {
-        spdlog::error("TP connection lost, reconnecting...");
-        connState_ = "reconnecting";
-        kclose(tpHandle_);
-        tpHandle_ = -1;
-        if (connectToTP()) {
-            // Resend to new connection
-            k(-tpHandle_, (S)".u.upd", ks((S)"trade_binance"), row, (K)0);
-        }
-    }
+    lastPubTime_.store(std::chrono::system_clock::now(), std::memory_order_relaxed);
+    msgsPublished_.fetch_add(1, std::memory_order_relaxed);
 }
 
-void TradeFeedHandler::runWebSocketLoop() {
-    std::string target = buildStreamPath();
-    spdlog::info("Connecting to Binance: {}{}", BINANCE_HOST, target);
-    
-    connState_ = "connecting";
+void TradeFeedHandler::flushBatch(bool force) {
+    flushAnalytics(force);
+    if (!batch_ || batch_->empty()) return;
+    if (!force && !batch_->full() && !batch_->due(std::chrono::steady_clock::now())) return;
     
-    // Initialize ASIO and SSL
-    net::io_context ioc;
-    ssl::context ctx{ssl::context::tlsv12_client};
-    ctx.set_default_verify_paths();
+    int rows = batch_->rows();
+    K data = batch_->take();
     
-    // Resolve and connect
-    tcp::resolver resolver{ioc};
-    websocket::stream<beast::ssl_stream<tcp::socket>> ws{ioc, ctx};
+    spdlog::debug("Trade batch: rows={}", rows);
     
-    auto const results = resolver.resolve(BINANCE_HOST, BINANCE_PORT);
-    net::connect(ws.next_layer().next_layer(), results.begin(), results.end());
+    sendToTP(tradeTable_, data);
     
-    // TLS handshake
-    ws.next_layer().handshake(ssl::stream_base::client);
+    // Update health: rows published
+    lastPubTime_.store(std::chrono::system_clock::now(), std::memory_order_relaxed);
+    msgsPublished_.fetch_add(rows, std::memory_order_relaxed);
+}
+
+void TradeFeedHandler::flushAnalytics(bool force) {
+    if (!analytics_) return;
+    ColumnBatch& batch = analytics_->batch();
+    if (batch.empty()) return;
+    if (!force && !batch.full() && !batch.due(std::chrono::steady_clock::now())) return;
+    
+    spdlog::debug("Analytics batch: rows={}", batch.rows());
+    sendToTP(analytics_->tableAtom(), batch.take());
+}
+
+bool TradeFeedHandler::sendToTP(SymAtom& table, K data) {
+    if (dryRun_) {
+        r0(data);
+        return true;
+    }
     
-    // WebSocket handshake
-    ws.handshake(BINANCE_HOST, target);
+    long long sendStartNs = latency::nowNs();
+    if (shm_ && shm_->publish(table, data)) {
+        latency_->record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+        r0(data);
+        return true;
+    }
     
-    spdlog::info("Connected to Binance ({} symbols)", symbols_.size());
-    connState_ = "connected";
+    // Queued (not blocked on) while the TP reconnects
+    const bool sent = tp_->send(table, data);
+    latency_->record(latency::STAGE_SEND, -1, latency::nowNs() - sendStartNs);
+    return sent;
+}
+
+void TradeFeedHandler::runPublisherLoop() {
+    if (!pinCurrentThread(pipeline_.publisherCpu)) {
+        spdlog::warn("Failed to pin publisher thread to CPU {}", pipeline_.publisherCpu);
+    }
+    spdlog::info("Publisher thread started");
     
-    // Reset backoff on successful connection
-    binanceReconnectAttempt_ = 0;
+    // Spin briefly before yielding when the ring is empty
+    constexpr int SPINS_BEFORE_YIELD = 1000;
     
-    // Health publish timer
     auto lastHealthPub = std::chrono::steady_clock::now();
-    
-    // Message loop
-    while (running_) {
-        beast::flat_buffer buffer;
-        ws.read(buffer);
-        
-        if (!running_) break;
+    TradeRecord rec;
+    int idleSpins = 0;
+    
+    while (true) {
+        if (queue_->tryPop(rec)) {
+            idleSpins = 0;
+            if (tpReady()) {
+                publishTrade(rec);
+            }
+        } else if (readerDone_) {
+            if (tpReady()) {
+                flushBatch(true);
+            }
+            break;  // Reader exited and ring drained
+        } else if (++idleSpins >= SPINS_BEFORE_YIELD) {
+            idleSpins = 0;
+            std::this_thread::yield();
+        }
         
-        std::string msg = beast::buffers_to_string(buffer.data());
-        processMessage(msg);
+        // Send a partial batch once it has waited max_delay_us, and
+        // replay any TP backlog
+        if (tpReady()) {
+            flushBatch();
+            tp_->poll();
+        }
         
-        // Publish health every HEALTH_INTERVAL_SEC seconds
+        // Publish health every HEALTH_INTERVAL_SEC seconds (independent of
+        // message arrival in pipeline mode)
         auto now = std::chrono::steady_clock::now();
         if (std::chrono::duration_cast<std::chrono::seconds>(now - lastHealthPub).count() >= HEALTH_INTERVAL_SEC) {
             publishHealth();
@@ -297,21 +477,91 @@ void TradeFeedHandler::runWebSocketLoop() {
         }
     }
     
-    connState_ = "disconnected";
+    // On this thread: the backlog's K objects never leave it
+    if (tp_->isOpen()) {
+        tp_->close();  // Replays what it can of any backlog first
+    }
+    spdlog::info("Publisher thread exiting");
+}
+
+void TradeFeedHandler::onFrame(char* msg, size_t len, long long fhRecvTimeUtcNs) {
+    // Update health: message received
+    lastMsgTime_.store(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(fhRecvTimeUtcNs))), std::memory_order_relaxed);
+    msgsReceived_.fetch_add(1, std::memory_order_relaxed);
+    
+    // Raw frame as received, before the in-situ parser rewrites it
+    if (capture_) {
+        capture_->append(capture::REC_FRAME, fhRecvTimeUtcNs, msg, len);
+    }
     
-    // Graceful close
-    if (!running_) {
-        try {
-            ws.close(websocket::close_code::normal);
-            spdlog::info("WebSocket closed gracefully");
-        } catch (...) {
-            // Ignore errors during shutdown
+    processMessage(msg, fhRecvTimeUtcNs);
+}
+
+void TradeFeedHandler::openCapture() {
+    if (!captureCfg_.enabled) return;
+    capture_ = std::make_unique<capture::Writer>();
+    if (capture_->open(captureCfg_.path, static_cast<size_t>(captureCfg_.chunkMb) << 20)) {
+        spdlog::info("Capturing raw frames to {}", captureCfg_.path);
+    } else {
+        spdlog::error("Cannot open capture file {}: {}", captureCfg_.path, std::strerror(errno));
+        capture_.reset();
+    }
+}
+
+void TradeFeedHandler::runReplay() {
+    capture::Reader reader;
+    if (!reader.open(replay_.path)) {
+        spdlog::error("Cannot open capture file {}", replay_.path);
+        return;
+    }
+    if (replay_.speed > 0) {
+        spdlog::info("Replaying {} ({} bytes) at {}x", replay_.path, reader.bytes(), replay_.speed);
+    } else {
+        spdlog::info("Replaying {} ({} bytes) at max speed", replay_.path, reader.bytes());
+    }
+    connState_ = "replay";
+    
+    capture::Pacer pacer(replay_.speed);
+    capture::Reader::Record rec;
+    std::vector<char> frame;    // Parsed in place, so copied out of the read-only mapping
+    long long frames = 0;
+    long long frameBytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    
+    while (running_ && reader.next(rec)) {
+        if (rec.type != capture::REC_FRAME) continue;
+        pacer.wait(rec.fhRecvTimeUtcNs);
+        
+        lastMsgTime_.store(std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(rec.fhRecvTimeUtcNs))), std::memory_order_relaxed);
+        msgsReceived_.fetch_add(1, std::memory_order_relaxed);
+        
+        frame.assign(rec.data, rec.data + rec.length);
+        frame.push_back('\0');
+        processMessage(frame.data(), rec.fhRecvTimeUtcNs);
+        if (!pipeline_.enabled) {
+            flushBatch();
         }
+        ++frames;
+        frameBytes += static_cast<long long>(rec.length);
     }
+    
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Replay done: {} frames, {} trades in {:.3f}s ({:.0f} msgs/s, {:.1f} MB/s)",
+        frames, fhSeqNo_, sec, sec > 0 ? frames / sec : 0.0, sec > 0 ? frameBytes / sec / 1e6 : 0.0);
+    const LatencyStats::Summary parse = latency_->summary(latency::STAGE_PARSE);
+    const LatencyStats::Summary publish = latency_->summary(latency::STAGE_PUBLISH);
+    spdlog::info("Replay parse ns: p50={} p99={} p99.9={} max={} (n={})",
+        parse.p50, parse.p99, parse.p999, parse.max, parse.cnt);
+    spdlog::info("Replay publish ns: p50={} p99={} p99.9={} max={} (n={})",
+        publish.p50, publish.p99, publish.p999, publish.max, publish.cnt);
 }
 
 void TradeFeedHandler::publishHealth() {
-    if (tpHandle_ <= 0) return;
+    if (!tp_->isOpen()) return;
     
     auto now = std::chrono::system_clock::now();
     
@@ -325,94 +575,41 @@ void TradeFeedHandler::publishHealth() {
             tp.time_since_epoch()).count() - KDB_EPOCH_OFFSET_NS;
     };
     
-    // Build health row (10 fields)
-    K row = knk(10,
+    long long received = msgsReceived_.load();
+    long long published = msgsPublished_.load();
+    long long queueDepth = queue_ ? static_cast<long long>(queue_->size()) : 0;
+    long long overflows = queueOverflows_.load();
+    const char* state = connState_.load();
+    
+    // Build health row (16 fields)
+    K row = knk(16,
         ktj(-KP, toKdbTs(now)),                    // time
         ks((S)"trade_fh"),                          // handler
         ktj(-KP, toKdbTs(startTime_)),             // startTimeUtc
         kj(uptimeSec),                              // uptimeSec
-        kj(msgsReceived_),                          // msgsReceived
-        kj(msgsPublished_),                         // msgsPublished
-        ktj(-KP, toKdbTs(lastMsgTime_)),           // lastMsgTimeUtc
-        ktj(-KP, toKdbTs(lastPubTime_)),           // lastPubTimeUtc
-        ks((S)connState_.c_str()),                  // connState
-        ki(static_cast<int>(symbols_.size()))       // symbolCount
+        kj(received),                               // msgsReceived
+        kj(published),                              // msgsPublished
+        ktj(-KP, toKdbTs(lastMsgTime_.load())),    // lastMsgTimeUtc
+        ktj(-KP, toKdbTs(lastPubTime_.load())),    // lastPubTimeUtc
+        ks((S)state),                               // connState
+        ki(static_cast<int>(symbols_.size())),      // symbolCount
+        kj(queueDepth),                             // queueDepth
+        kj(overflows),                              // queueOverflows
+        kj(0LL),                                    // conflated (quotes only)
+        kj(tp_->backlog()),                          // tpBacklog
+        kj(tp_->spilled()),                          // tpSpilled
+        kj(tp_->dropped())                           // tpDropped
     );
     
-    // Publish to TP (fire and forget)
-    k(-tpHandle_, (S)".u.upd", ks((S)"health_feed_handler"), row, (K)0);
-    
-    spdlog::debug("Health published: uptime={}s msgs={}/{} state={}", 
-        uptimeSec, msgsReceived_, msgsPublished_, connState_);
-}
-
-// ============================================================================
-// CONFIGURATION
-// ============================================================================
-
-#include "config.hpp"
-#include "logger.hpp"
-
-static const std::string DEFAULT_CONFIG_PATH = "config/trade_feed_handler.json";
-
-// ============================================================================
-// SIGNAL HANDLING
-// ============================================================================
-
-// Global pointer for signal handler access
-static TradeFeedHandler* g_handler = nullptr;
-
-static void signalHandler(int signum) {
-    const char* sigName = (signum == SIGINT) ? "SIGINT" : 
-                          (signum == SIGTERM) ? "SIGTERM" : "UNKNOWN";
-    spdlog::info("Received {} ({})", sigName, signum);
+    // Publish to TP (queued behind any backlog, like data)
+    tp_->send(healthTable_, row);
     
-    if (g_handler) {
-        g_handler->stop();
+    // Stage latency histograms for the interval since the last health row
+    K hist = latency_->takeInterval("trade_fh", toKdbTs(now));
+    if (hist) {
+        tp_->send(histTable_, hist);
     }
-}
-
-// ============================================================================
-// MAIN
-// ============================================================================
-
-int main(int argc, char* argv[]) {
-    std::cout << "=== Binance Trade Feed Handler ===\n";
-    
-    // Determine config path (from argument or default)
-    std::string configPath = DEFAULT_CONFIG_PATH;
-    if (argc > 1) {
-        configPath = argv[1];
-    }
-    
-    // Load configuration
-    FeedHandlerConfig config;
-    if (!config.load(configPath)) {
-        std::cerr << "Failed to load config, exiting\n";
-        return 1;
-    }
-    
-    if (config.symbols.empty()) {
-        std::cerr << "No symbols configured, exiting\n";
-        return 1;
-    }
-    
-    // Initialize logger
-    initLogger("Trade FH", config.logLevel, config.logFile);
-    
-    // Install signal handlers
-    std::signal(SIGINT, signalHandler);
-    std::signal(SIGTERM, signalHandler);
-    spdlog::info("Signal handlers installed (Ctrl+C to shutdown)");
-    
-    // Create and run handler
-    TradeFeedHandler handler(config.symbols, config.tpHost, config.tpPort);
-    g_handler = &handler;
-    
-    handler.run();
     
-    g_handler = nullptr;
-    spdlog::info("Exiting");
-    shutdownLogger();
-    return 0;
+    spdlog::debug("Health published: uptime={}s msgs={}/{} state={} queue={} overflows={} tpBacklog={}", 
+        uptimeSec, received, published, state, queueDepth, overflows, tp_->backlog());
 }
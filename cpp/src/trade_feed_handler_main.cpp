@@ -0,0 +1,88 @@
+/**
+ * @file trade_feed_handler_main.cpp
+ * @brief Entry point of the trade_feed_handler process
+ * 
+ * The handler itself is in trade_feed_handler.cpp, which the unified
+ * feed_handler links as well.
+ */
+
+#include "trade_feed_handler.hpp"
+#include "config.hpp"
+#include "logger.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <iostream>
+#include <csignal>
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+
+static const std::string DEFAULT_CONFIG_PATH = "config/trade_feed_handler.json";
+
+// ============================================================================
+// SIGNAL HANDLING
+// ============================================================================
+
+// Global pointer for signal handler access
+static TradeFeedHandler* g_handler = nullptr;
+
+static void signalHandler(int signum) {
+    const char* sigName = (signum == SIGINT) ? "SIGINT" : 
+                          (signum == SIGTERM) ? "SIGTERM" : "UNKNOWN";
+    spdlog::info("Received {} ({})", sigName, signum);
+    
+    if (g_handler) {
+        g_handler->stop();
+    }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::cout << "=== Binance Trade Feed Handler ===\n";
+    
+    // Config path (first plain argument or default) and replay options
+    std::string configPath = DEFAULT_CONFIG_PATH;
+    ReplayOptions replay;
+    if (!ReplayOptions::parse(argc, argv, configPath, replay)) {
+        return 1;
+    }
+    
+    // Load configuration
+    FeedHandlerConfig config;
+    if (!config.load(configPath)) {
+        std::cerr << "Failed to load config, exiting\n";
+        return 1;
+    }
+    
+    if (config.symbols.empty()) {
+        std::cerr << "No symbols configured, exiting\n";
+        return 1;
+    }
+    
+    // Initialize logger
+    initLogger("Trade FH", config.logLevel, config.logFile);
+    
+    // Install signal handlers
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+    spdlog::info("Signal handlers installed (Ctrl+C to shutdown)");
+    
+    // Create and run handler
+    TradeFeedHandler handler(config.symbols, config.tpHost, config.tpPort,
+                             config.pipeline, config.batching, config.analytics,
+                             config.shm, config.capture, config.outbound);
+    handler.setReplay(replay);
+    g_handler = &handler;
+    
+    handler.run();
+    
+    g_handler = nullptr;
+    spdlog::info("Exiting");
+    shutdownLogger();
+    return 0;
+}
@@ -1,21 +1,24 @@
 #!/bin/bash
 # start.sh - Start all components in separate tmux windows
 #
-# Usage: ./start.sh
+# Usage: ./start.sh            (separate trade and quote handlers)
+#        FH_MODE=unified ./start.sh  (one feed_handler process for both streams)
 #
 # Components started:
 #   - Tickerplant (port 5010)
 #   - RDB (port 5011)
+#   - HDB (port 5015)
 #   - RTE (port 5012)
 #   - Trade Feed Handler (connects to TP)
 #   - Quote Feed Handler (connects to TP)
+#     or, with FH_MODE=unified, the Feed Handler (both streams, config/feed_handler.json)
 #
 # Requires: tmux (install with: sudo apt install tmux)
 #
 # Navigation:
 #   Ctrl+B then N = next window
 #   Ctrl+B then P = previous window
-#   Ctrl+B then 0-4 = jump to window number
+#   Ctrl+B then 0-5 = jump to window number
 #   Ctrl+B then D = detach (keeps running)
 
 SESSION="market-data"
@@ -30,17 +33,27 @@ tmux send-keys -t $SESSION:tp "cd ~/binance_feed_handler && q kdb/tp.q" C-m
 tmux new-window -t $SESSION -n "rdb"
 tmux send-keys -t $SESSION:rdb "sleep 2 && cd ~/binance_feed_handler && q kdb/rdb.q" C-m
 
-# Window 2: RTE
+# Window 2: HDB (serves end-of-day partitions written by the RDB)
+tmux new-window -t $SESSION -n "hdb"
+tmux send-keys -t $SESSION:hdb "sleep 2 && cd ~/binance_feed_handler && q kdb/hdb.q" C-m
+
+# Window 3: RTE
 tmux new-window -t $SESSION -n "rte"
 tmux send-keys -t $SESSION:rte "sleep 3 && cd ~/binance_feed_handler && q kdb/rte.q" C-m
 
-# Window 3: Trade Feed Handler
-tmux new-window -t $SESSION -n "trade-fh"
-tmux send-keys -t $SESSION:trade-fh "sleep 4 && cd ~/binance_feed_handler && ./build/trade_feed_handler" C-m
+if [ "$FH_MODE" = "unified" ]; then
+    # Window 4: Feed Handler (trade and depth streams on shared connections)
+    tmux new-window -t $SESSION -n "fh"
+    tmux send-keys -t $SESSION:fh "sleep 4 && cd ~/binance_feed_handler && ./build/feed_handler" C-m
+else
+    # Window 4: Trade Feed Handler
+    tmux new-window -t $SESSION -n "trade-fh"
+    tmux send-keys -t $SESSION:trade-fh "sleep 4 && cd ~/binance_feed_handler && ./build/trade_feed_handler" C-m
 
-# Window 4: Quote Feed Handler
-tmux new-window -t $SESSION -n "quote-fh"
-tmux send-keys -t $SESSION:quote-fh "sleep 5 && cd ~/binance_feed_handler && ./build/quote_feed_handler" C-m
+    # Window 5: Quote Feed Handler
+    tmux new-window -t $SESSION -n "quote-fh"
+    tmux send-keys -t $SESSION:quote-fh "sleep 5 && cd ~/binance_feed_handler && ./build/quote_feed_handler" C-m
+fi
 
 # Select first window
 tmux select-window -t $SESSION:tp
@@ -50,7 +63,7 @@ echo ""
 echo "Navigation:"
 echo "  Ctrl+B then N     = next window"
 echo "  Ctrl+B then P     = previous window"
-echo "  Ctrl+B then 0-4   = jump to window"
+echo "  Ctrl+B then 0-5   = jump to window"
 echo "  Ctrl+B then D     = detach (keeps running)"
 echo ""
 echo "Run 'tmux attach -t $SESSION' to reattach"
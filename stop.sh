@@ -11,6 +11,7 @@ tmux kill-session -t market-data 2>/dev/null
 # Kill any stray processes
 pkill -f "trade_feed_handler" 2>/dev/null
 pkill -f "quote_feed_handler" 2>/dev/null
+pkill -f "build/feed_handler" 2>/dev/null
 pkill -f "q kdb/" 2>/dev/null
 
 echo "Done."